@@ -2,11 +2,278 @@
 #define _CTYPES_ALLOCATOR_H
 
 #include <stddef.h>
+#include <stdlib.h>
 
 typedef struct Allocator {
-  void*(*alloc)(size_t, void*);
-  void*(*realloc)(size_t, void*);
-  void(*free)(void*, void*);
+  void*(*alloc)(size_t size, void* ctx);
+  /// `ptr` can be `NULL`
+  void*(*realloc)(void* ptr, size_t size, void* ctx);
+  void(*free)(void* ptr, void* ctx);
+  /// Passed as the last argument to every callback
+  void* ctx;
 } allocator_t;
 
+typedef struct ArenaBlock {
+  struct ArenaBlock* next;
+  size_t cap;
+  size_t used;
+} arenaBlock_t;
+
+/// Bump allocator. Individual frees are no-ops (except for the last allocation),
+/// everything is released at once with `arena_reset` or `arena_destroy`.
+typedef struct Arena {
+  arenaBlock_t* first;
+  arenaBlock_t* current;
+  size_t block_size;
+  /// The most recent allocation, which can be grown or freed in place
+  void* last;
+  allocator_t allocator;
+} arena_t;
+
+/// Fixed-size block allocator with an intrusive free list.
+/// Allocations larger than `block_size` fail.
+typedef struct Pool {
+  size_t block_size;
+  size_t blocks_per_chunk;
+  void* free_list;
+  void* chunks;
+  allocator_t allocator;
+} pool_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// == Helpers ==
+// A `NULL` allocator uses malloc/realloc/free
+
+static inline void* allocator_alloc(const allocator_t* a, size_t size) {
+  if (a == NULL) return malloc(size);
+  return a->alloc(size, a->ctx);
+}
+
+static inline void* allocator_realloc(const allocator_t* a, void* ptr, size_t size) {
+  if (a == NULL) return realloc(ptr, size);
+  return a->realloc(ptr, size, a->ctx);
+}
+
+static inline void allocator_free(const allocator_t* a, void* ptr) {
+  if (a == NULL) return free(ptr);
+  a->free(ptr, a->ctx);
+}
+
+// == Arena ==
+void arena_init(arena_t* arena, size_t block_size);
+/// Frees all allocations, but keeps the blocks for reuse
+void arena_reset(arena_t* arena);
+void arena_destroy(arena_t* arena);
+allocator_t* arena_allocator(arena_t* arena);
+
+// == Pool ==
+void pool_init(pool_t* pool, size_t block_size, size_t blocks_per_chunk);
+/// Frees all allocations, but keeps the chunks for reuse
+void pool_reset(pool_t* pool);
+void pool_destroy(pool_t* pool);
+allocator_t* pool_allocator(pool_t* pool);
+
+#ifdef CT_ALLOCATOR_IMPL
+
+#include <string.h>
+
+#define _CALLOCATOR_ALIGN 16
+#define _CALLOCATOR_ALIGN_UP(n) (((n) + _CALLOCATOR_ALIGN - 1) & ~((size_t)_CALLOCATOR_ALIGN - 1))
+/// Every arena allocation is preceded by its size, so that `realloc` knows how much to copy
+#define _CARENA_HEADER _CALLOCATOR_ALIGN_UP(sizeof(size_t))
+#define _CARENA_BLOCK_HEADER _CALLOCATOR_ALIGN_UP(sizeof(arenaBlock_t))
+
+arenaBlock_t* _arena_newBlock(size_t cap) {
+  arenaBlock_t* block = malloc(_CARENA_BLOCK_HEADER + cap);
+  if (block == NULL) return NULL;
+  block->next = NULL;
+  block->cap = cap;
+  block->used = 0;
+  return block;
+}
+
+void* _arena_alloc(size_t size, void* ctx) {
+  arena_t* arena = (arena_t*)ctx;
+  size_t needed = _CARENA_HEADER + _CALLOCATOR_ALIGN_UP(size);
+
+  arenaBlock_t* block = arena->current;
+  while (block != NULL && block->cap - block->used < needed) {
+    block = block->next;
+    // Skipped blocks are reused after the next reset
+    if (block != NULL) block->used = 0;
+  }
+  if (block == NULL) {
+    block = _arena_newBlock(needed > arena->block_size ? needed : arena->block_size);
+    if (block == NULL) return NULL;
+    if (arena->current == NULL) {
+      arena->first = block;
+    } else {
+      block->next = arena->current->next;
+      arena->current->next = block;
+    }
+  }
+  arena->current = block;
+
+  void* header = ((void*)block) + _CARENA_BLOCK_HEADER + block->used;
+  block->used += needed;
+  *(size_t*)header = size;
+  arena->last = header + _CARENA_HEADER;
+  return arena->last;
+}
+
+void* _arena_realloc(void* ptr, size_t size, void* ctx) {
+  arena_t* arena = (arena_t*)ctx;
+  if (ptr == NULL) return _arena_alloc(size, ctx);
+
+  size_t* header = (size_t*)(ptr - _CARENA_HEADER);
+  size_t oldSize = *header;
+  if (ptr == arena->last) {
+    arenaBlock_t* block = arena->current;
+    size_t start = (ptr - _CARENA_HEADER) - (((void*)block) + _CARENA_BLOCK_HEADER);
+    size_t needed = _CARENA_HEADER + _CALLOCATOR_ALIGN_UP(size);
+    if (start + needed <= block->cap) {
+      block->used = start + needed;
+      *header = size;
+      return ptr;
+    }
+  }
+  if (size <= oldSize) {
+    *header = size;
+    return ptr;
+  }
+
+  void* newPtr = _arena_alloc(size, ctx);
+  if (newPtr == NULL) return NULL;
+  memcpy(newPtr, ptr, oldSize);
+  return newPtr;
+}
+
+void _arena_free(void* ptr, void* ctx) {
+  arena_t* arena = (arena_t*)ctx;
+  if (ptr == NULL || ptr != arena->last) return;
+  arenaBlock_t* block = arena->current;
+  block->used = (ptr - _CARENA_HEADER) - (((void*)block) + _CARENA_BLOCK_HEADER);
+  arena->last = NULL;
+}
+
+void arena_init(arena_t* arena, size_t block_size) {
+  arena->first = NULL;
+  arena->current = NULL;
+  arena->block_size = block_size;
+  arena->last = NULL;
+  arena->allocator = (allocator_t) {
+    .alloc = _arena_alloc,
+    .realloc = _arena_realloc,
+    .free = _arena_free,
+    .ctx = arena,
+  };
+}
+
+void arena_reset(arena_t* arena) {
+  if (arena->first != NULL) arena->first->used = 0;
+  arena->current = arena->first;
+  arena->last = NULL;
+}
+
+void arena_destroy(arena_t* arena) {
+  arenaBlock_t* block = arena->first;
+  while (block != NULL) {
+    arenaBlock_t* next = block->next;
+    free(block);
+    block = next;
+  }
+  arena->first = NULL;
+  arena->current = NULL;
+  arena->last = NULL;
+}
+
+allocator_t* arena_allocator(arena_t* arena) {
+  return &arena->allocator;
+}
+
+#define _CPOOL_CHUNK_HEADER _CALLOCATOR_ALIGN_UP(sizeof(void*))
+
+void _pool_pushChunkBlocks(pool_t* pool, void* chunk) {
+  void* blocks = chunk + _CPOOL_CHUNK_HEADER;
+  for (size_t i = pool->blocks_per_chunk; i > 0; i--) {
+    void* block = blocks + (i - 1) * pool->block_size;
+    *(void**)block = pool->free_list;
+    pool->free_list = block;
+  }
+}
+
+void* _pool_alloc(size_t size, void* ctx) {
+  pool_t* pool = (pool_t*)ctx;
+  if (size > pool->block_size) return NULL;
+  if (pool->free_list == NULL) {
+    void* chunk = malloc(_CPOOL_CHUNK_HEADER + pool->block_size * pool->blocks_per_chunk);
+    if (chunk == NULL) return NULL;
+    *(void**)chunk = pool->chunks;
+    pool->chunks = chunk;
+    _pool_pushChunkBlocks(pool, chunk);
+  }
+  void* block = pool->free_list;
+  pool->free_list = *(void**)block;
+  return block;
+}
+
+void* _pool_realloc(void* ptr, size_t size, void* ctx) {
+  pool_t* pool = (pool_t*)ctx;
+  if (size > pool->block_size) return NULL;
+  if (ptr == NULL) return _pool_alloc(size, ctx);
+  return ptr;
+}
+
+void _pool_free(void* ptr, void* ctx) {
+  pool_t* pool = (pool_t*)ctx;
+  if (ptr == NULL) return;
+  *(void**)ptr = pool->free_list;
+  pool->free_list = ptr;
+}
+
+void pool_init(pool_t* pool, size_t block_size, size_t blocks_per_chunk) {
+  if (block_size < sizeof(void*)) block_size = sizeof(void*);
+  pool->block_size = _CALLOCATOR_ALIGN_UP(block_size);
+  pool->blocks_per_chunk = blocks_per_chunk == 0 ? 1 : blocks_per_chunk;
+  pool->free_list = NULL;
+  pool->chunks = NULL;
+  pool->allocator = (allocator_t) {
+    .alloc = _pool_alloc,
+    .realloc = _pool_realloc,
+    .free = _pool_free,
+    .ctx = pool,
+  };
+}
+
+void pool_reset(pool_t* pool) {
+  pool->free_list = NULL;
+  for (void* chunk = pool->chunks; chunk != NULL; chunk = *(void**)chunk) {
+    _pool_pushChunkBlocks(pool, chunk);
+  }
+}
+
+void pool_destroy(pool_t* pool) {
+  void* chunk = pool->chunks;
+  while (chunk != NULL) {
+    void* next = *(void**)chunk;
+    free(chunk);
+    chunk = next;
+  }
+  pool->chunks = NULL;
+  pool->free_list = NULL;
+}
+
+allocator_t* pool_allocator(pool_t* pool) {
+  return &pool->allocator;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
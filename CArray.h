@@ -1,23 +1,97 @@
 #ifndef _CTYPE_ARRAY_H
 #define _CTYPE_ARRAY_H
 
-// #include "CAllocator.h"
+#include "CAllocator.h"
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifndef CARRAY_DEFAULT_CAP
 #define CARRAY_DEFAULT_CAP 10
 #endif
 
+#ifndef CARRAY_HUGE_THRESHOLD
+/// Arrays without an allocator whose data reaches this many bytes are stored in their own
+/// huge-page-aligned mapping, which grows without copying. 0 disables it
+#define CARRAY_HUGE_THRESHOLD (8 << 20)
+#endif
+
+#ifndef CARRAY_HUGE_PAGE
+#define CARRAY_HUGE_PAGE (2 << 20)
+#endif
+
 typedef int(*ArrayCmpFn)(const void* a, const void* b);
 typedef void(*ArraySortFn)(void* base, size_t num, size_t size, ArrayCmpFn compare);
 
+enum ArrayOptionSet {
+  /// `data` is inline storage the array doesn't own, it moves to the heap when the array grows
+  ARRAY_INLINE = 0b0001,
+  /// The `array_t` itself is owned by the caller, `array_destroy` only frees the data
+  ARRAY_IN_PLACE = 0b0010,
+  /// `data` is a shared mapping of a file, see `array_openMapped`
+  ARRAY_MAPPED = 0b0100,
+  /// `data` is an anonymous mapping, see `CARRAY_HUGE_THRESHOLD`
+  ARRAY_HUGE = 0b1000,
+};
+
+enum ArrayMapFlags {
+  /// The file is mapped read-only, growing the array fails
+  ARRAY_MAP_READ_ONLY = 0b0001,
+  /// Create the file if it doesn't exist
+  ARRAY_MAP_CREATE = 0b0010,
+  /// Start with an empty file
+  ARRAY_MAP_TRUNCATE = 0b0100,
+};
+
+/// Access pattern hints for `array_advise`
+enum ArrayAdvice {
+  ARRAY_ADVICE_NORMAL,
+  ARRAY_ADVICE_SEQUENTIAL,
+  ARRAY_ADVICE_RANDOM,
+  ARRAY_ADVICE_WILLNEED,
+  ARRAY_ADVICE_DONTNEED,
+};
+
+struct Array;
+
+/// Returns the capacity an array should grow to, to hold at least `needed` elements
+typedef size_t(*ArrayGrowthFn)(const struct Array* arr, size_t needed);
+
+#ifdef CT_STATS
+// Opt-in counters, `CT_STATS` has to be defined the same way in every file including this one
+#include <stdio.h>
+
+typedef struct ArrayStats {
+  /// New buffers, the first allocation or moving out of inline storage
+  size_t allocs;
+  /// Resizes of an existing buffer
+  size_t reallocs;
+  /// Bytes of elements kept by resizes that may copy them (heap buffers, not mappings)
+  size_t copy_bytes;
+  /// Bytes moved to insert or remove elements in the middle
+  size_t move_bytes;
+  size_t peak_cap;
+  size_t peak_size;
+} arrayStats_t;
+
+/// Called after the capacity of `arr` changed from `oldCap`
+typedef void(*ArrayGrowHookFn)(const struct Array* arr, size_t oldCap, void* ctx);
+#endif
+
 typedef struct Array {
   size_t size;
   size_t cap;
   /// The size of the type stored in this array
   size_t type_size;
   void* data;
+  /// Used for the array and its data, `NULL` uses malloc/realloc/free
+  allocator_t* allocator;
+  enum ArrayOptionSet opt;
+  /// How the capacity grows when the array is full, `NULL` uses `array_growthDouble`
+  ArrayGrowthFn growth;
+#ifdef CT_STATS
+  arrayStats_t stats;
+#endif
 } array_t;
 
 #define Array(T) array_t*
@@ -30,9 +104,29 @@ extern "C" {
 
 // == Create ==
 array_t* array_create(size_t type_size);
-// array_t* array_createWithAllocator(size_t type_size, allocator_t* a);
+/// The allocator must outlive the array
+array_t* array_createWithAllocator(size_t type_size, allocator_t* a);
 array_t* array_createWithCap(size_t type_size, size_t cap);
-// array_t* array_createWithCapAndAllocator(size_t type_size, size_t cap, allocator_t* a);
+array_t* array_createWithCapAndAllocator(size_t type_size, size_t cap, allocator_t* a);
+
+/// Initializes a caller-owned array, for example on the stack or inside a struct, without allocating.
+/// The first `inline_cap` elements are stored in `inline_data` (which can be NULL), the array
+/// moves to the heap once it grows past that. `inline_data` must stay valid and in place as long
+/// as the array uses it. Every `array_*` function can be used on the array, `array_destroy` only
+/// frees what the array allocated itself.
+void array_initInPlace(array_t* arr, size_t type_size, void* inline_data, size_t inline_cap, allocator_t* a);
+
+/// Maps the file at `path` as the data of the array, the file must contain whole elements.
+/// The pages are loaded on first access instead of reading the file up front.
+/// Growing the array extends the file, `array_sync` truncates it to `size` elements and `array_destroy` also unmaps and closes it.
+/// `flags` is a combination of `ArrayMapFlags`.
+/// Returns NULL if the file could not be opened or mapped (or on platforms without mmap)
+array_t* array_openMapped(const char* path, size_t type_size, int flags);
+/// Maps `count` elements stored at byte `offset` of the open file `fd` read-only, `offset` doesn't
+/// have to be page aligned. `fd` stays owned by the caller and can be closed right away.
+/// Growing the array fails, `array_destroy` only unmaps it.
+/// Returns NULL if the range could not be mapped (or on platforms without mmap)
+array_t* array_mapReadOnly(int fd, size_t offset, size_t count, size_t type_size);
 
 // == Destroy ==
 void array_destroy(array_t*);
@@ -59,6 +153,7 @@ int array_insert(array_t* arr, size_t idx, const void* value);
 /// Returns 1 if memory could not be allocated
 int array_push(array_t* arr, const void* value);
 /// Returns 1 if memory could not be allocated
+/// This moves every element, use `deque_t` (CDeque.h) for queues
 int array_pushFirst(array_t* arr, const void* value);
 /// Remove the last element and store its value in `outData` (if `outData` is not NULL)
 /// Returns the new size or -1 if size is already 0
@@ -71,10 +166,46 @@ long array_popAt(array_t* arr, size_t idx, void* outData);
 /// Remove the first element and store its value in `outData` (if `outData` is not NULL)
 /// Returns the new size or -1 if size is already 0
 /// The type of `outData` should be the type the array was initialized with
+/// This moves every element, use `deque_t` (CDeque.h) for queues
 long array_popFirst(array_t* arr, void* outData);
+/// Remove the element at `idx` by moving the last element into its place, the order is not kept
+/// Stores the removed value in `outData` (if `outData` is not NULL)
+/// Returns the new size or -1 if size is already 0
+long array_swapRemove(array_t* arr, size_t idx, void* outData);
+
+// == Ranges ==
+
+/// Copies `count` values from `values` to the end of the array, `values` may point into the array
+/// Returns 1 if memory could not be allocated
+int array_pushMany(array_t* arr, const void* values, size_t count);
+/// Copies `count` values from `values` to `idx`, moving the following elements once. `values` may point into the array
+/// Returns 1 if memory could not be allocated
+int array_insertRange(array_t* arr, size_t idx, const void* values, size_t count);
+/// Removes `count` elements starting at `idx`
+/// Returns the new size or -1 if the range is not in the array
+long array_removeRange(array_t* arr, size_t idx, size_t count);
+/// Pushes all elements of `other`, which should have the same `type_size`
+/// Returns 1 if memory could not be allocated
+int array_appendArray(array_t* arr, const array_t* other);
 
 // == Memory ==
 
+/// Doubles the capacity, starting at `CARRAY_DEFAULT_CAP` (the default)
+size_t array_growthDouble(const array_t* arr, size_t needed);
+/// Grows the capacity by half, which wastes less memory but copies more often
+size_t array_growthOneAndHalf(const array_t* arr, size_t needed);
+
+/// Defines an `ArrayGrowthFn` called `name` that grows the capacity by `step` elements
+#define CT_ARRAY_GROWTH_INCREMENT(name, step) \
+  static size_t name(const array_t* arr, size_t needed) { \
+    size_t cap = arr->cap + (step); \
+    return cap < needed ? needed : cap; \
+  }
+
+/// Makes room for `count` more elements, growing the capacity with the growth policy of the array
+/// Returns 1 if memory couldn't be allocated
+int array_reserve(array_t* arr, size_t count);
+
 /// Increases the capacit of the array to the given capacity
 /// No check is performed on `newCap` > `arr->newCap`
 /// Returns 1 if memory couldn't be allocated
@@ -84,56 +215,802 @@ int array_grow(array_t* arr, size_t newCap);
 int array_reserveAtLeast(array_t* arr, size_t newCap);
 
 void array_reset(array_t* arr);
+/// Frees the heap memory of the array, inline storage is kept.
+/// Mapped arrays are unmapped and their file truncated to 0
 void array_resetRemovingCapacity(array_t* arr);
+/// Reduces the capacity to the size of the array, inline storage is kept
+/// Returns 1 if memory couldn't be allocated
+int array_shrinkToFit(array_t* arr);
+
+/// Writes the changes to a mapped array back to its file, blocking until they are written.
+/// The spare capacity is dropped first, so the file holds exactly `size` elements.
+/// Does nothing for other arrays
+/// Returns 1 if the data could not be written
+int array_sync(array_t* arr);
+/// Tells the kernel how the data of a mapped array will be accessed.
+/// Does nothing for other arrays
+/// Returns 1 if the advice could not be applied
+int array_advise(array_t* arr, enum ArrayAdvice advice);
+
+#ifdef CT_STATS
+// == Stats ==
+
+/// The counters of all arrays, peaks are those of the largest array
+extern arrayStats_t array_globalStats;
+/// Prints the counters of `arr`, or the global ones if `arr` is NULL
+void array_statsDump(const array_t* arr, FILE* out);
+/// `hook` is called after every capacity change of any array, `NULL` removes it
+void array_setGrowHook(ArrayGrowHookFn hook, void* ctx);
+
+static inline void _array_statMax(size_t* local, size_t* global, size_t value) {
+  if (value > *local) *local = value;
+  size_t current = __atomic_load_n(global, __ATOMIC_RELAXED);
+  while (value > current && !__atomic_compare_exchange_n(global, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/// Records the size of `arr` after it grew, also used by the typed arrays and CIterator.h
+#define _CARRAY_STAT_SIZE(arr) _array_statMax(&(arr)->stats.peak_size, &array_globalStats.peak_size, (arr)->size)
+#else
+#define _CARRAY_STAT_SIZE(arr) ((void)0)
+#endif
 
 void array_swap(array_t* arr, size_t idx1, size_t idx2);
 
 /// Sorts the array in place.
+/// `sort` can be `NULL` to use `array_introsort`
 /// Returns `arr`
 array_t* array_sort(array_t* arr, ArrayCmpFn compare, ArraySortFn sort);
 
+// == Sort engine ==
+
+/// Unstable introsort (quicksort falling back to heapsort), O(n log n) in the worst case.
+/// Has the signature of `ArraySortFn`, so it can be passed wherever `qsort` is
+void array_introsort(void* base, size_t num, size_t size, ArrayCmpFn compare);
+
+/// Stable merge sort
+/// `scratch` must hold `arr->size` elements, if it is `NULL` a buffer is allocated for the call
+/// Returns 1 if memory could not be allocated
+int array_mergeSort(array_t* arr, ArrayCmpFn compare, void* scratch);
+
+// == Selection ==
+
+/// Reorders the array so that element `n` is the one that would be there if the array was sorted,
+/// no element before it is greater and no element after it is smaller (introselect, O(n) on average
+/// and O(n log n) in the worst case). Does nothing if `n` is out of bounds
+void array_nthElement(array_t* arr, size_t n, ArrayCmpFn compare);
+/// Sorts the smallest `k` elements into the first `k` places, the order of the others is unspecified.
+/// Much cheaper than `array_sort` when `k` is small, O(n log k)
+void array_partialSort(array_t* arr, size_t k, ArrayCmpFn compare);
+
+/// Stable LSD radix sorts in ascending order, the array should hold the type in the name.
+/// Floats are ordered like their values, with negative NaN first and positive NaN last.
+/// `scratch` must hold `arr->size` elements, if it is `NULL` a buffer is allocated for the call
+/// Returns 1 if memory could not be allocated
+int array_radixSortI32(array_t* arr, void* scratch);
+int array_radixSortU32(array_t* arr, void* scratch);
+int array_radixSortI64(array_t* arr, void* scratch);
+int array_radixSortU64(array_t* arr, void* scratch);
+int array_radixSortF32(array_t* arr, void* scratch);
+int array_radixSortF64(array_t* arr, void* scratch);
+
+/// Stable LSD radix sort of elements of any type by the unsigned key `key` returns for them.
+/// Use the `array_radixKey*` helpers to turn signed and floating point fields into keys.
+/// `scratch` must hold `arr->size` elements, if it is `NULL` a buffer is allocated for the call
+/// Returns 1 if memory could not be allocated
+int array_radixSortBy32(array_t* arr, uint32_t(*key)(const void* value), void* scratch);
+int array_radixSortBy64(array_t* arr, uint64_t(*key)(const void* value), void* scratch);
+
+/// Maps values to unsigned keys with the same order
+static inline uint32_t array_radixKeyI32(int32_t value) {
+  return (uint32_t)value ^ 0x80000000u;
+}
+
+static inline uint64_t array_radixKeyI64(int64_t value) {
+  return (uint64_t)value ^ 0x8000000000000000ull;
+}
+
+static inline uint32_t array_radixKeyF32(float value) {
+  uint32_t bits;
+  __builtin_memcpy(&bits, &value, sizeof(bits));
+  return bits ^ ((bits >> 31) ? 0xFFFFFFFFu : 0x80000000u);
+}
+
+static inline uint64_t array_radixKeyF64(double value) {
+  uint64_t bits;
+  __builtin_memcpy(&bits, &value, sizeof(bits));
+  return bits ^ ((bits >> 63) ? 0xFFFFFFFFFFFFFFFFull : 0x8000000000000000ull);
+}
+
+// == Sorted arrays ==
+// These expect `arr` to be sorted in ascending order according to `compare`
+
+/// Returns the index of the first element not less than `value`, or `arr->size`
+size_t array_lowerBound(const array_t* arr, const void* value, ArrayCmpFn compare);
+/// Returns the index of the first element greater than `value`, or `arr->size`
+size_t array_upperBound(const array_t* arr, const void* value, ArrayCmpFn compare);
+/// Returns the index of the first element equal to `value` or -1
+long array_binarySearch(const array_t* arr, const void* value, ArrayCmpFn compare);
+/// Stores the range of elements equal to `value` in [`outStart`, `outEnd`)
+/// Returns the amount of equal elements
+size_t array_equalRange(const array_t* arr, const void* value, ArrayCmpFn compare, size_t* outStart, size_t* outEnd);
+
+/// Creates a copy of the sorted array `arr` in Eytzinger (breadth-first) order.
+/// Searches in that layout touch far fewer cache lines on large arrays
+/// Returns NULL if memory could not be allocated
+array_t* array_eytzingerCreate(const array_t* arr);
+/// Returns the index in `eytzinger` of the first element not less than `value` or -1
+long array_eytzingerLowerBound(const array_t* eytzinger, const void* value, ArrayCmpFn compare);
+/// Returns the index in `eytzinger` of the first element greater than `value` or -1
+long array_eytzingerUpperBound(const array_t* eytzinger, const void* value, ArrayCmpFn compare);
+/// Returns the index in `eytzinger` of an element equal to `value` or -1
+long array_eytzingerSearch(const array_t* eytzinger, const void* value, ArrayCmpFn compare);
+/// Returns the index in `eytzinger` of the element following the one at `idx` in sorted order or -1
+long array_eytzingerNext(const array_t* eytzinger, long idx);
+/// Stores the indices in `eytzinger` of the lower and upper bounds of `value` in `outStart` and `outEnd`, -1 for none.
+/// Equal elements aren't adjacent in that layout, walk from `outStart` to `outEnd` with array_eytzingerNext
+/// Returns the amount of equal elements
+size_t array_eytzingerEqualRange(const array_t* eytzinger, const void* value, ArrayCmpFn compare, long* outStart, long* outEnd);
+
+/// Inserts `value` after the elements equal to it
+/// Returns 1 if memory could not be allocated
+int array_insertSorted(array_t* arr, const void* value, ArrayCmpFn compare);
+/// Removes consecutive duplicates in place
+/// Returns the new size
+size_t array_uniqueSorted(array_t* arr, ArrayCmpFn compare);
+
+// The following create a new sorted array using the allocator of `a`, in linear time.
+// Elements of `a` go first on ties. Each returns NULL if memory could not be allocated
+
+/// All elements of `a` and `b`
+array_t* array_mergeSorted(const array_t* a, const array_t* b, ArrayCmpFn compare);
+/// Elements that are in `a` and in `b`, duplicates are matched one to one
+array_t* array_intersectSorted(const array_t* a, const array_t* b, ArrayCmpFn compare);
+/// Elements that are in `a` or in `b`, duplicates are matched one to one
+array_t* array_unionSorted(const array_t* a, const array_t* b, ArrayCmpFn compare);
+/// Elements of `a` that are not in `b`, duplicates are matched one to one
+array_t* array_differenceSorted(const array_t* a, const array_t* b, ArrayCmpFn compare);
+
 /// Reverses the array in place
 /// Returns `arr`
 array_t* array_reverse(array_t* arr);
 
+// == Numeric kernels ==
+// These operate directly on `data`, the array should hold the type in the name.
+// On x86-64 they use AVX2 or SSE2, depending on what the CPU supports.
+// Floating point sums are not computed in array order, so they can round differently.
+
+int64_t array_sumI32(const array_t* arr);
+int64_t array_sumI64(const array_t* arr);
+double array_sumF32(const array_t* arr);
+double array_sumF64(const array_t* arr);
+
+/// Returns 1 if the array is empty
+int array_minMaxI32(const array_t* arr, int32_t* outMin, int32_t* outMax);
+/// Returns 1 if the array is empty
+int array_minMaxI64(const array_t* arr, int64_t* outMin, int64_t* outMax);
+/// Returns 1 if the array is empty. NaN values are skipped, unless the first element is NaN
+int array_minMaxF32(const array_t* arr, float* outMin, float* outMax);
+/// Returns 1 if the array is empty. NaN values are skipped, unless the first element is NaN
+int array_minMaxF64(const array_t* arr, double* outMin, double* outMax);
+
+/// Returns the index of the first element equal to `value` or -1
+long array_findFirstEqI32(const array_t* arr, int32_t value);
+long array_findFirstEqI64(const array_t* arr, int64_t value);
+long array_findFirstEqF32(const array_t* arr, float value);
+long array_findFirstEqF64(const array_t* arr, double value);
+
+/// Returns the amount of elements greater than `value`
+size_t array_countWhereGtI32(const array_t* arr, int32_t value);
+size_t array_countWhereGtI64(const array_t* arr, int64_t value);
+size_t array_countWhereGtF32(const array_t* arr, float value);
+size_t array_countWhereGtF64(const array_t* arr, double value);
+
+/// Ascending comparators (usable with `array_sort`), `iter_max` and `iter_min`
+/// use the numeric kernels when they are passed one of these
+int array_cmpI32(const void* a, const void* b);
+int array_cmpI64(const void* a, const void* b);
+int array_cmpF32(const void* a, const void* b);
+int array_cmpF64(const void* a, const void* b);
+
+/// Adds `in` to `out`, `iter_reduce` uses the numeric kernels when passed one of these
+void array_addI32(const void* in, void* out);
+void array_addI64(const void* in, void* out);
+
+/// Bits of `_array_cpuFeatures`
+#define _CARRAY_CPU_SSE2 0b0001
+#define _CARRAY_CPU_SSE42 0b0010
+#define _CARRAY_CPU_POPCNT 0b0100
+#define _CARRAY_CPU_AVX2 0b1000
+
+/// Returns the `_CARRAY_CPU_*` features of the CPU, detected on the first call.
+/// Shared by the kernels of every header, 0 on other architectures or with `CARRAY_NO_SIMD`
+int _array_cpuFeatures(void);
+
+// == Typed arrays ==
+
+/// Defines `name_t`, a typed wrapper around `array_t` with inline accessors where
+/// the element size is the compile-time constant `sizeof(T)`.
+/// `name_array(x)` returns the underlying `array_t`, so every `array_*` function
+/// can be used on the same data.
+///
+/// ```c
+/// CT_ARRAY_DEFINE(int, intarr)
+/// intarr_t* arr = intarr_create();
+/// intarr_push(arr, 5);
+/// ```
+#define CT_ARRAY_DEFINE(T, name) \
+  typedef struct { array_t array; } name##_t; \
+  static inline name##_t* name##_create(void) { \
+    return (name##_t*)array_create(sizeof(T)); \
+  } \
+  static inline name##_t* name##_createWithCap(size_t cap) { \
+    return (name##_t*)array_createWithCap(sizeof(T), cap); \
+  } \
+  /* `arr` should have a `type_size` of `sizeof(T)` */ \
+  static inline name##_t* name##_from(array_t* arr) { \
+    return (name##_t*)arr; \
+  } \
+  static inline array_t* name##_array(name##_t* arr) { \
+    return &arr->array; \
+  } \
+  static inline void name##_destroy(name##_t* arr) { \
+    array_destroy(&arr->array); \
+  } \
+  static inline size_t name##_size(const name##_t* arr) { \
+    return arr->array.size; \
+  } \
+  static inline T* name##_data(const name##_t* arr) { \
+    return (T*)arr->array.data; \
+  } \
+  static inline T name##_get(const name##_t* arr, size_t idx) { \
+    return ((T*)arr->array.data)[idx]; \
+  } \
+  static inline void name##_set(name##_t* arr, size_t idx, T value) { \
+    ((T*)arr->array.data)[idx] = value; \
+  } \
+  /* Returns 1 if memory could not be allocated */ \
+  static inline int name##_push(name##_t* arr, T value) { \
+    if (__builtin_expect(arr->array.size == arr->array.cap, 0)) { \
+      if (array_reserve(&arr->array, 1)) return 1; \
+    } \
+    ((T*)arr->array.data)[arr->array.size++] = value; \
+    _CARRAY_STAT_SIZE(&arr->array); \
+    return 0; \
+  } \
+  /* Returns the new size or -1 if size is already 0 */ \
+  static inline long name##_pop(name##_t* arr, T* outData) { \
+    if (arr->array.size == 0) return -1; \
+    arr->array.size -= 1; \
+    if (outData != NULL) *outData = ((T*)arr->array.data)[arr->array.size]; \
+    return arr->array.size; \
+  } \
+  static inline void name##_swap(name##_t* arr, size_t idx1, size_t idx2) { \
+    T* data = (T*)arr->array.data; \
+    T tmp = data[idx1]; \
+    data[idx1] = data[idx2]; \
+    data[idx2] = tmp; \
+  }
+
+/// A struct holding an array whose first `N` elements are stored inline.
+/// Initialize it with `CT_SMALL_ARRAY_INIT` and use its `array` member with the `array_*` functions.
+/// The struct must not be moved (copied) while the elements are inline
+///
+/// ```c
+/// CT_SMALL_ARRAY(int, 8) ids;
+/// CT_SMALL_ARRAY_INIT(ids);
+/// array_push(&ids.array, &id);
+/// array_destroy(&ids.array);
+/// ```
+#define CT_SMALL_ARRAY(T, N) struct { array_t array; T inline_data[N]; }
+#define CT_SMALL_ARRAY_INIT(small) \
+  array_initInPlace(&(small).array, sizeof((small).inline_data[0]), (small).inline_data, \
+    sizeof((small).inline_data) / sizeof((small).inline_data[0]), NULL)
+
+/// Swaps two non-overlapping elements of `size` bytes, with fast paths for 4, 8 and 16 bytes
+static inline void _array_swapBytes(void* a, void* b, size_t size) {
+  unsigned char tmp[16];
+  switch (size) {
+  case 4:
+    __builtin_memcpy(tmp, a, 4); __builtin_memcpy(a, b, 4); __builtin_memcpy(b, tmp, 4);
+    return;
+  case 8:
+    __builtin_memcpy(tmp, a, 8); __builtin_memcpy(a, b, 8); __builtin_memcpy(b, tmp, 8);
+    return;
+  case 16:
+    __builtin_memcpy(tmp, a, 16); __builtin_memcpy(a, b, 16); __builtin_memcpy(b, tmp, 16);
+    return;
+  }
+  unsigned char* x = a;
+  unsigned char* y = b;
+  for (; size >= 16; size -= 16, x += 16, y += 16) {
+    __builtin_memcpy(tmp, x, 16); __builtin_memcpy(x, y, 16); __builtin_memcpy(y, tmp, 16);
+  }
+  for (; size > 0; size--, x++, y++) {
+    unsigned char c = *x;
+    *x = *y;
+    *y = c;
+  }
+}
+
+/// Defines `static inline void name(T* data, size_t count)`, an introsort in which the comparison
+/// `LESS(a, b)` (true if `a` goes before `b`) is inlined instead of called through a pointer
+///
+/// ```c
+/// #define BY_PRICE(a, b) ((a).price < (b).price)
+/// CT_SORT_DEFINE(order_sortByPrice, order_t, BY_PRICE)
+/// order_sortByPrice(orders->data, orders->size);
+/// ```
+#define CT_SORT_DEFINE(name, T, LESS) \
+  static inline void name##_swap(T* a, T* b) { \
+    T tmp = *a; \
+    *a = *b; \
+    *b = tmp; \
+  } \
+  static inline void name##_insertion(T* data, size_t count) { \
+    for (size_t i = 1; i < count; i++) { \
+      T value = data[i]; \
+      size_t j = i; \
+      for (; j > 0 && LESS(value, data[j - 1]); j--) data[j] = data[j - 1]; \
+      data[j] = value; \
+    } \
+  } \
+  static inline void name##_siftDown(T* data, size_t root, size_t count) { \
+    for (size_t child; (child = 2 * root + 1) < count; root = child) { \
+      if (child + 1 < count && LESS(data[child], data[child + 1])) child++; \
+      if (!LESS(data[root], data[child])) return; \
+      name##_swap(&data[root], &data[child]); \
+    } \
+  } \
+  static inline void name##_heapsort(T* data, size_t count) { \
+    for (size_t i = count / 2; i > 0; i--) name##_siftDown(data, i - 1, count); \
+    for (size_t end = count - 1; end > 0; end--) { \
+      name##_swap(&data[0], &data[end]); \
+      name##_siftDown(data, 0, end); \
+    } \
+  } \
+  static inline void name##_loop(T* data, size_t count, int depth) { \
+    while (count > 16) { \
+      if (depth-- == 0) { \
+        name##_heapsort(data, count); \
+        return; \
+      } \
+      T* mid = data + count / 2; \
+      T* last = data + count - 1; \
+      if (LESS(*mid, *data)) name##_swap(mid, data); \
+      if (LESS(*last, *mid)) { \
+        name##_swap(last, mid); \
+        if (LESS(*mid, *data)) name##_swap(mid, data); \
+      } \
+      name##_swap(data, mid); \
+      size_t i = 0, j = count; \
+      for (;;) { \
+        do i++; while (LESS(data[i], data[0])); \
+        do j--; while (LESS(data[0], data[j])); \
+        if (i >= j) break; \
+        name##_swap(&data[i], &data[j]); \
+      } \
+      name##_swap(&data[0], &data[j]); \
+      if (j < count - j - 1) { \
+        name##_loop(data, j, depth); \
+        data += j + 1; \
+        count -= j + 1; \
+      } else { \
+        name##_loop(data + j + 1, count - j - 1, depth); \
+        count = j; \
+      } \
+    } \
+    name##_insertion(data, count); \
+  } \
+  static inline void name(T* data, size_t count) { \
+    if (count < 2) return; \
+    name##_loop(data, count, 2 * (63 - __builtin_clzll(count))); \
+  }
+
 #ifdef CT_ARRAY_IMPL
 
 #include <stdlib.h>
 #include <string.h>
 
-int _array_initializeMemory(array_t* arr, size_t count) {
+#if defined(__unix__) || defined(__APPLE__)
+#define _CARRAY_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#define _CARRAY_MREMAP
+// glibc only declares mremap with _GNU_SOURCE, which has to be defined before any system header
+#ifndef MREMAP_MAYMOVE
+#define MREMAP_MAYMOVE 1
+extern void* mremap(void* old_address, size_t old_size, size_t new_size, int flags, ...);
+#endif
+#endif
+#endif
+
+#ifdef CT_STATS
+
+arrayStats_t array_globalStats;
+static ArrayGrowHookFn _array_growHook = NULL;
+static void* _array_growHookCtx = NULL;
+
+
+/// Counts a capacity change of `arr` which had `oldCap` and `oldOpt` before
+void _array_statResize(array_t* arr, size_t oldCap, enum ArrayOptionSet oldOpt) {
+  if (oldCap == 0 || (oldOpt & ARRAY_INLINE)) {
+    arr->stats.allocs++;
+    __atomic_fetch_add(&array_globalStats.allocs, 1, __ATOMIC_RELAXED);
+  } else {
+    arr->stats.reallocs++;
+    __atomic_fetch_add(&array_globalStats.reallocs, 1, __ATOMIC_RELAXED);
+  }
+  if (oldCap > 0 && arr->cap > 0 && !(oldOpt & (ARRAY_MAPPED | ARRAY_HUGE))) {
+    size_t bytes = arr->size * arr->type_size;
+    arr->stats.copy_bytes += bytes;
+    __atomic_fetch_add(&array_globalStats.copy_bytes, bytes, __ATOMIC_RELAXED);
+  }
+  _array_statMax(&arr->stats.peak_cap, &array_globalStats.peak_cap, arr->cap);
+  _array_statMax(&arr->stats.peak_size, &array_globalStats.peak_size, arr->size);
+  if (_array_growHook != NULL) _array_growHook(arr, oldCap, _array_growHookCtx);
+}
+
+void array_statsDump(const array_t* arr, FILE* out) {
+  const arrayStats_t* stats = arr == NULL ? &array_globalStats : &arr->stats;
+  fprintf(out, "%s: allocs=%zu reallocs=%zu copy_bytes=%zu move_bytes=%zu peak_cap=%zu peak_size=%zu",
+    arr == NULL ? "arrays" : "array", stats->allocs, stats->reallocs, stats->copy_bytes,
+    stats->move_bytes, stats->peak_cap, stats->peak_size);
+  if (arr != NULL) fprintf(out, " size=%zu cap=%zu", arr->size, arr->cap);
+  fprintf(out, "\n");
+}
+
+void array_setGrowHook(ArrayGrowHookFn hook, void* ctx) {
+  _array_growHook = hook;
+  _array_growHookCtx = ctx;
+}
+
+#define _CARRAY_STAT_RESIZE(arr, oldCap, oldOpt) _array_statResize(arr, oldCap, oldOpt)
+#define _CARRAY_STAT_MOVE(arr, bytes) \
+  ((arr)->stats.move_bytes += (bytes), __atomic_fetch_add(&array_globalStats.move_bytes, (bytes), __ATOMIC_RELAXED))
+
+#else
+
+#define _CARRAY_STAT_RESIZE(arr, oldCap, oldOpt) ((void)0)
+#define _CARRAY_STAT_MOVE(arr, bytes) ((void)0)
+
+#endif
+
+/// Header of mapped arrays, `array` must stay the first member
+typedef struct _ArrayMapping {
+  array_t array;
+  /// -1 if the mapping doesn't keep the file open
+  int fd;
+  int flags;
+  /// Bytes mapped before `data`, the mapping starts on a page boundary
+  size_t offset;
+} _array_mapping_t;
+
+#ifdef _CARRAY_MMAP
+
+/// Resizes the file and the mapping to `newCap` elements
+int _array_mapResize(array_t* arr, size_t newCap) {
+  _array_mapping_t* mapping = (_array_mapping_t*)arr;
+  if (mapping->flags & ARRAY_MAP_READ_ONLY) return 1;
+  size_t oldLen = arr->cap * arr->type_size;
+  size_t newLen = newCap * arr->type_size;
+  // Grow the file before the mapping and shrink it after, so no page is mapped past its end
+  if (newLen > oldLen && ftruncate(mapping->fd, (off_t)newLen) != 0) return 1;
+
+  void* data = NULL;
+  if (newLen > 0 && oldLen > 0) {
+#ifdef _CARRAY_MREMAP
+    data = mremap(arr->data, oldLen, newLen, MREMAP_MAYMOVE);
+#else
+    // Both mappings show the same file, so nothing has to be copied
+    data = mmap(NULL, newLen, PROT_READ | PROT_WRITE, MAP_SHARED, mapping->fd, 0);
+    if (data != MAP_FAILED) munmap(arr->data, oldLen);
+#endif
+  } else if (newLen > 0) {
+    data = mmap(NULL, newLen, PROT_READ | PROT_WRITE, MAP_SHARED, mapping->fd, 0);
+  } else if (oldLen > 0) {
+    munmap(arr->data, oldLen);
+  }
+  if (data == MAP_FAILED) {
+    if (newLen > oldLen) (void)!ftruncate(mapping->fd, (off_t)oldLen);
+    return 1;
+  }
+
+  if (newLen < oldLen && ftruncate(mapping->fd, (off_t)newLen) != 0) return 1;
+  arr->data = data;
+  arr->cap = newCap;
+  if (arr->size > newCap) arr->size = newCap;
+  return 0;
+}
+
+void _array_unmap(array_t* arr) {
+  _array_mapping_t* mapping = (_array_mapping_t*)arr;
+  if (arr->cap > 0) munmap((char*)arr->data - mapping->offset, mapping->offset + arr->cap * arr->type_size);
+  // Drops the unused capacity at the end of the file
+  if (!(mapping->flags & ARRAY_MAP_READ_ONLY))
+    (void)!ftruncate(mapping->fd, (off_t)(arr->size * arr->type_size));
+  if (mapping->fd >= 0) close(mapping->fd);
+}
+
+array_t* array_openMapped(const char* path, size_t type_size, int flags) {
+  int oflags = (flags & ARRAY_MAP_READ_ONLY) ? O_RDONLY : O_RDWR;
+  if (flags & ARRAY_MAP_CREATE) oflags |= O_CREAT;
+  if ((flags & ARRAY_MAP_TRUNCATE) && !(flags & ARRAY_MAP_READ_ONLY)) oflags |= O_TRUNC;
+  int fd = open(path, oflags, 0644);
+  if (fd < 0) return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || type_size == 0 || (size_t)st.st_size % type_size != 0) {
+    close(fd);
+    return NULL;
+  }
+  _array_mapping_t* mapping = malloc(sizeof(_array_mapping_t));
+  if (mapping == NULL) {
+    close(fd);
+    return NULL;
+  }
+  memset(mapping, 0, sizeof(_array_mapping_t));
+  mapping->fd = fd;
+  mapping->flags = flags;
+
+  array_t* arr = &mapping->array;
+  arr->type_size = type_size;
+  arr->opt = ARRAY_MAPPED;
+  arr->size = (size_t)st.st_size / type_size;
+  arr->cap = arr->size;
+  if (st.st_size > 0) {
+    int prot = (flags & ARRAY_MAP_READ_ONLY) ? PROT_READ : PROT_READ | PROT_WRITE;
+    arr->data = mmap(NULL, (size_t)st.st_size, prot, MAP_SHARED, fd, 0);
+    if (arr->data == MAP_FAILED) {
+      close(fd);
+      free(mapping);
+      return NULL;
+    }
+  }
+  return arr;
+}
+
+array_t* array_mapReadOnly(int fd, size_t offset, size_t count, size_t type_size) {
+  if (type_size == 0 || count > SIZE_MAX / type_size) return NULL;
+  _array_mapping_t* mapping = malloc(sizeof(_array_mapping_t));
+  if (mapping == NULL) return NULL;
+  memset(mapping, 0, sizeof(_array_mapping_t));
+  mapping->fd = -1;
+  mapping->flags = ARRAY_MAP_READ_ONLY;
+
+  array_t* arr = &mapping->array;
+  arr->type_size = type_size;
+  arr->opt = ARRAY_MAPPED;
+  arr->size = count;
   arr->cap = count;
-  arr->data = malloc(arr->cap * arr->type_size);
-  return arr->data == NULL;
+  if (count > 0) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    mapping->offset = offset % page;
+    char* base = mmap(NULL, mapping->offset + count * type_size, PROT_READ, MAP_SHARED, fd, (off_t)(offset - mapping->offset));
+    if (base == MAP_FAILED) {
+      free(mapping);
+      return NULL;
+    }
+    arr->data = base + mapping->offset;
+  }
+  return arr;
 }
 
-int _array_growIfNecessary(array_t* arr) {
-  if (arr->cap == arr->size) {
-    if (arr->cap == 0) {
-      _array_initializeMemory(arr, CARRAY_DEFAULT_CAP);
-      if (arr->data == NULL) return 1;
-    } else {
-      return array_grow(arr, arr->cap * 2);
+int array_sync(array_t* arr) {
+  if (!(arr->opt & ARRAY_MAPPED) || arr->cap == 0) return 0;
+  _array_mapping_t* mapping = (_array_mapping_t*)arr;
+  // The spare capacity would be read back as elements after a crash or a reopen
+  if (!(mapping->flags & ARRAY_MAP_READ_ONLY) && arr->cap > arr->size && _array_mapResize(arr, arr->size) != 0) return 1;
+  if (arr->cap == 0) return 0;
+  size_t len = mapping->offset + arr->cap * arr->type_size;
+  return msync((char*)arr->data - mapping->offset, len, MS_SYNC) == 0 ? 0 : 1;
+}
+
+int array_advise(array_t* arr, enum ArrayAdvice advice) {
+  if (!(arr->opt & ARRAY_MAPPED) || arr->cap == 0) return 0;
+  int flag = MADV_NORMAL;
+  switch (advice) {
+  case ARRAY_ADVICE_NORMAL: flag = MADV_NORMAL; break;
+  case ARRAY_ADVICE_SEQUENTIAL: flag = MADV_SEQUENTIAL; break;
+  case ARRAY_ADVICE_RANDOM: flag = MADV_RANDOM; break;
+  case ARRAY_ADVICE_WILLNEED: flag = MADV_WILLNEED; break;
+  case ARRAY_ADVICE_DONTNEED: flag = MADV_DONTNEED; break;
+  }
+  _array_mapping_t* mapping = (_array_mapping_t*)arr;
+  size_t len = mapping->offset + arr->cap * arr->type_size;
+  return madvise((char*)arr->data - mapping->offset, len, flag) == 0 ? 0 : 1;
+}
+
+bool _array_usesHugeMapping(const array_t* arr, size_t cap) {
+  if (arr->opt & ARRAY_HUGE) return true;
+  return CARRAY_HUGE_THRESHOLD > 0 && arr->allocator == NULL && !(arr->opt & ARRAY_MAPPED)
+    && cap * arr->type_size >= (size_t)CARRAY_HUGE_THRESHOLD;
+}
+
+/// Length of the mapping holding `cap` elements
+size_t _array_hugeLength(const array_t* arr, size_t cap) {
+  size_t bytes = cap * arr->type_size;
+  return (bytes + CARRAY_HUGE_PAGE - 1) / CARRAY_HUGE_PAGE * CARRAY_HUGE_PAGE;
+}
+
+/// Maps `len` bytes aligned to `CARRAY_HUGE_PAGE`, so they can be backed by huge pages
+void* _array_hugeMap(size_t len) {
+  size_t padded = len + CARRAY_HUGE_PAGE;
+  unsigned char* raw = mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) return NULL;
+  unsigned char* data = (unsigned char*)(((uintptr_t)raw + CARRAY_HUGE_PAGE - 1) & ~(uintptr_t)(CARRAY_HUGE_PAGE - 1));
+  if (data > raw) munmap(raw, (size_t)(data - raw));
+  if (data + len < raw + padded) munmap(data + len, (size_t)(raw + padded - (data + len)));
+  return data;
+}
+
+/// Resizes the anonymous mapping of a huge array to `newCap` elements, moving the data
+/// into one if the array isn't mapped yet, or back to the heap if `newCap` is below `CARRAY_HUGE_THRESHOLD`
+int _array_hugeResize(array_t* arr, size_t newCap) {
+  size_t newLen = _array_hugeLength(arr, newCap);
+  if (!(arr->opt & ARRAY_HUGE)) {
+    if (newCap == 0) return 0;
+    void* data = _array_hugeMap(newLen);
+    if (data == NULL) return 1;
+    size_t count = arr->size < newCap ? arr->size : newCap;
+    if (count > 0) memcpy(data, arr->data, count * arr->type_size);
+    if (!(arr->opt & ARRAY_INLINE)) free(arr->data);
+    arr->data = data;
+    arr->opt = (arr->opt & ~ARRAY_INLINE) | ARRAY_HUGE;
+  } else if (newCap == 0) {
+    munmap(arr->data, _array_hugeLength(arr, arr->cap));
+    arr->data = NULL;
+    arr->opt &= ~ARRAY_HUGE;
+  } else if (newCap * arr->type_size < (size_t)CARRAY_HUGE_THRESHOLD) {
+    // Shrunk below the threshold, a mapping would waste most of its pages
+    void* data = allocator_alloc(arr->allocator, newCap * arr->type_size);
+    if (data == NULL) return 1;
+    memcpy(data, arr->data, (arr->size < newCap ? arr->size : newCap) * arr->type_size);
+    munmap(arr->data, _array_hugeLength(arr, arr->cap));
+    arr->data = data;
+    arr->opt &= ~ARRAY_HUGE;
+    arr->cap = newCap;
+    if (arr->size > newCap) arr->size = newCap;
+    return 0;
+  } else {
+    size_t oldLen = _array_hugeLength(arr, arr->cap);
+    if (newLen != oldLen) {
+#ifdef _CARRAY_MREMAP
+      // The kernel moves the pages instead of copying them
+      void* data = mremap(arr->data, oldLen, newLen, MREMAP_MAYMOVE);
+      if (data == MAP_FAILED) return 1;
+#else
+      void* data = _array_hugeMap(newLen);
+      if (data == NULL) return 1;
+      memcpy(data, arr->data, (oldLen < newLen ? oldLen : newLen));
+      munmap(arr->data, oldLen);
+#endif
+      arr->data = data;
     }
   }
+#ifdef MADV_HUGEPAGE
+  if (newCap > 0) madvise(arr->data, newLen, MADV_HUGEPAGE);
+#endif
+  arr->cap = newCap;
+  if (arr->size > newCap) arr->size = newCap;
+  return 0;
+}
+
+#else
+
+int _array_mapResize(array_t* arr, size_t newCap) {
+  (void)arr;
+  (void)newCap;
+  return 1;
+}
+
+void _array_unmap(array_t* arr) {
+  (void)arr;
+}
+
+array_t* array_openMapped(const char* path, size_t type_size, int flags) {
+  (void)path;
+  (void)type_size;
+  (void)flags;
+  return NULL;
+}
+
+array_t* array_mapReadOnly(int fd, size_t offset, size_t count, size_t type_size) {
+  (void)fd;
+  (void)offset;
+  (void)count;
+  (void)type_size;
+  return NULL;
+}
+
+int array_sync(array_t* arr) {
+  (void)arr;
+  return 0;
+}
+
+int array_advise(array_t* arr, enum ArrayAdvice advice) {
+  (void)arr;
+  (void)advice;
+  return 0;
+}
+
+bool _array_usesHugeMapping(const array_t* arr, size_t cap) {
+  (void)arr;
+  (void)cap;
+  return false;
+}
+
+int _array_hugeResize(array_t* arr, size_t newCap) {
+  (void)arr;
+  (void)newCap;
+  return 1;
+}
+
+#endif
+
+int _array_initializeMemory(array_t* arr, size_t count) {
+  if ((arr->opt & ARRAY_MAPPED) || _array_usesHugeMapping(arr, count)) return array_grow(arr, count);
+  arr->data = allocator_alloc(arr->allocator, count * arr->type_size);
+  if (arr->data == NULL) return 1;
+  arr->cap = count;
+  _CARRAY_STAT_RESIZE(arr, 0, arr->opt);
+  return 0;
+}
+
+int _array_growIfNecessary(array_t* arr) {
+  if (arr->cap == arr->size) return array_reserve(arr, 1);
   return 0;
 }
 
 array_t* array_create(size_t type_size) {
-  array_t* arr = calloc(1, sizeof(array_t));
+  return array_createWithAllocator(type_size, NULL);
+}
+
+array_t* array_createWithAllocator(size_t type_size, allocator_t* a) {
+  array_t* arr = allocator_alloc(a, sizeof(array_t));
+  if (arr == NULL) return NULL;
+  memset(arr, 0, sizeof(array_t));
   arr->type_size = type_size;
+  arr->allocator = a;
   return arr;
 }
 
 array_t* array_createWithCap(size_t type_size, size_t cap) {
-  array_t* arr = array_create(type_size);
+  return array_createWithCapAndAllocator(type_size, cap, NULL);
+}
+
+array_t* array_createWithCapAndAllocator(size_t type_size, size_t cap, allocator_t* a) {
+  array_t* arr = array_createWithAllocator(type_size, a);
+  if (arr == NULL) return NULL;
   _array_initializeMemory(arr, cap);
   return arr;
 }
 
+void array_initInPlace(array_t* arr, size_t type_size, void* inline_data, size_t inline_cap, allocator_t* a) {
+  memset(arr, 0, sizeof(array_t));
+  arr->type_size = type_size;
+  arr->allocator = a;
+  arr->opt = ARRAY_IN_PLACE;
+  if (inline_data != NULL && inline_cap > 0) {
+    arr->data = inline_data;
+    arr->cap = inline_cap;
+    arr->opt |= ARRAY_INLINE;
+  }
+}
+
 void array_destroy(array_t* arr) {
-  free(arr->data);
-  free(arr);
+  if (arr->opt & ARRAY_MAPPED) {
+    _array_unmap(arr);
+    free(arr);
+    return;
+  }
+  if (arr->opt & ARRAY_HUGE) _array_hugeResize(arr, 0);
+  if (!(arr->opt & ARRAY_INLINE))
+    allocator_free(arr->allocator, arr->data);
+  if (!(arr->opt & ARRAY_IN_PLACE))
+    allocator_free(arr->allocator, arr);
 }
 
 bool array_hasIndex(const array_t* arr, size_t idx) {
@@ -172,8 +1049,10 @@ int array_setChecked(array_t* arr, size_t idx, const void* value) {
 int array_insert(array_t* arr, size_t idx, const void* value) {
   if (_array_growIfNecessary(arr) != 0) return 1;
   memmove(array_get(arr, idx + 1), array_get(arr, idx), (arr->size - idx) * arr->type_size);
+  _CARRAY_STAT_MOVE(arr, (arr->size - idx) * arr->type_size);
   memcpy(arr->data + idx * arr->type_size, value, arr->type_size);
   arr->size += 1;
+  _CARRAY_STAT_SIZE(arr);
   return 0;
 }
 
@@ -181,6 +1060,7 @@ int array_push(array_t* arr, const void* value) {
   if (_array_growIfNecessary(arr) != 0) return 1;
   memcpy(array_get(arr, arr->size), value, arr->type_size);
   arr->size += 1;
+  _CARRAY_STAT_SIZE(arr);
   return 0;
 }
 
@@ -202,6 +1082,7 @@ long array_popAt(array_t* arr, size_t idx, void* outData) {
   if (outData != NULL)
     memcpy(outData, array_get(arr, idx), arr->type_size);
   memmove(array_get(arr, idx), array_get(arr, idx + 1), arr->type_size * (arr->size - idx));
+  _CARRAY_STAT_MOVE(arr, arr->type_size * (arr->size - idx));
   return arr->size;
 }
 
@@ -209,13 +1090,121 @@ long array_popFirst(array_t* arr, void* outData) {
   return array_popAt(arr, 0, outData);
 }
 
-int array_grow(array_t* arr, size_t newCap) {
+long array_swapRemove(array_t* arr, size_t idx, void* outData) {
+  if (arr->size == 0) return -1;
+  arr->size -= 1;
+  if (outData != NULL)
+    memcpy(outData, array_get(arr, idx), arr->type_size);
+  if (idx != arr->size)
+    memcpy(array_get(arr, idx), array_get(arr, arr->size), arr->type_size);
+  return arr->size;
+}
+
+/// Returns the offset of `ptr` from the start of the elements of `arr`, or SIZE_MAX if it doesn't point into them.
+/// Growing moves the elements, such pointers have to be rebased afterwards
+size_t _array_offsetOf(const array_t* arr, const void* ptr) {
+  uintptr_t start = (uintptr_t)arr->data, p = (uintptr_t)ptr;
+  if (arr->data == NULL || p < start || p >= start + arr->size * arr->type_size) return SIZE_MAX;
+  return p - start;
+}
+
+int array_pushMany(array_t* arr, const void* values, size_t count) {
+  if (count == 0) return 0;
+  size_t offset = _array_offsetOf(arr, values);
+  if (array_reserve(arr, count) != 0) return 1;
+  if (offset != SIZE_MAX) values = (unsigned char*)arr->data + offset;
+  memcpy(array_get(arr, arr->size), values, count * arr->type_size);
+  arr->size += count;
+  _CARRAY_STAT_SIZE(arr);
+  return 0;
+}
+
+int array_insertRange(array_t* arr, size_t idx, const void* values, size_t count) {
+  if (count == 0) return 0;
+  size_t offset = _array_offsetOf(arr, values);
+  if (array_reserve(arr, count) != 0) return 1;
+  size_t bytes = count * arr->type_size;
+  memmove(array_get(arr, idx + count), array_get(arr, idx), (arr->size - idx) * arr->type_size);
+  _CARRAY_STAT_MOVE(arr, (arr->size - idx) * arr->type_size);
+  if (offset == SIZE_MAX) {
+    memcpy(array_get(arr, idx), values, bytes);
+  } else {
+    // The values before `idx` stayed in place, the others moved `count` elements further
+    unsigned char* data = arr->data;
+    size_t split = idx * arr->type_size;
+    size_t before = offset < split ? split - offset : 0;
+    if (before > bytes) before = bytes;
+    memcpy(data + split, data + offset, before);
+    memcpy(data + split + before, data + (offset + before) + bytes, bytes - before);
+  }
+  arr->size += count;
+  _CARRAY_STAT_SIZE(arr);
+  return 0;
+}
+
+long array_removeRange(array_t* arr, size_t idx, size_t count) {
+  if (idx > arr->size || count > arr->size - idx) return -1;
+  if (count == 0) return arr->size;
+  memmove(array_get(arr, idx), array_get(arr, idx + count), (arr->size - idx - count) * arr->type_size);
+  _CARRAY_STAT_MOVE(arr, (arr->size - idx - count) * arr->type_size);
+  arr->size -= count;
+  return arr->size;
+}
+
+int array_appendArray(array_t* arr, const array_t* other) {
+  return array_pushMany(arr, other->data, other->size);
+}
+
+int _array_resize(array_t* arr, size_t newCap) {
+  if (arr->opt & ARRAY_MAPPED) return _array_mapResize(arr, newCap);
+  if (_array_usesHugeMapping(arr, newCap)) return _array_hugeResize(arr, newCap);
+  if (arr->opt & ARRAY_INLINE) {
+    // Inline storage can't be reallocated, the elements are copied to the heap
+    void* data = allocator_alloc(arr->allocator, newCap * arr->type_size);
+    if (data == NULL) return 1;
+    memcpy(data, arr->data, (arr->size < newCap ? arr->size : newCap) * arr->type_size);
+    arr->data = data;
+    arr->cap = newCap;
+    arr->opt &= ~ARRAY_INLINE;
+    return 0;
+  }
+  void* data = allocator_realloc(arr->allocator, arr->data, newCap * arr->type_size);
+  if (data == NULL) return 1;
+  arr->data = data;
   arr->cap = newCap;
-  arr->data = realloc(arr->data, newCap * arr->type_size);
-  if (arr->data == NULL) return 1;
   return 0;
 }
 
+int array_grow(array_t* arr, size_t newCap) {
+#ifdef CT_STATS
+  size_t oldCap = arr->cap;
+  enum ArrayOptionSet oldOpt = arr->opt;
+  if (_array_resize(arr, newCap) != 0) return 1;
+  _CARRAY_STAT_RESIZE(arr, oldCap, oldOpt);
+  return 0;
+#else
+  return _array_resize(arr, newCap);
+#endif
+}
+
+size_t array_growthDouble(const array_t* arr, size_t needed) {
+  size_t cap = arr->cap == 0 ? CARRAY_DEFAULT_CAP : arr->cap * 2;
+  return cap < needed ? needed : cap;
+}
+
+size_t array_growthOneAndHalf(const array_t* arr, size_t needed) {
+  size_t cap = arr->cap < CARRAY_DEFAULT_CAP ? CARRAY_DEFAULT_CAP : arr->cap + arr->cap / 2;
+  return cap < needed ? needed : cap;
+}
+
+int array_reserve(array_t* arr, size_t count) {
+  size_t needed = arr->size + count;
+  if (needed <= arr->cap) return 0;
+  size_t newCap = arr->growth == NULL ? array_growthDouble(arr, needed) : arr->growth(arr, needed);
+  if (newCap < needed) newCap = needed;
+  return array_grow(arr, newCap);
+}
+
 int array_reserveAtLeast(array_t* arr, size_t newCap) {
   if (arr->cap >= newCap) return 0;
   return array_grow(arr, newCap);
@@ -227,29 +1216,1248 @@ void array_reset(array_t* arr) {
 
 void array_resetRemovingCapacity(array_t* arr) {
   array_reset(arr);
+  if (arr->opt & ARRAY_INLINE) return;
+  if (arr->opt & ARRAY_MAPPED) {
+    _array_mapResize(arr, 0);
+    return;
+  }
+  if (arr->opt & ARRAY_HUGE) {
+    _array_hugeResize(arr, 0);
+    return;
+  }
   arr->cap = 0;
-  free(arr->data);
+  allocator_free(arr->allocator, arr->data);
+  arr->data = NULL;
+}
+
+int array_shrinkToFit(array_t* arr) {
+  if (arr->size == arr->cap || (arr->opt & ARRAY_INLINE)) return 0;
+  if (arr->size == 0) {
+    array_resetRemovingCapacity(arr);
+    return 0;
+  }
+  return array_grow(arr, arr->size);
 }
 
 void array_swap(array_t* arr, size_t idx1, size_t idx2) {
-  unsigned char tmp[arr->type_size];
-  void* a = array_get(arr, idx1);
-  void* b = array_get(arr, idx2);
-  memcpy(tmp, a, arr->type_size);
-  memmove(a, b, arr->type_size);
-  memcpy(b, tmp, arr->type_size);
+  if (idx1 == idx2) return;
+  _array_swapBytes(array_get(arr, idx1), array_get(arr, idx2), arr->type_size);
 }
 
 array_t* array_sort(array_t* arr, ArrayCmpFn cmp, ArraySortFn sort) {
+  if (sort == NULL) sort = array_introsort;
   sort(arr->data, arr->size, arr->type_size, cmp);
   return arr;
 }
 
-array_t* array_reverse(array_t* arr) {
-  for (size_t i = 0; i < arr->size / 2; i++) {
-    array_swap(arr, i, arr->size - i - 1);
+#define _CARRAY_SORT_THRESHOLD 16
+#define _CARRAY_AT(base, i, size) ((void*)((unsigned char*)(base) + (i) * (size)))
+
+void _array_insertionSort(void* base, size_t num, size_t size, ArrayCmpFn cmp) {
+  for (size_t i = 1; i < num; i++) {
+    for (size_t j = i; j > 0; j--) {
+      void* a = _CARRAY_AT(base, j - 1, size);
+      void* b = _CARRAY_AT(base, j, size);
+      if (cmp(a, b) <= 0) break;
+      _array_swapBytes(a, b, size);
+    }
   }
-  return arr;
+}
+
+void _array_siftDown(void* base, size_t root, size_t num, size_t size, ArrayCmpFn cmp) {
+  for (size_t child; (child = 2 * root + 1) < num; root = child) {
+    if (child + 1 < num && cmp(_CARRAY_AT(base, child, size), _CARRAY_AT(base, child + 1, size)) < 0)
+      child++;
+    void* r = _CARRAY_AT(base, root, size);
+    void* c = _CARRAY_AT(base, child, size);
+    if (cmp(r, c) >= 0) return;
+    _array_swapBytes(r, c, size);
+  }
+}
+
+void _array_heapsort(void* base, size_t num, size_t size, ArrayCmpFn cmp) {
+  for (size_t i = num / 2; i > 0; i--)
+    _array_siftDown(base, i - 1, num, size, cmp);
+  for (size_t end = num - 1; end > 0; end--) {
+    _array_swapBytes(base, _CARRAY_AT(base, end, size), size);
+    _array_siftDown(base, 0, end, size, cmp);
+  }
+}
+
+/// Partitions `num` > 2 elements around the median of three, returns the final index of the pivot.
+/// Nothing before it is greater, nothing after it is smaller
+size_t _array_partition(void* base, size_t num, size_t size, ArrayCmpFn cmp) {
+  // Median of three, moved to the front as the pivot. The largest of the three
+  // ends up last, which stops the left scan
+  void* first = base;
+  void* mid = _CARRAY_AT(base, num / 2, size);
+  void* last = _CARRAY_AT(base, num - 1, size);
+  if (cmp(mid, first) < 0) _array_swapBytes(mid, first, size);
+  if (cmp(last, mid) < 0) {
+    _array_swapBytes(last, mid, size);
+    if (cmp(mid, first) < 0) _array_swapBytes(mid, first, size);
+  }
+  _array_swapBytes(first, mid, size);
+
+  size_t i = 0, j = num;
+  for (;;) {
+    do i++; while (cmp(_CARRAY_AT(base, i, size), base) < 0);
+    do j--; while (cmp(base, _CARRAY_AT(base, j, size)) < 0);
+    if (i >= j) break;
+    _array_swapBytes(_CARRAY_AT(base, i, size), _CARRAY_AT(base, j, size), size);
+  }
+  _array_swapBytes(base, _CARRAY_AT(base, j, size), size);
+  return j;
+}
+
+void _array_introsortLoop(void* base, size_t num, size_t size, ArrayCmpFn cmp, int depth) {
+  while (num > _CARRAY_SORT_THRESHOLD) {
+    if (depth-- == 0) {
+      _array_heapsort(base, num, size, cmp);
+      return;
+    }
+    size_t j = _array_partition(base, num, size, cmp);
+
+    // Recurse into the smaller half, so the stack stays O(log n)
+    if (j < num - j - 1) {
+      _array_introsortLoop(base, j, size, cmp, depth);
+      base = _CARRAY_AT(base, j + 1, size);
+      num -= j + 1;
+    } else {
+      _array_introsortLoop(_CARRAY_AT(base, j + 1, size), num - j - 1, size, cmp, depth);
+      num = j;
+    }
+  }
+  _array_insertionSort(base, num, size, cmp);
+}
+
+void array_introsort(void* base, size_t num, size_t size, ArrayCmpFn compare) {
+  if (num < 2) return;
+  _array_introsortLoop(base, num, size, compare, 2 * (63 - __builtin_clzll(num)));
+}
+
+void array_nthElement(array_t* arr, size_t n, ArrayCmpFn cmp) {
+  if (n >= arr->size) return;
+  void* base = arr->data;
+  size_t num = arr->size;
+  size_t size = arr->type_size;
+  int depth = 2 * (63 - __builtin_clzll(num));
+  // Only the side holding `n` is partitioned further
+  while (num > _CARRAY_SORT_THRESHOLD) {
+    if (depth-- == 0) {
+      _array_heapsort(base, num, size, cmp);
+      return;
+    }
+    size_t j = _array_partition(base, num, size, cmp);
+    if (j == n) return;
+    if (n < j) {
+      num = j;
+    } else {
+      base = _CARRAY_AT(base, j + 1, size);
+      num -= j + 1;
+      n -= j + 1;
+    }
+  }
+  _array_insertionSort(base, num, size, cmp);
+}
+
+void array_partialSort(array_t* arr, size_t k, ArrayCmpFn cmp) {
+  void* base = arr->data;
+  size_t num = arr->size;
+  size_t size = arr->type_size;
+  if (k > num) k = num;
+  if (k == 0) return;
+  if (k > num / 8) {
+    // Selecting first is cheaper than keeping a large heap
+    array_nthElement(arr, k - 1, cmp);
+    array_introsort(base, k - 1, size, cmp);
+    return;
+  }
+  // Max-heap of the smallest `k` so far, an element only costs a comparison with the top unless it's smaller
+  for (size_t i = k / 2; i > 0; i--)
+    _array_siftDown(base, i - 1, k, size, cmp);
+  for (size_t i = k; i < num; i++) {
+    void* value = _CARRAY_AT(base, i, size);
+    if (cmp(value, base) >= 0) continue;
+    _array_swapBytes(base, value, size);
+    _array_siftDown(base, 0, k, size, cmp);
+  }
+  for (size_t end = k - 1; end > 0; end--) {
+    _array_swapBytes(base, _CARRAY_AT(base, end, size), size);
+    _array_siftDown(base, 0, end, size, cmp);
+  }
+}
+
+static inline void _array_copyElement(void* dst, const void* src, size_t size) {
+  switch (size) {
+  case 4: __builtin_memcpy(dst, src, 4); return;
+  case 8: __builtin_memcpy(dst, src, 8); return;
+  case 16: __builtin_memcpy(dst, src, 16); return;
+  }
+  memcpy(dst, src, size);
+}
+
+void _array_mergeRuns(const void* src, void* dst, size_t mid, size_t end, size_t size, ArrayCmpFn cmp) {
+  size_t i = 0, j = mid, k = 0;
+  while (i < mid && j < end) {
+    // Taking from the left on ties keeps the sort stable
+    const void* left = _CARRAY_AT(src, i, size);
+    const void* right = _CARRAY_AT(src, j, size);
+    if (cmp(right, left) < 0) {
+      _array_copyElement(_CARRAY_AT(dst, k++, size), right, size);
+      j++;
+    } else {
+      _array_copyElement(_CARRAY_AT(dst, k++, size), left, size);
+      i++;
+    }
+  }
+  memcpy(_CARRAY_AT(dst, k, size), _CARRAY_AT(src, i, size), (mid - i) * size);
+  k += mid - i;
+  memcpy(_CARRAY_AT(dst, k, size), _CARRAY_AT(src, j, size), (end - j) * size);
+}
+
+int array_mergeSort(array_t* arr, ArrayCmpFn compare, void* scratch) {
+  size_t num = arr->size;
+  size_t size = arr->type_size;
+  if (num < 2) return 0;
+  void* buffer = scratch != NULL ? scratch : allocator_alloc(arr->allocator, num * size);
+  if (buffer == NULL) return 1;
+
+  // Insertion sort is stable and fast on short runs, merge them bottom-up
+  for (size_t start = 0; start < num; start += _CARRAY_SORT_THRESHOLD) {
+    size_t count = num - start < _CARRAY_SORT_THRESHOLD ? num - start : _CARRAY_SORT_THRESHOLD;
+    _array_insertionSort(_CARRAY_AT(arr->data, start, size), count, size, compare);
+  }
+
+  void* src = arr->data;
+  void* dst = buffer;
+  for (size_t width = _CARRAY_SORT_THRESHOLD; width < num; width *= 2) {
+    for (size_t start = 0; start < num; start += 2 * width) {
+      size_t mid = num - start < width ? num - start : width;
+      size_t end = num - start < 2 * width ? num - start : 2 * width;
+      _array_mergeRuns(_CARRAY_AT(src, start, size), _CARRAY_AT(dst, start, size), mid, end, size, compare);
+    }
+    void* tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+  if (src != arr->data) memcpy(arr->data, src, num * size);
+
+  if (scratch == NULL) allocator_free(arr->allocator, buffer);
+  return 0;
+}
+
+/// Defines an LSD radix sort over the bytes of the `KeyT` returned by `KEY(value, keyFn)`.
+/// All digit histograms are built in one pass and passes where every element has the same digit are skipped
+#define _CARRAY_RADIX_DEFINE(name, KeyT, ELEM_SIZE, KEY) \
+  int _array_radixSort##name(array_t* arr, const void* keyFn, void* scratch) { \
+    /* Only the keys of the By variants call `keyFn` */ \
+    (void)keyFn; \
+    size_t num = arr->size; \
+    size_t size = ELEM_SIZE; \
+    if (num < 2) return 0; \
+    void* buffer = scratch != NULL ? scratch : allocator_alloc(arr->allocator, num * size); \
+    if (buffer == NULL) return 1; \
+    size_t counts[sizeof(KeyT)][256]; \
+    memset(counts, 0, sizeof(counts)); \
+    for (size_t i = 0; i < num; i++) { \
+      KeyT key = KEY(_CARRAY_AT(arr->data, i, size), keyFn); \
+      for (size_t d = 0; d < sizeof(KeyT); d++) \
+        counts[d][(key >> (8 * d)) & 0xFF]++; \
+    } \
+    void* src = arr->data; \
+    void* dst = buffer; \
+    for (size_t d = 0; d < sizeof(KeyT); d++) { \
+      size_t* offsets = counts[d]; \
+      if (offsets[(KEY(src, keyFn) >> (8 * d)) & 0xFF] == num) continue; \
+      size_t total = 0; \
+      for (size_t b = 0; b < 256; b++) { \
+        size_t count = offsets[b]; \
+        offsets[b] = total; \
+        total += count; \
+      } \
+      for (size_t i = 0; i < num; i++) { \
+        void* value = _CARRAY_AT(src, i, size); \
+        size_t b = (KEY(value, keyFn) >> (8 * d)) & 0xFF; \
+        _array_copyElement(_CARRAY_AT(dst, offsets[b]++, size), value, size); \
+      } \
+      void* tmp = src; \
+      src = dst; \
+      dst = tmp; \
+    } \
+    if (src != arr->data) memcpy(arr->data, src, num * size); \
+    if (scratch == NULL) allocator_free(arr->allocator, buffer); \
+    return 0; \
+  }
+
+#define _CARRAY_KEY_I32(value, keyFn) array_radixKeyI32(*(const int32_t*)(value))
+#define _CARRAY_KEY_U32(value, keyFn) (*(const uint32_t*)(value))
+#define _CARRAY_KEY_I64(value, keyFn) array_radixKeyI64(*(const int64_t*)(value))
+#define _CARRAY_KEY_U64(value, keyFn) (*(const uint64_t*)(value))
+#define _CARRAY_KEY_F32(value, keyFn) array_radixKeyF32(*(const float*)(value))
+#define _CARRAY_KEY_F64(value, keyFn) array_radixKeyF64(*(const double*)(value))
+#define _CARRAY_KEY_BY32(value, keyFn) ((uint32_t(*)(const void*))(keyFn))(value)
+#define _CARRAY_KEY_BY64(value, keyFn) ((uint64_t(*)(const void*))(keyFn))(value)
+
+_CARRAY_RADIX_DEFINE(I32, uint32_t, sizeof(int32_t), _CARRAY_KEY_I32)
+_CARRAY_RADIX_DEFINE(U32, uint32_t, sizeof(uint32_t), _CARRAY_KEY_U32)
+_CARRAY_RADIX_DEFINE(I64, uint64_t, sizeof(int64_t), _CARRAY_KEY_I64)
+_CARRAY_RADIX_DEFINE(U64, uint64_t, sizeof(uint64_t), _CARRAY_KEY_U64)
+_CARRAY_RADIX_DEFINE(F32, uint32_t, sizeof(float), _CARRAY_KEY_F32)
+_CARRAY_RADIX_DEFINE(F64, uint64_t, sizeof(double), _CARRAY_KEY_F64)
+_CARRAY_RADIX_DEFINE(By32, uint32_t, arr->type_size, _CARRAY_KEY_BY32)
+_CARRAY_RADIX_DEFINE(By64, uint64_t, arr->type_size, _CARRAY_KEY_BY64)
+
+int array_radixSortI32(array_t* arr, void* scratch) {
+  return _array_radixSortI32(arr, NULL, scratch);
+}
+
+int array_radixSortU32(array_t* arr, void* scratch) {
+  return _array_radixSortU32(arr, NULL, scratch);
+}
+
+int array_radixSortI64(array_t* arr, void* scratch) {
+  return _array_radixSortI64(arr, NULL, scratch);
+}
+
+int array_radixSortU64(array_t* arr, void* scratch) {
+  return _array_radixSortU64(arr, NULL, scratch);
+}
+
+int array_radixSortF32(array_t* arr, void* scratch) {
+  return _array_radixSortF32(arr, NULL, scratch);
+}
+
+int array_radixSortF64(array_t* arr, void* scratch) {
+  return _array_radixSortF64(arr, NULL, scratch);
+}
+
+int array_radixSortBy32(array_t* arr, uint32_t(*key)(const void* value), void* scratch) {
+  return _array_radixSortBy32(arr, (const void*)key, scratch);
+}
+
+int array_radixSortBy64(array_t* arr, uint64_t(*key)(const void* value), void* scratch) {
+  return _array_radixSortBy64(arr, (const void*)key, scratch);
+}
+
+size_t array_lowerBound(const array_t* arr, const void* value, ArrayCmpFn compare) {
+  size_t ts = arr->type_size;
+  size_t n = arr->size;
+  if (n == 0) return 0;
+  const unsigned char* base = arr->data;
+  // The halving step is a conditional move instead of a hard to predict branch
+  while (n > 1) {
+    size_t half = n / 2;
+    base = compare(base + half * ts, value) < 0 ? base + half * ts : base;
+    n -= half;
+  }
+  return (size_t)(base - (const unsigned char*)arr->data) / ts + (compare(base, value) < 0);
+}
+
+size_t array_upperBound(const array_t* arr, const void* value, ArrayCmpFn compare) {
+  size_t ts = arr->type_size;
+  size_t n = arr->size;
+  if (n == 0) return 0;
+  const unsigned char* base = arr->data;
+  while (n > 1) {
+    size_t half = n / 2;
+    base = compare(base + half * ts, value) <= 0 ? base + half * ts : base;
+    n -= half;
+  }
+  return (size_t)(base - (const unsigned char*)arr->data) / ts + (compare(base, value) <= 0);
+}
+
+long array_binarySearch(const array_t* arr, const void* value, ArrayCmpFn compare) {
+  size_t idx = array_lowerBound(arr, value, compare);
+  if (idx == arr->size || compare(array_get(arr, idx), value) != 0) return -1;
+  return (long)idx;
+}
+
+size_t array_equalRange(const array_t* arr, const void* value, ArrayCmpFn compare, size_t* outStart, size_t* outEnd) {
+  *outStart = array_lowerBound(arr, value, compare);
+  *outEnd = array_upperBound(arr, value, compare);
+  return *outEnd - *outStart;
+}
+
+/// Fills the subtree of node `k` (1-based) with the sorted elements starting at `i`
+size_t _array_eytzingerFill(const array_t* sorted, array_t* out, size_t i, size_t k) {
+  if (k > sorted->size) return i;
+  i = _array_eytzingerFill(sorted, out, i, 2 * k);
+  memcpy(array_get(out, k - 1), array_get(sorted, i), sorted->type_size);
+  return _array_eytzingerFill(sorted, out, i + 1, 2 * k + 1);
+}
+
+array_t* array_eytzingerCreate(const array_t* arr) {
+  array_t* out = array_createWithCapAndAllocator(arr->type_size, arr->size, arr->allocator);
+  if (out == NULL) return NULL;
+  if (out->cap < arr->size) {
+    array_destroy(out);
+    return NULL;
+  }
+  out->size = arr->size;
+  _array_eytzingerFill(arr, out, 0, 1);
+  return out;
+}
+
+/// Descends right past every element for which `compare(element, value) < bias`
+long _array_eytzingerBound(const array_t* eytzinger, const void* value, ArrayCmpFn compare, int bias) {
+  size_t n = eytzinger->size;
+  size_t ts = eytzinger->type_size;
+  const unsigned char* data = eytzinger->data;
+  size_t k = 1;
+  while (k <= n) {
+    // The 16 descendants four levels down are adjacent, fetch them early
+    if (16 * k <= n) __builtin_prefetch(data + (16 * k - 1) * ts);
+    k = 2 * k + (compare(data + (k - 1) * ts, value) < bias);
+  }
+  // Undo the right turns after the last left turn, that node is the answer
+  k >>= __builtin_ffsll(~(long long)k);
+  return k == 0 ? -1 : (long)(k - 1);
+}
+
+long array_eytzingerLowerBound(const array_t* eytzinger, const void* value, ArrayCmpFn compare) {
+  return _array_eytzingerBound(eytzinger, value, compare, 0);
+}
+
+long array_eytzingerUpperBound(const array_t* eytzinger, const void* value, ArrayCmpFn compare) {
+  return _array_eytzingerBound(eytzinger, value, compare, 1);
+}
+
+long array_eytzingerSearch(const array_t* eytzinger, const void* value, ArrayCmpFn compare) {
+  long idx = array_eytzingerLowerBound(eytzinger, value, compare);
+  if (idx < 0 || compare(array_get(eytzinger, idx), value) != 0) return -1;
+  return idx;
+}
+
+long array_eytzingerNext(const array_t* eytzinger, long idx) {
+  size_t n = eytzinger->size;
+  size_t k = (size_t)idx + 1;
+  if (2 * k + 1 <= n) {
+    // Leftmost node of the right subtree
+    k = 2 * k + 1;
+    while (2 * k <= n)
+      k *= 2;
+  } else {
+    // First ancestor this node is in the left subtree of
+    k >>= __builtin_ffsll(~(long long)k);
+  }
+  return k == 0 ? -1 : (long)(k - 1);
+}
+
+size_t array_eytzingerEqualRange(const array_t* eytzinger, const void* value, ArrayCmpFn compare, long* outStart, long* outEnd) {
+  *outStart = array_eytzingerLowerBound(eytzinger, value, compare);
+  *outEnd = array_eytzingerUpperBound(eytzinger, value, compare);
+  size_t count = 0;
+  for (long i = *outStart; i != *outEnd; i = array_eytzingerNext(eytzinger, i))
+    count++;
+  return count;
+}
+
+int array_insertSorted(array_t* arr, const void* value, ArrayCmpFn compare) {
+  return array_insert(arr, array_upperBound(arr, value, compare), value);
+}
+
+size_t array_uniqueSorted(array_t* arr, ArrayCmpFn compare) {
+  if (arr->size < 2) return arr->size;
+  size_t ts = arr->type_size;
+  size_t last = 0;
+  for (size_t i = 1; i < arr->size; i++) {
+    void* value = array_get(arr, i);
+    if (compare(array_get(arr, last), value) == 0) continue;
+    last++;
+    if (last != i) memcpy(array_get(arr, last), value, ts);
+  }
+  arr->size = last + 1;
+  return arr->size;
+}
+
+#define _CARRAY_SET_UNION 1
+#define _CARRAY_SET_INTERSECT 2
+#define _CARRAY_SET_DIFFERENCE 3
+#define _CARRAY_SET_MERGE 4
+
+/// Walks both sorted arrays once, copying what `op` keeps into a new array
+array_t* _array_setOperation(const array_t* a, const array_t* b, ArrayCmpFn compare, int op) {
+  size_t ts = a->type_size;
+  size_t cap = op == _CARRAY_SET_INTERSECT ? (a->size < b->size ? a->size : b->size)
+             : op == _CARRAY_SET_DIFFERENCE ? a->size
+             : a->size + b->size;
+  array_t* out = array_createWithCapAndAllocator(ts, cap, a->allocator);
+  if (out == NULL) return NULL;
+  if (out->cap < cap) {
+    array_destroy(out);
+    return NULL;
+  }
+  if (cap == 0) return out;
+
+  unsigned char* dst = out->data;
+  size_t i = 0, j = 0;
+  while (i < a->size && j < b->size) {
+    const void* x = array_get(a, i);
+    const void* y = array_get(b, j);
+    int c = compare(x, y);
+    if (op == _CARRAY_SET_MERGE) {
+      if (c <= 0) {
+        memcpy(dst, x, ts);
+        i++;
+      } else {
+        memcpy(dst, y, ts);
+        j++;
+      }
+      dst += ts;
+    } else if (c < 0) {
+      if (op != _CARRAY_SET_INTERSECT) {
+        memcpy(dst, x, ts);
+        dst += ts;
+      }
+      i++;
+    } else if (c > 0) {
+      if (op == _CARRAY_SET_UNION) {
+        memcpy(dst, y, ts);
+        dst += ts;
+      }
+      j++;
+    } else {
+      if (op != _CARRAY_SET_DIFFERENCE) {
+        memcpy(dst, x, ts);
+        dst += ts;
+      }
+      i++;
+      j++;
+    }
+  }
+  if (op != _CARRAY_SET_INTERSECT && i < a->size) {
+    memcpy(dst, array_get(a, i), (a->size - i) * ts);
+    dst += (a->size - i) * ts;
+  }
+  if ((op == _CARRAY_SET_UNION || op == _CARRAY_SET_MERGE) && j < b->size) {
+    memcpy(dst, array_get(b, j), (b->size - j) * ts);
+    dst += (b->size - j) * ts;
+  }
+  out->size = (size_t)(dst - (unsigned char*)out->data) / ts;
+  return out;
+}
+
+array_t* array_mergeSorted(const array_t* a, const array_t* b, ArrayCmpFn compare) {
+  return _array_setOperation(a, b, compare, _CARRAY_SET_MERGE);
+}
+
+array_t* array_intersectSorted(const array_t* a, const array_t* b, ArrayCmpFn compare) {
+  return _array_setOperation(a, b, compare, _CARRAY_SET_INTERSECT);
+}
+
+array_t* array_unionSorted(const array_t* a, const array_t* b, ArrayCmpFn compare) {
+  return _array_setOperation(a, b, compare, _CARRAY_SET_UNION);
+}
+
+array_t* array_differenceSorted(const array_t* a, const array_t* b, ArrayCmpFn compare) {
+  return _array_setOperation(a, b, compare, _CARRAY_SET_DIFFERENCE);
+}
+
+array_t* array_reverse(array_t* arr) {
+  for (size_t i = 0; i < arr->size / 2; i++) {
+    array_swap(arr, i, arr->size - i - 1);
+  }
+  return arr;
+}
+
+// == Numeric kernels ==
+
+#if defined(__x86_64__) && !defined(CARRAY_NO_SIMD)
+#define _CARRAY_X86 1
+#include <immintrin.h>
+#endif
+
+#define _CARRAY_SIMD_SCALAR 0
+#define _CARRAY_SIMD_SSE2 1
+#define _CARRAY_SIMD_AVX2 2
+
+int _array_cpuFeatures(void) {
+#ifdef _CARRAY_X86
+  static int features = -1;
+  if (features < 0) {
+    __builtin_cpu_init();
+    // SSE2 is part of x86-64
+    features = _CARRAY_CPU_SSE2
+      | (__builtin_cpu_supports("sse4.2") ? _CARRAY_CPU_SSE42 : 0)
+      | (__builtin_cpu_supports("popcnt") ? _CARRAY_CPU_POPCNT : 0)
+      | (__builtin_cpu_supports("avx2") ? _CARRAY_CPU_AVX2 : 0);
+  }
+  return features;
+#else
+  return 0;
+#endif
+}
+
+int _array_simdLevel(void) {
+  int features = _array_cpuFeatures();
+  if (features & _CARRAY_CPU_AVX2) return _CARRAY_SIMD_AVX2;
+  return (features & _CARRAY_CPU_SSE2) ? _CARRAY_SIMD_SSE2 : _CARRAY_SIMD_SCALAR;
+}
+
+// -- Scalar --
+
+#define _CARRAY_SCALAR_KERNELS(T, name, SumT) \
+  SumT _array_sum##name##_scalar(const T* p, size_t n, size_t i) { \
+    SumT sum = 0; \
+    for (; i < n; i++) sum += p[i]; \
+    return sum; \
+  } \
+  void _array_minMax##name##_scalar(const T* p, size_t n, size_t i, T* min, T* max) { \
+    for (; i < n; i++) { \
+      if (p[i] < *min) *min = p[i]; \
+      if (p[i] > *max) *max = p[i]; \
+    } \
+  } \
+  long _array_findFirstEq##name##_scalar(const T* p, size_t n, size_t i, T value) { \
+    for (; i < n; i++) \
+      if (p[i] == value) return (long)i; \
+    return -1; \
+  } \
+  size_t _array_countWhereGt##name##_scalar(const T* p, size_t n, size_t i, T value) { \
+    size_t count = 0; \
+    for (; i < n; i++) count += p[i] > value; \
+    return count; \
+  }
+
+// Integer sums wrap instead of overflowing
+_CARRAY_SCALAR_KERNELS(int32_t, I32, int64_t)
+_CARRAY_SCALAR_KERNELS(int64_t, I64, uint64_t)
+_CARRAY_SCALAR_KERNELS(float, F32, double)
+_CARRAY_SCALAR_KERNELS(double, F64, double)
+
+#ifdef _CARRAY_X86
+
+// -- SSE2 --
+
+int64_t _array_sumI32_sse2(const int32_t* p, size_t n) {
+  __m128i acc = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+    __m128i sign = _mm_srai_epi32(v, 31);
+    acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, sign));
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, sign));
+  }
+  int64_t lanes[2];
+  _mm_storeu_si128((__m128i*)lanes, acc);
+  return lanes[0] + lanes[1] + _array_sumI32_scalar(p, n, i);
+}
+
+uint64_t _array_sumI64_sse2(const int64_t* p, size_t n) {
+  __m128i acc = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+    acc = _mm_add_epi64(acc, _mm_loadu_si128((const __m128i*)(p + i)));
+  uint64_t lanes[2];
+  _mm_storeu_si128((__m128i*)lanes, acc);
+  return lanes[0] + lanes[1] + _array_sumI64_scalar(p, n, i);
+}
+
+double _array_sumF32_sse2(const float* p, size_t n) {
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(p + i);
+    acc0 = _mm_add_pd(acc0, _mm_cvtps_pd(v));
+    acc1 = _mm_add_pd(acc1, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+  return lanes[0] + lanes[1] + _array_sumF32_scalar(p, n, i);
+}
+
+double _array_sumF64_sse2(const double* p, size_t n) {
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc0 = _mm_add_pd(acc0, _mm_loadu_pd(p + i));
+    acc1 = _mm_add_pd(acc1, _mm_loadu_pd(p + i + 2));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+  return lanes[0] + lanes[1] + _array_sumF64_scalar(p, n, i);
+}
+
+/// SSE2 has no 32-bit integer min/max
+static inline __m128i _array_selectI32_sse2(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+void _array_minMaxI32_sse2(const int32_t* p, size_t n, int32_t* min, int32_t* max) {
+  size_t i = 0;
+  if (n >= 4) {
+    __m128i vmin = _mm_loadu_si128((const __m128i*)p);
+    __m128i vmax = vmin;
+    for (i = 4; i + 4 <= n; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+      vmin = _array_selectI32_sse2(_mm_cmplt_epi32(v, vmin), v, vmin);
+      vmax = _array_selectI32_sse2(_mm_cmpgt_epi32(v, vmax), v, vmax);
+    }
+    int32_t lmin[4], lmax[4];
+    _mm_storeu_si128((__m128i*)lmin, vmin);
+    _mm_storeu_si128((__m128i*)lmax, vmax);
+    _array_minMaxI32_scalar(lmin, 4, 0, min, max);
+    _array_minMaxI32_scalar(lmax, 4, 0, min, max);
+  }
+  _array_minMaxI32_scalar(p, n, i, min, max);
+}
+
+void _array_minMaxF32_sse2(const float* p, size_t n, float* min, float* max) {
+  // min/max return the second operand if either is NaN, so NaN in `v` never replaces a lane
+  __m128 vmin = _mm_set1_ps(*min);
+  __m128 vmax = _mm_set1_ps(*max);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(p + i);
+    vmin = _mm_min_ps(v, vmin);
+    vmax = _mm_max_ps(v, vmax);
+  }
+  float lmin[4], lmax[4];
+  _mm_storeu_ps(lmin, vmin);
+  _mm_storeu_ps(lmax, vmax);
+  _array_minMaxF32_scalar(lmin, 4, 0, min, max);
+  _array_minMaxF32_scalar(lmax, 4, 0, min, max);
+  _array_minMaxF32_scalar(p, n, i, min, max);
+}
+
+void _array_minMaxF64_sse2(const double* p, size_t n, double* min, double* max) {
+  // min/max return the second operand if either is NaN, so NaN in `v` never replaces a lane
+  __m128d vmin = _mm_set1_pd(*min);
+  __m128d vmax = _mm_set1_pd(*max);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d v = _mm_loadu_pd(p + i);
+    vmin = _mm_min_pd(v, vmin);
+    vmax = _mm_max_pd(v, vmax);
+  }
+  double lmin[2], lmax[2];
+  _mm_storeu_pd(lmin, vmin);
+  _mm_storeu_pd(lmax, vmax);
+  _array_minMaxF64_scalar(lmin, 2, 0, min, max);
+  _array_minMaxF64_scalar(lmax, 2, 0, min, max);
+  _array_minMaxF64_scalar(p, n, i, min, max);
+}
+
+long _array_findFirstEqI32_sse2(const int32_t* p, size_t n, int32_t value) {
+  __m128i needle = _mm_set1_epi32(value);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(p + i)), needle);
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+    if (mask) return (long)(i + __builtin_ctz(mask));
+  }
+  return _array_findFirstEqI32_scalar(p, n, i, value);
+}
+
+long _array_findFirstEqI64_sse2(const int64_t* p, size_t n, int64_t value) {
+  __m128i needle = _mm_set1_epi64x(value);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(p + i)), needle);
+    // Both 32-bit halves have to be equal
+    eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+    int mask = _mm_movemask_pd(_mm_castsi128_pd(eq));
+    if (mask) return (long)(i + __builtin_ctz(mask));
+  }
+  return _array_findFirstEqI64_scalar(p, n, i, value);
+}
+
+long _array_findFirstEqF32_sse2(const float* p, size_t n, float value) {
+  __m128 needle = _mm_set1_ps(value);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    int mask = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(p + i), needle));
+    if (mask) return (long)(i + __builtin_ctz(mask));
+  }
+  return _array_findFirstEqF32_scalar(p, n, i, value);
+}
+
+long _array_findFirstEqF64_sse2(const double* p, size_t n, double value) {
+  __m128d needle = _mm_set1_pd(value);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    int mask = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(p + i), needle));
+    if (mask) return (long)(i + __builtin_ctz(mask));
+  }
+  return _array_findFirstEqF64_scalar(p, n, i, value);
+}
+
+size_t _array_countWhereGtI32_sse2(const int32_t* p, size_t n, int32_t value) {
+  __m128i threshold = _mm_set1_epi32(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i gt = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(p + i)), threshold);
+    count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(gt)));
+  }
+  return count + _array_countWhereGtI32_scalar(p, n, i, value);
+}
+
+size_t _array_countWhereGtF32_sse2(const float* p, size_t n, float value) {
+  __m128 threshold = _mm_set1_ps(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    count += __builtin_popcount(_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(p + i), threshold)));
+  return count + _array_countWhereGtF32_scalar(p, n, i, value);
+}
+
+size_t _array_countWhereGtF64_sse2(const double* p, size_t n, double value) {
+  __m128d threshold = _mm_set1_pd(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+    count += __builtin_popcount(_mm_movemask_pd(_mm_cmpgt_pd(_mm_loadu_pd(p + i), threshold)));
+  return count + _array_countWhereGtF64_scalar(p, n, i, value);
+}
+
+// -- AVX2 --
+
+#define _CARRAY_AVX2 __attribute__((target("avx2")))
+
+_CARRAY_AVX2 int64_t _array_sumI32_avx2(const int32_t* p, size_t n) {
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+    acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+    acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+  }
+  int64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(acc0, acc1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + _array_sumI32_scalar(p, n, i);
+}
+
+_CARRAY_AVX2 uint64_t _array_sumI64_avx2(const int64_t* p, size_t n) {
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256((const __m256i*)(p + i)));
+    acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256((const __m256i*)(p + i + 4)));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(acc0, acc1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + _array_sumI64_scalar(p, n, i);
+}
+
+_CARRAY_AVX2 double _array_sumF32_avx2(const float* p, size_t n) {
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(p + i);
+    acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+    acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + _array_sumF32_scalar(p, n, i);
+}
+
+_CARRAY_AVX2 double _array_sumF64_avx2(const double* p, size_t n) {
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(p + i));
+    acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(p + i + 4));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + _array_sumF64_scalar(p, n, i);
+}
+
+_CARRAY_AVX2 void _array_minMaxI32_avx2(const int32_t* p, size_t n, int32_t* min, int32_t* max) {
+  size_t i = 0;
+  if (n >= 8) {
+    __m256i vmin = _mm256_loadu_si256((const __m256i*)p);
+    __m256i vmax = vmin;
+    for (i = 8; i + 8 <= n; i += 8) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+      vmin = _mm256_min_epi32(vmin, v);
+      vmax = _mm256_max_epi32(vmax, v);
+    }
+    int32_t lmin[8], lmax[8];
+    _mm256_storeu_si256((__m256i*)lmin, vmin);
+    _mm256_storeu_si256((__m256i*)lmax, vmax);
+    _array_minMaxI32_scalar(lmin, 8, 0, min, max);
+    _array_minMaxI32_scalar(lmax, 8, 0, min, max);
+  }
+  _array_minMaxI32_scalar(p, n, i, min, max);
+}
+
+_CARRAY_AVX2 void _array_minMaxI64_avx2(const int64_t* p, size_t n, int64_t* min, int64_t* max) {
+  size_t i = 0;
+  if (n >= 4) {
+    __m256i vmin = _mm256_loadu_si256((const __m256i*)p);
+    __m256i vmax = vmin;
+    for (i = 4; i + 4 <= n; i += 4) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+      vmin = _mm256_blendv_epi8(vmin, v, _mm256_cmpgt_epi64(vmin, v));
+      vmax = _mm256_blendv_epi8(vmax, v, _mm256_cmpgt_epi64(v, vmax));
+    }
+    int64_t lmin[4], lmax[4];
+    _mm256_storeu_si256((__m256i*)lmin, vmin);
+    _mm256_storeu_si256((__m256i*)lmax, vmax);
+    _array_minMaxI64_scalar(lmin, 4, 0, min, max);
+    _array_minMaxI64_scalar(lmax, 4, 0, min, max);
+  }
+  _array_minMaxI64_scalar(p, n, i, min, max);
+}
+
+_CARRAY_AVX2 void _array_minMaxF32_avx2(const float* p, size_t n, float* min, float* max) {
+  // min/max return the second operand if either is NaN, so NaN in `v` never replaces a lane
+  __m256 vmin = _mm256_set1_ps(*min);
+  __m256 vmax = _mm256_set1_ps(*max);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(p + i);
+    vmin = _mm256_min_ps(v, vmin);
+    vmax = _mm256_max_ps(v, vmax);
+  }
+  float lmin[8], lmax[8];
+  _mm256_storeu_ps(lmin, vmin);
+  _mm256_storeu_ps(lmax, vmax);
+  _array_minMaxF32_scalar(lmin, 8, 0, min, max);
+  _array_minMaxF32_scalar(lmax, 8, 0, min, max);
+  _array_minMaxF32_scalar(p, n, i, min, max);
+}
+
+_CARRAY_AVX2 void _array_minMaxF64_avx2(const double* p, size_t n, double* min, double* max) {
+  // min/max return the second operand if either is NaN, so NaN in `v` never replaces a lane
+  __m256d vmin = _mm256_set1_pd(*min);
+  __m256d vmax = _mm256_set1_pd(*max);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d v = _mm256_loadu_pd(p + i);
+    vmin = _mm256_min_pd(v, vmin);
+    vmax = _mm256_max_pd(v, vmax);
+  }
+  double lmin[4], lmax[4];
+  _mm256_storeu_pd(lmin, vmin);
+  _mm256_storeu_pd(lmax, vmax);
+  _array_minMaxF64_scalar(lmin, 4, 0, min, max);
+  _array_minMaxF64_scalar(lmax, 4, 0, min, max);
+  _array_minMaxF64_scalar(p, n, i, min, max);
+}
+
+_CARRAY_AVX2 long _array_findFirstEqI32_avx2(const int32_t* p, size_t n, int32_t value) {
+  __m256i needle = _mm256_set1_epi32(value);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(p + i)), needle);
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+    if (mask) return (long)(i + __builtin_ctz(mask));
+  }
+  return _array_findFirstEqI32_scalar(p, n, i, value);
+}
+
+_CARRAY_AVX2 long _array_findFirstEqI64_avx2(const int64_t* p, size_t n, int64_t value) {
+  __m256i needle = _mm256_set1_epi64x(value);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i eq = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(p + i)), needle);
+    int mask = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+    if (mask) return (long)(i + __builtin_ctz(mask));
+  }
+  return _array_findFirstEqI64_scalar(p, n, i, value);
+}
+
+_CARRAY_AVX2 long _array_findFirstEqF32_avx2(const float* p, size_t n, float value) {
+  __m256 needle = _mm256_set1_ps(value);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p + i), needle, _CMP_EQ_OQ));
+    if (mask) return (long)(i + __builtin_ctz(mask));
+  }
+  return _array_findFirstEqF32_scalar(p, n, i, value);
+}
+
+_CARRAY_AVX2 long _array_findFirstEqF64_avx2(const double* p, size_t n, double value) {
+  __m256d needle = _mm256_set1_pd(value);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p + i), needle, _CMP_EQ_OQ));
+    if (mask) return (long)(i + __builtin_ctz(mask));
+  }
+  return _array_findFirstEqF64_scalar(p, n, i, value);
+}
+
+_CARRAY_AVX2 size_t _array_countWhereGtI32_avx2(const int32_t* p, size_t n, int32_t value) {
+  __m256i threshold = _mm256_set1_epi32(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i gt = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(p + i)), threshold);
+    count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(gt)));
+  }
+  return count + _array_countWhereGtI32_scalar(p, n, i, value);
+}
+
+_CARRAY_AVX2 size_t _array_countWhereGtI64_avx2(const int64_t* p, size_t n, int64_t value) {
+  __m256i threshold = _mm256_set1_epi64x(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i gt = _mm256_cmpgt_epi64(_mm256_loadu_si256((const __m256i*)(p + i)), threshold);
+    count += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(gt)));
+  }
+  return count + _array_countWhereGtI64_scalar(p, n, i, value);
+}
+
+_CARRAY_AVX2 size_t _array_countWhereGtF32_avx2(const float* p, size_t n, float value) {
+  __m256 threshold = _mm256_set1_ps(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    count += __builtin_popcount(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p + i), threshold, _CMP_GT_OQ)));
+  return count + _array_countWhereGtF32_scalar(p, n, i, value);
+}
+
+_CARRAY_AVX2 size_t _array_countWhereGtF64_avx2(const double* p, size_t n, double value) {
+  __m256d threshold = _mm256_set1_pd(value);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    count += __builtin_popcount(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p + i), threshold, _CMP_GT_OQ)));
+  return count + _array_countWhereGtF64_scalar(p, n, i, value);
+}
+
+#endif // _CARRAY_X86
+
+// -- Dispatch --
+
+int64_t array_sumI32(const array_t* arr) {
+  const int32_t* p = (const int32_t*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_sumI32_avx2(p, arr->size);
+  return _array_sumI32_sse2(p, arr->size);
+#else
+  return _array_sumI32_scalar(p, arr->size, 0);
+#endif
+}
+
+int64_t array_sumI64(const array_t* arr) {
+  const int64_t* p = (const int64_t*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return (int64_t)_array_sumI64_avx2(p, arr->size);
+  return (int64_t)_array_sumI64_sse2(p, arr->size);
+#else
+  return (int64_t)_array_sumI64_scalar(p, arr->size, 0);
+#endif
+}
+
+double array_sumF32(const array_t* arr) {
+  const float* p = (const float*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_sumF32_avx2(p, arr->size);
+  return _array_sumF32_sse2(p, arr->size);
+#else
+  return _array_sumF32_scalar(p, arr->size, 0);
+#endif
+}
+
+double array_sumF64(const array_t* arr) {
+  const double* p = (const double*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_sumF64_avx2(p, arr->size);
+  return _array_sumF64_sse2(p, arr->size);
+#else
+  return _array_sumF64_scalar(p, arr->size, 0);
+#endif
+}
+
+int array_minMaxI32(const array_t* arr, int32_t* outMin, int32_t* outMax) {
+  if (arr->size == 0) return 1;
+  const int32_t* p = (const int32_t*)arr->data;
+  *outMin = p[0];
+  *outMax = p[0];
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    _array_minMaxI32_avx2(p, arr->size, outMin, outMax);
+  else
+    _array_minMaxI32_sse2(p, arr->size, outMin, outMax);
+#else
+  _array_minMaxI32_scalar(p, arr->size, 1, outMin, outMax);
+#endif
+  return 0;
+}
+
+int array_minMaxI64(const array_t* arr, int64_t* outMin, int64_t* outMax) {
+  if (arr->size == 0) return 1;
+  const int64_t* p = (const int64_t*)arr->data;
+  *outMin = p[0];
+  *outMax = p[0];
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    _array_minMaxI64_avx2(p, arr->size, outMin, outMax);
+  else
+    _array_minMaxI64_scalar(p, arr->size, 1, outMin, outMax);
+#else
+  _array_minMaxI64_scalar(p, arr->size, 1, outMin, outMax);
+#endif
+  return 0;
+}
+
+int array_minMaxF32(const array_t* arr, float* outMin, float* outMax) {
+  if (arr->size == 0) return 1;
+  const float* p = (const float*)arr->data;
+  *outMin = p[0];
+  *outMax = p[0];
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    _array_minMaxF32_avx2(p, arr->size, outMin, outMax);
+  else
+    _array_minMaxF32_sse2(p, arr->size, outMin, outMax);
+#else
+  _array_minMaxF32_scalar(p, arr->size, 1, outMin, outMax);
+#endif
+  return 0;
+}
+
+int array_minMaxF64(const array_t* arr, double* outMin, double* outMax) {
+  if (arr->size == 0) return 1;
+  const double* p = (const double*)arr->data;
+  *outMin = p[0];
+  *outMax = p[0];
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    _array_minMaxF64_avx2(p, arr->size, outMin, outMax);
+  else
+    _array_minMaxF64_sse2(p, arr->size, outMin, outMax);
+#else
+  _array_minMaxF64_scalar(p, arr->size, 1, outMin, outMax);
+#endif
+  return 0;
+}
+
+long array_findFirstEqI32(const array_t* arr, int32_t value) {
+  const int32_t* p = (const int32_t*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_findFirstEqI32_avx2(p, arr->size, value);
+  return _array_findFirstEqI32_sse2(p, arr->size, value);
+#else
+  return _array_findFirstEqI32_scalar(p, arr->size, 0, value);
+#endif
+}
+
+long array_findFirstEqI64(const array_t* arr, int64_t value) {
+  const int64_t* p = (const int64_t*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_findFirstEqI64_avx2(p, arr->size, value);
+  return _array_findFirstEqI64_sse2(p, arr->size, value);
+#else
+  return _array_findFirstEqI64_scalar(p, arr->size, 0, value);
+#endif
+}
+
+long array_findFirstEqF32(const array_t* arr, float value) {
+  const float* p = (const float*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_findFirstEqF32_avx2(p, arr->size, value);
+  return _array_findFirstEqF32_sse2(p, arr->size, value);
+#else
+  return _array_findFirstEqF32_scalar(p, arr->size, 0, value);
+#endif
+}
+
+long array_findFirstEqF64(const array_t* arr, double value) {
+  const double* p = (const double*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_findFirstEqF64_avx2(p, arr->size, value);
+  return _array_findFirstEqF64_sse2(p, arr->size, value);
+#else
+  return _array_findFirstEqF64_scalar(p, arr->size, 0, value);
+#endif
+}
+
+size_t array_countWhereGtI32(const array_t* arr, int32_t value) {
+  const int32_t* p = (const int32_t*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_countWhereGtI32_avx2(p, arr->size, value);
+  return _array_countWhereGtI32_sse2(p, arr->size, value);
+#else
+  return _array_countWhereGtI32_scalar(p, arr->size, 0, value);
+#endif
+}
+
+size_t array_countWhereGtI64(const array_t* arr, int64_t value) {
+  const int64_t* p = (const int64_t*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_countWhereGtI64_avx2(p, arr->size, value);
+  return _array_countWhereGtI64_scalar(p, arr->size, 0, value);
+#else
+  return _array_countWhereGtI64_scalar(p, arr->size, 0, value);
+#endif
+}
+
+size_t array_countWhereGtF32(const array_t* arr, float value) {
+  const float* p = (const float*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_countWhereGtF32_avx2(p, arr->size, value);
+  return _array_countWhereGtF32_sse2(p, arr->size, value);
+#else
+  return _array_countWhereGtF32_scalar(p, arr->size, 0, value);
+#endif
+}
+
+size_t array_countWhereGtF64(const array_t* arr, double value) {
+  const double* p = (const double*)arr->data;
+#ifdef _CARRAY_X86
+  if (_array_simdLevel() == _CARRAY_SIMD_AVX2)
+    return _array_countWhereGtF64_avx2(p, arr->size, value);
+  return _array_countWhereGtF64_sse2(p, arr->size, value);
+#else
+  return _array_countWhereGtF64_scalar(p, arr->size, 0, value);
+#endif
+}
+
+int array_cmpI32(const void* a, const void* b) {
+  int32_t x = *(const int32_t*)a;
+  int32_t y = *(const int32_t*)b;
+  return (x > y) - (x < y);
+}
+
+int array_cmpI64(const void* a, const void* b) {
+  int64_t x = *(const int64_t*)a;
+  int64_t y = *(const int64_t*)b;
+  return (x > y) - (x < y);
+}
+
+int array_cmpF32(const void* a, const void* b) {
+  float x = *(const float*)a;
+  float y = *(const float*)b;
+  return (x > y) - (x < y);
+}
+
+int array_cmpF64(const void* a, const void* b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+void array_addI32(const void* in, void* out) {
+  *(int32_t*)out = (int32_t)((uint32_t)*(int32_t*)out + (uint32_t)*(const int32_t*)in);
+}
+
+void array_addI64(const void* in, void* out) {
+  *(int64_t*)out = (int64_t)((uint64_t)*(int64_t*)out + (uint64_t)*(const int64_t*)in);
 }
 
 #endif
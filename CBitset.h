@@ -0,0 +1,418 @@
+#ifndef _CTYPES_BITSET_H
+#define _CTYPES_BITSET_H
+
+#include "CAllocator.h"
+#include "CArray.h"
+#include "CIterator.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Bits packed into 64 bit words, bit `i` is bit `i % 64` of word `i / 64`.
+/// Used as a selection vector: bit `i` says whether element `i` of an array is selected,
+/// selections of several predicates are combined with `bitset_and`/`bitset_or`/`bitset_andNot`
+/// and then applied with `array_gather` or `array_compress`.
+typedef struct Bitset {
+  /// Amount of bits
+  size_t size;
+  /// The bits after `size` in the last word are always 0
+  uint64_t* words;
+  /// Allocated words
+  size_t cap;
+  allocator_t* allocator;
+} bitset_t;
+
+typedef struct BitsetIterData {
+  const bitset_t* bitset;
+  /// The next word to load
+  size_t word;
+  /// The bits of the current word that haven't been yielded yet
+  uint64_t bits;
+  /// The last yielded index
+  size_t value;
+} bitsetiter_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// == Create ==
+/// Every bit is 0
+bitset_t* bitset_create(size_t size);
+/// The allocator must outlive the bitset
+bitset_t* bitset_createWithAllocator(size_t size, allocator_t* a);
+
+// == Destroy ==
+void bitset_destroy(bitset_t* bs);
+
+// == Bits ==
+
+static inline bool bitset_get(const bitset_t* bs, size_t idx) {
+  return (bs->words[idx / 64] >> (idx % 64)) & 1;
+}
+
+static inline void bitset_set(bitset_t* bs, size_t idx) {
+  bs->words[idx / 64] |= (uint64_t)1 << (idx % 64);
+}
+
+static inline void bitset_unset(bitset_t* bs, size_t idx) {
+  bs->words[idx / 64] &= ~((uint64_t)1 << (idx % 64));
+}
+
+/// Changes the amount of bits, new bits are 0
+/// Returns 1 if memory could not be allocated
+int bitset_resize(bitset_t* bs, size_t size);
+void bitset_setAll(bitset_t* bs);
+void bitset_unsetAll(bitset_t* bs);
+
+/// The amount of set bits
+size_t bitset_count(const bitset_t* bs);
+/// Returns the index of the first set bit at or after `from`, or -1
+long bitset_nextSet(const bitset_t* bs, size_t from);
+
+// == Combine ==
+// `src` should have the size of `dst`, extra bits of either are ignored
+
+/// `dst = dst & src`
+void bitset_and(bitset_t* dst, const bitset_t* src);
+/// `dst = dst | src`
+void bitset_or(bitset_t* dst, const bitset_t* src);
+/// `dst = dst & ~src`
+void bitset_andNot(bitset_t* dst, const bitset_t* src);
+
+// == Iterators ==
+
+/// Yields the indexes (`size_t`) of the set bits in ascending order
+iter_t* bitset_createIterator(const bitset_t* bs);
+/// Like `bitset_createIterator`, built in `storage`
+iter_t* bitset_initIterator(const bitset_t* bs, iterStorage_t* storage);
+
+/// Resizes `out` to the amount of values of `iter` and sets bit `i` if value `i` satisfies `where`.
+/// One bit per value instead of the `size_t` of `iter_findAllIndexes`
+/// Returns `out`, or NULL if memory could not be allocated
+bitset_t* iter_findAllBits(iter_t* iter, bitset_t* out, bool(*where)(const void*));
+
+// == Apply to arrays ==
+
+/// Pushes the elements of `arr` whose bit is set to `out`, in order
+/// `out` should have the type size of `arr`
+/// Returns 1 if memory could not be allocated
+int array_gather(const array_t* arr, const bitset_t* bs, array_t* out);
+/// Keeps the elements of `arr` whose bit is set, in order. Elements past the size of `bs` are removed
+/// Returns the new size
+size_t array_compress(array_t* arr, const bitset_t* bs);
+
+#ifdef CT_BITSET_IMPL
+
+#include <string.h>
+
+#if defined(__x86_64__) && !defined(CARRAY_NO_SIMD)
+#define _CBITSET_X86 1
+#include <immintrin.h>
+#define _CBITSET_AVX2 __attribute__((target("avx2,popcnt")))
+#endif
+
+_Static_assert(sizeof(bitsetiter_t) <= sizeof(((iterStorage_t*)0)->data), "bitsetiter_t has to fit into iterStorage_t");
+
+#define _CBITSET_WORDS(bits) (((bits) + 63) / 64)
+
+static inline bool _bitset_hasAvx2(void) {
+  int needed = _CARRAY_CPU_AVX2 | _CARRAY_CPU_POPCNT;
+  return (_array_cpuFeatures() & needed) == needed;
+}
+
+/// Clears the bits after `size` in the last word
+static inline void _bitset_trim(bitset_t* bs) {
+  if (bs->size % 64 != 0)
+    bs->words[bs->size / 64] &= ((uint64_t)1 << (bs->size % 64)) - 1;
+}
+
+/// Returns 1 if memory could not be allocated
+int _bitset_reserveWords(bitset_t* bs, size_t words) {
+  if (words <= bs->cap) return 0;
+  size_t cap = bs->cap * 2 > words ? bs->cap * 2 : words;
+  uint64_t* newWords = allocator_realloc(bs->allocator, bs->words, cap * sizeof(uint64_t));
+  if (newWords == NULL) return 1;
+  bs->words = newWords;
+  bs->cap = cap;
+  return 0;
+}
+
+bitset_t* bitset_create(size_t size) {
+  return bitset_createWithAllocator(size, NULL);
+}
+
+bitset_t* bitset_createWithAllocator(size_t size, allocator_t* a) {
+  bitset_t* bs = allocator_alloc(a, sizeof(bitset_t));
+  if (bs == NULL) return NULL;
+  bs->size = 0;
+  bs->words = NULL;
+  bs->cap = 0;
+  bs->allocator = a;
+  if (bitset_resize(bs, size) != 0) {
+    allocator_free(a, bs);
+    return NULL;
+  }
+  return bs;
+}
+
+void bitset_destroy(bitset_t* bs) {
+  allocator_free(bs->allocator, bs->words);
+  allocator_free(bs->allocator, bs);
+}
+
+int bitset_resize(bitset_t* bs, size_t size) {
+  size_t oldWords = _CBITSET_WORDS(bs->size);
+  size_t words = _CBITSET_WORDS(size);
+  if (_bitset_reserveWords(bs, words) != 0) return 1;
+  if (words > oldWords)
+    memset(bs->words + oldWords, 0, (words - oldWords) * sizeof(uint64_t));
+  bs->size = size;
+  _bitset_trim(bs);
+  return 0;
+}
+
+void bitset_setAll(bitset_t* bs) {
+  if (bs->size == 0) return;
+  memset(bs->words, 0xFF, _CBITSET_WORDS(bs->size) * sizeof(uint64_t));
+  _bitset_trim(bs);
+}
+
+void bitset_unsetAll(bitset_t* bs) {
+  if (bs->size == 0) return;
+  memset(bs->words, 0, _CBITSET_WORDS(bs->size) * sizeof(uint64_t));
+}
+
+size_t _bitset_count_scalar(const uint64_t* words, size_t n) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++)
+    count += (size_t)__builtin_popcountll(words[i]);
+  return count;
+}
+
+#ifdef _CBITSET_X86
+/// The same loop, with the popcnt instruction instead of a library call
+_CBITSET_AVX2 size_t _bitset_count_avx2(const uint64_t* words, size_t n) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++)
+    count += (size_t)__builtin_popcountll(words[i]);
+  return count;
+}
+#endif
+
+size_t bitset_count(const bitset_t* bs) {
+  size_t n = _CBITSET_WORDS(bs->size);
+#ifdef _CBITSET_X86
+  if (_bitset_hasAvx2()) return _bitset_count_avx2(bs->words, n);
+#endif
+  return _bitset_count_scalar(bs->words, n);
+}
+
+long bitset_nextSet(const bitset_t* bs, size_t from) {
+  if (from >= bs->size) return -1;
+  size_t w = from / 64;
+  uint64_t bits = bs->words[w] & (~(uint64_t)0 << (from % 64));
+  size_t n = _CBITSET_WORDS(bs->size);
+  while (bits == 0) {
+    if (++w == n) return -1;
+    bits = bs->words[w];
+  }
+  return (long)(w * 64 + (size_t)__builtin_ctzll(bits));
+}
+
+#define _CBITSET_BINARY_OP(name, EXPR, AVX2_EXPR) \
+  void _bitset_##name##_scalar(uint64_t* dst, const uint64_t* src, size_t n, size_t i) { \
+    for (; i < n; i++) { \
+      uint64_t a = dst[i], b = src[i]; \
+      dst[i] = (EXPR); \
+    } \
+  } \
+  _CBITSET_AVX2_OP(name, AVX2_EXPR) \
+  void bitset_##name(bitset_t* dst, const bitset_t* src) { \
+    size_t n = _CBITSET_WORDS(dst->size < src->size ? dst->size : src->size); \
+    _CBITSET_AVX2_DISPATCH(name) \
+    _bitset_##name##_scalar(dst->words, src->words, n, 0); \
+  }
+
+#ifdef _CBITSET_X86
+#define _CBITSET_AVX2_OP(name, AVX2_EXPR) \
+  _CBITSET_AVX2 void _bitset_##name##_avx2(uint64_t* dst, const uint64_t* src, size_t n) { \
+    size_t i = 0; \
+    for (; i + 4 <= n; i += 4) { \
+      __m256i a = _mm256_loadu_si256((const __m256i*)(dst + i)); \
+      __m256i b = _mm256_loadu_si256((const __m256i*)(src + i)); \
+      _mm256_storeu_si256((__m256i*)(dst + i), (AVX2_EXPR)); \
+    } \
+    _bitset_##name##_scalar(dst, src, n, i); \
+  }
+#define _CBITSET_AVX2_DISPATCH(name) \
+  if (_bitset_hasAvx2()) { \
+    _bitset_##name##_avx2(dst->words, src->words, n); \
+    return; \
+  }
+#else
+#define _CBITSET_AVX2_OP(name, AVX2_EXPR)
+#define _CBITSET_AVX2_DISPATCH(name)
+#endif
+
+_CBITSET_BINARY_OP(and, a & b, _mm256_and_si256(a, b))
+_CBITSET_BINARY_OP(or, a | b, _mm256_or_si256(a, b))
+_CBITSET_BINARY_OP(andNot, a & ~b, _mm256_andnot_si256(b, a))
+
+void* _bitsetiter_next(void* data) {
+  bitsetiter_t* iter = (bitsetiter_t*)data;
+  size_t n = _CBITSET_WORDS(iter->bitset->size);
+  while (iter->bits == 0) {
+    if (iter->word >= n) return NULL;
+    iter->bits = iter->bitset->words[iter->word++];
+  }
+  iter->value = (iter->word - 1) * 64 + (size_t)__builtin_ctzll(iter->bits);
+  // Clears the lowest set bit
+  iter->bits &= iter->bits - 1;
+  return &iter->value;
+}
+
+/// Decodes the set bits into `buf`, the bits that don't fit stay in `bits`
+size_t _bitsetiter_nextBatch(void* data, void** outSpan, void* buf, size_t max) {
+  bitsetiter_t* iter = (bitsetiter_t*)data;
+  size_t n = _CBITSET_WORDS(iter->bitset->size);
+  size_t* out = (size_t*)buf;
+  size_t count = 0;
+  while (count < max) {
+    if (iter->bits == 0) {
+      if (iter->word >= n) break;
+      iter->bits = iter->bitset->words[iter->word++];
+    }
+    size_t base = (iter->word - 1) * 64;
+    while (iter->bits != 0 && count < max) {
+      out[count++] = base + (size_t)__builtin_ctzll(iter->bits);
+      iter->bits &= iter->bits - 1;
+    }
+  }
+  *outSpan = buf;
+  return count;
+}
+
+iter_t* bitset_createIterator(const bitset_t* bs) {
+  iterStorage_t* storage = malloc(sizeof(iterStorage_t));
+  if (storage == NULL) return NULL;
+  iter_t* iter = bitset_initIterator(bs, storage);
+  iter->opt &= ~ITER_IN_PLACE;
+  iter->free = (void(*)(iter_t*)) free;
+  return iter;
+}
+
+iter_t* bitset_initIterator(const bitset_t* bs, iterStorage_t* storage) {
+  iter_t* iter = &storage->iter;
+  bitsetiter_t* data = (bitsetiter_t*)&storage->data;
+  data->bitset = bs;
+  data->word = 0;
+  data->bits = 0;
+  data->value = 0;
+
+  iter->opt = ITER_IN_PLACE;
+  iter->data = data;
+  iter->next = _bitsetiter_next;
+  iter->idx = NULL;
+  iter->known_size = 0;
+  iter->type_size = sizeof(size_t);
+  iter->contiguous_buffer = NULL;
+  iter->free = NULL;
+  iter->next_batch = _bitsetiter_nextBatch;
+  _CITERATOR_STATS_INIT(iter);
+  return iter;
+}
+
+bitset_t* iter_findAllBits(iter_t* iter, bitset_t* out, bool(*where)(const void*)) {
+  size_t expected = (iter->opt & ITER_KNOWNSIZE) ? iter->known_size : 0;
+  if (_bitset_reserveWords(out, _CBITSET_WORDS(expected)) != 0) return NULL;
+
+  // Bits are collected in `word` and stored once it is full
+  size_t n = 0;
+  uint64_t word = 0;
+  size_t max = iter->type_size <= CITERATOR_BATCH_BYTES ? CITERATOR_BATCH_BYTES / iter->type_size : 0;
+  _Alignas(16) unsigned char buf[CITERATOR_BATCH_BYTES];
+  void* span;
+  size_t count;
+  for (;;) {
+    if (max > 0) {
+      count = iter_nextBatch(iter, &span, buf, max);
+    } else {
+      span = iter_next(iter);
+      count = span != NULL;
+    }
+    if (count == 0) break;
+    for (size_t i = 0; i < count; i++) {
+      word |= (uint64_t)where(span + i * iter->type_size) << (n % 64);
+      if (++n % 64 == 0) {
+        if (_bitset_reserveWords(out, n / 64) != 0) return NULL;
+        out->words[n / 64 - 1] = word;
+        word = 0;
+      }
+    }
+  }
+  if (n % 64 != 0) {
+    if (_bitset_reserveWords(out, n / 64 + 1) != 0) return NULL;
+    out->words[n / 64] = word;
+  }
+  out->size = n;
+  return out;
+}
+
+int array_gather(const array_t* arr, const bitset_t* bs, array_t* out) {
+  size_t size = arr->size < bs->size ? arr->size : bs->size;
+  size_t ts = arr->type_size;
+  if (array_reserveAtLeast(out, out->size + bitset_count(bs)) != 0) return 1;
+  unsigned char* dst = (unsigned char*)out->data + out->size * ts;
+  const unsigned char* src = arr->data;
+  for (size_t w = 0; w < _CBITSET_WORDS(size); w++) {
+    uint64_t bits = bs->words[w];
+    // Bits past the end of `arr`
+    if (w == size / 64) bits &= ((uint64_t)1 << (size % 64)) - 1;
+    if (bits == ~(uint64_t)0) {
+      memcpy(dst, src + w * 64 * ts, 64 * ts);
+      dst += 64 * ts;
+      continue;
+    }
+    while (bits != 0) {
+      memcpy(dst, src + (w * 64 + (size_t)__builtin_ctzll(bits)) * ts, ts);
+      dst += ts;
+      bits &= bits - 1;
+    }
+  }
+  out->size = (size_t)(dst - (unsigned char*)out->data) / ts;
+  _CARRAY_STAT_SIZE(out);
+  return 0;
+}
+
+size_t array_compress(array_t* arr, const bitset_t* bs) {
+  size_t size = arr->size < bs->size ? arr->size : bs->size;
+  size_t ts = arr->type_size;
+  unsigned char* data = arr->data;
+  size_t kept = 0;
+  for (size_t w = 0; w < _CBITSET_WORDS(size); w++) {
+    uint64_t bits = bs->words[w];
+    if (w == size / 64) bits &= ((uint64_t)1 << (size % 64)) - 1;
+    // A full word with nothing removed before it stays where it is
+    if (bits == ~(uint64_t)0 && kept == w * 64) {
+      kept += 64;
+      continue;
+    }
+    while (bits != 0) {
+      size_t i = w * 64 + (size_t)__builtin_ctzll(bits);
+      if (i != kept) memcpy(data + kept * ts, data + i * ts, ts);
+      kept++;
+      bits &= bits - 1;
+    }
+  }
+  arr->size = kept;
+  return kept;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,372 @@
+#ifndef _CTYPES_DEQUE_H
+#define _CTYPES_DEQUE_H
+
+#include "CAllocator.h"
+#include "CArray.h"
+#include "CIterator.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifndef CDEQUE_DEFAULT_CAP
+#define CDEQUE_DEFAULT_CAP 16
+#endif
+
+/// Ring buffer with O(1) push and pop at both ends.
+/// Element `i` is stored at `(head + i) % cap`.
+typedef struct Deque {
+  size_t head;
+  size_t size;
+  size_t cap;
+  /// The size of the type stored in this deque
+  size_t type_size;
+  void* data;
+  /// Used for the deque and its data, `NULL` uses malloc/realloc/free
+  allocator_t* allocator;
+} deque_t;
+
+typedef struct DequeIterData {
+  deque_t* storage;
+  long idx;
+} dequeiter_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// == Create ==
+deque_t* deque_create(size_t type_size);
+/// The allocator must outlive the deque
+deque_t* deque_createWithAllocator(size_t type_size, allocator_t* a);
+deque_t* deque_createWithCap(size_t type_size, size_t cap);
+/// Takes over the data of `arr` without copying (unless it is stored inline or in a mapping), `arr` is destroyed
+/// (arrays initialized with `array_initInPlace` are left empty instead)
+deque_t* deque_fromArray(array_t* arr);
+
+// == Destroy ==
+void deque_destroy(deque_t* deque);
+
+// == Single value methods ==
+bool deque_hasIndex(const deque_t* deque, size_t idx);
+
+void* deque_get(const deque_t* deque, size_t idx);
+/// Returns `NULL` if the index doesn't exist
+void* deque_getChecked(const deque_t* deque, size_t idx);
+
+/// Returns NULL if size is 0
+void* deque_first(const deque_t* deque);
+/// Returns NULL if size is 0
+void* deque_last(const deque_t* deque);
+
+/// Copies the data of `value` to the deque
+void deque_set(deque_t* deque, size_t idx, const void* value);
+
+/// Returns 1 if memory could not be allocated
+int deque_pushBack(deque_t* deque, const void* value);
+/// Returns 1 if memory could not be allocated
+int deque_pushFront(deque_t* deque, const void* value);
+/// Remove the last element and store its value in `outData` (if `outData` is not NULL)
+/// Returns the new size or -1 if size is already 0
+long deque_popBack(deque_t* deque, void* outData);
+/// Remove the first element and store its value in `outData` (if `outData` is not NULL)
+/// Returns the new size or -1 if size is already 0
+long deque_popFront(deque_t* deque, void* outData);
+
+// == Memory ==
+
+/// Increases the capacity of the deque to the given capacity
+/// No check is performed on `newCap` > `deque->cap`
+/// Returns 1 if memory couldn't be allocated
+int deque_grow(deque_t* deque, size_t newCap);
+
+/// Returns 1 if memory couldn't be allocated
+int deque_reserveAtLeast(deque_t* deque, size_t newCap);
+
+void deque_reset(deque_t* deque);
+
+// == Contiguous access ==
+
+/// Returns the elements as (at most) two contiguous spans, `first` followed by `second`
+/// Returns the number of non-empty spans
+int deque_spans(const deque_t* deque, void** first, size_t* firstCount, void** second, size_t* secondCount);
+
+/// Rotates the buffer in place so that the elements start at index 0 of `data`
+void deque_makeContiguous(deque_t* deque);
+
+/// Converts the deque into an array using the same buffer, `deque` is destroyed
+/// Returns NULL if memory could not be allocated, `deque` is left untouched in that case
+array_t* deque_intoArray(deque_t* deque);
+
+iter_t* deque_createIterator(deque_t* deque);
+
+#ifdef CT_DEQUE_IMPL
+
+#include <string.h>
+
+size_t _deque_physical(const deque_t* deque, size_t idx) {
+  size_t p = deque->head + idx;
+  if (p >= deque->cap) p -= deque->cap;
+  return p;
+}
+
+int _deque_growIfNecessary(deque_t* deque) {
+  if (deque->cap == deque->size)
+    return deque_grow(deque, deque->cap == 0 ? CDEQUE_DEFAULT_CAP : deque->cap * 2);
+  return 0;
+}
+
+deque_t* deque_create(size_t type_size) {
+  return deque_createWithAllocator(type_size, NULL);
+}
+
+deque_t* deque_createWithAllocator(size_t type_size, allocator_t* a) {
+  deque_t* deque = allocator_alloc(a, sizeof(deque_t));
+  if (deque == NULL) return NULL;
+  memset(deque, 0, sizeof(deque_t));
+  deque->type_size = type_size;
+  deque->allocator = a;
+  return deque;
+}
+
+deque_t* deque_createWithCap(size_t type_size, size_t cap) {
+  deque_t* deque = deque_create(type_size);
+  if (deque == NULL) return NULL;
+  deque_grow(deque, cap);
+  return deque;
+}
+
+deque_t* deque_fromArray(array_t* arr) {
+  if (arr->opt & (ARRAY_MAPPED | ARRAY_HUGE)) {
+    // The deque can't realloc a mapping, it gets a copy of the elements
+    deque_t* deque = deque_createWithCap(arr->type_size, arr->size);
+    if (deque == NULL) return NULL;
+    if (deque->cap < arr->size) {
+      deque_destroy(deque);
+      return NULL;
+    }
+    if (arr->size > 0) memcpy(deque->data, arr->data, arr->size * arr->type_size);
+    deque->size = arr->size;
+    array_destroy(arr);
+    return deque;
+  }
+  // The deque needs a heap buffer it can realloc
+  if ((arr->opt & ARRAY_INLINE) && array_grow(arr, arr->cap) != 0) return NULL;
+  deque_t* deque = deque_createWithAllocator(arr->type_size, arr->allocator);
+  if (deque == NULL) return NULL;
+  deque->size = arr->size;
+  deque->cap = arr->cap;
+  deque->data = arr->data;
+  if (arr->opt & ARRAY_IN_PLACE) {
+    array_initInPlace(arr, arr->type_size, NULL, 0, arr->allocator);
+  } else {
+    allocator_free(arr->allocator, arr);
+  }
+  return deque;
+}
+
+void deque_destroy(deque_t* deque) {
+  allocator_free(deque->allocator, deque->data);
+  allocator_free(deque->allocator, deque);
+}
+
+bool deque_hasIndex(const deque_t* deque, size_t idx) {
+  return deque->size > idx;
+}
+
+void* deque_get(const deque_t* deque, size_t idx) {
+  return deque->data + _deque_physical(deque, idx) * deque->type_size;
+}
+
+void* deque_getChecked(const deque_t* deque, size_t idx) {
+  if (!deque_hasIndex(deque, idx)) return NULL;
+  return deque_get(deque, idx);
+}
+
+void* deque_first(const deque_t* deque) {
+  if (deque->size == 0) return NULL;
+  return deque_get(deque, 0);
+}
+
+void* deque_last(const deque_t* deque) {
+  if (deque->size == 0) return NULL;
+  return deque_get(deque, deque->size - 1);
+}
+
+void deque_set(deque_t* deque, size_t idx, const void* value) {
+  memcpy(deque_get(deque, idx), value, deque->type_size);
+}
+
+int deque_pushBack(deque_t* deque, const void* value) {
+  if (_deque_growIfNecessary(deque) != 0) return 1;
+  memcpy(deque_get(deque, deque->size), value, deque->type_size);
+  deque->size += 1;
+  return 0;
+}
+
+int deque_pushFront(deque_t* deque, const void* value) {
+  if (_deque_growIfNecessary(deque) != 0) return 1;
+  deque->head = deque->head == 0 ? deque->cap - 1 : deque->head - 1;
+  memcpy(deque->data + deque->head * deque->type_size, value, deque->type_size);
+  deque->size += 1;
+  return 0;
+}
+
+long deque_popBack(deque_t* deque, void* outData) {
+  if (deque->size == 0) return -1;
+  deque->size -= 1;
+  if (outData != NULL)
+    memcpy(outData, deque_get(deque, deque->size), deque->type_size);
+  return deque->size;
+}
+
+long deque_popFront(deque_t* deque, void* outData) {
+  if (deque->size == 0) return -1;
+  if (outData != NULL)
+    memcpy(outData, deque->data + deque->head * deque->type_size, deque->type_size);
+  deque->head = _deque_physical(deque, 1);
+  deque->size -= 1;
+  if (deque->size == 0) deque->head = 0;
+  return deque->size;
+}
+
+int deque_grow(deque_t* deque, size_t newCap) {
+  size_t oldCap = deque->cap;
+  void* data = allocator_realloc(deque->allocator, deque->data, newCap * deque->type_size);
+  if (data == NULL) return 1;
+  deque->data = data;
+  deque->cap = newCap;
+
+  if (deque->head + deque->size > oldCap) {
+    // The elements wrap around, move the smaller part into the new space
+    size_t ts = deque->type_size;
+    size_t tailCount = oldCap - deque->head;
+    size_t wrappedCount = deque->size - tailCount;
+    if (wrappedCount <= newCap - oldCap) {
+      memcpy(data + oldCap * ts, data, wrappedCount * ts);
+    } else {
+      size_t newHead = newCap - tailCount;
+      memmove(data + newHead * ts, data + deque->head * ts, tailCount * ts);
+      deque->head = newHead;
+    }
+  }
+  return 0;
+}
+
+int deque_reserveAtLeast(deque_t* deque, size_t newCap) {
+  if (deque->cap >= newCap) return 0;
+  return deque_grow(deque, newCap);
+}
+
+void deque_reset(deque_t* deque) {
+  deque->head = 0;
+  deque->size = 0;
+}
+
+int deque_spans(const deque_t* deque, void** first, size_t* firstCount, void** second, size_t* secondCount) {
+  size_t ts = deque->type_size;
+  if (deque->head + deque->size <= deque->cap) {
+    *first = deque->data + deque->head * ts;
+    *firstCount = deque->size;
+    *second = NULL;
+    *secondCount = 0;
+    return deque->size == 0 ? 0 : 1;
+  }
+  *first = deque->data + deque->head * ts;
+  *firstCount = deque->cap - deque->head;
+  *second = deque->data;
+  *secondCount = deque->size - *firstCount;
+  return 2;
+}
+
+void _deque_reverseElements(void* data, size_t ts, size_t from, size_t to) {
+  unsigned char tmp[ts];
+  while (from + 1 < to) {
+    void* a = data + from * ts;
+    void* b = data + (to - 1) * ts;
+    memcpy(tmp, a, ts);
+    memcpy(a, b, ts);
+    memcpy(b, tmp, ts);
+    from++;
+    to--;
+  }
+}
+
+void deque_makeContiguous(deque_t* deque) {
+  if (deque->head == 0) return;
+  size_t ts = deque->type_size;
+  if (deque->head + deque->size <= deque->cap) {
+    memmove(deque->data, deque->data + deque->head * ts, deque->size * ts);
+  } else {
+    // Rotate the whole buffer left by `head`
+    _deque_reverseElements(deque->data, ts, 0, deque->head);
+    _deque_reverseElements(deque->data, ts, deque->head, deque->cap);
+    _deque_reverseElements(deque->data, ts, 0, deque->cap);
+  }
+  deque->head = 0;
+}
+
+array_t* deque_intoArray(deque_t* deque) {
+  array_t* arr = array_createWithAllocator(deque->type_size, deque->allocator);
+  if (arr == NULL) return NULL;
+  deque_makeContiguous(deque);
+  arr->size = deque->size;
+  arr->cap = deque->cap;
+  arr->data = deque->data;
+  allocator_free(deque->allocator, deque);
+  return arr;
+}
+
+void* _dequeiter_next(void* data) {
+  dequeiter_t* iter = (dequeiter_t*)data;
+  return deque_getChecked(iter->storage, ++iter->idx);
+}
+
+/// Yields the two spans of a wrapped deque separately
+size_t _dequeiter_nextBatch(void* data, void** outSpan, void* buf, size_t max) {
+  dequeiter_t* iter = (dequeiter_t*)data;
+  deque_t* deque = iter->storage;
+  size_t start = (size_t)(iter->idx + 1);
+  if (start >= deque->size) return 0;
+  size_t p = _deque_physical(deque, start);
+  size_t count = deque->size - start;
+  if (p + count > deque->cap) count = deque->cap - p;
+  if (count > max) count = max;
+  *outSpan = deque->data + p * deque->type_size;
+  iter->idx += count;
+  return count;
+}
+
+iter_t* deque_createIterator(deque_t* deque) {
+  iter_t* iter = malloc(sizeof(iter_t) + sizeof(dequeiter_t));
+  if (iter == NULL) return NULL;
+  dequeiter_t* dequeiter = ((void*)iter) + sizeof(iter_t);
+
+  dequeiter->storage = deque;
+  dequeiter->idx = -1;
+
+  iter->opt = ITER_KNOWNSIZE | ITER_ENUMERATED;
+  iter->data = dequeiter;
+  iter->next = _dequeiter_next;
+  iter->type_size = deque->type_size;
+
+  iter->known_size = deque->size;
+  iter->idx = &dequeiter->idx;
+  iter->contiguous_buffer = NULL;
+  if (deque->head + deque->size <= deque->cap) {
+    iter->opt |= ITER_CONTIGUOUS;
+    iter->contiguous_buffer = deque->data + deque->head * deque->type_size;
+  }
+
+  iter->free = (void(*)(iter_t*)) free;
+  iter->next_batch = _dequeiter_nextBatch;
+  _CITERATOR_STATS_INIT(iter);
+
+  return iter;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
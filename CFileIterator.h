@@ -0,0 +1,318 @@
+#ifndef _CTYPES_FILEITERATOR_H
+#define _CTYPES_FILEITERATOR_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "CIterator.h"
+
+#ifndef CFILEITERATOR_BUFFER_BYTES
+/// Size of a read buffer, file iterators with read-ahead use two of them
+#define CFILEITERATOR_BUFFER_BYTES (1 << 20)
+#endif
+
+/// Pass as `record_size` to read records prefixed with their length
+#define FILEITER_LENGTH_PREFIXED 0
+
+enum FileIteratorFlags {
+  /// Reads the next buffer on a background thread while the current one is consumed
+  FILEITER_READ_AHEAD = 0b0001,
+};
+
+/// Value of length-prefixed file iterators.
+/// In the file every record is a `uint32_t` length (in native byte order) followed by that many bytes
+typedef struct FileRecord {
+  size_t size;
+  /// Points into the buffer of the iterator
+  const void* data;
+} fileRecord_t;
+
+typedef struct FileIterData {
+  int fd;
+  bool owns_fd;
+  /// 0 for length-prefixed records
+  size_t record_size;
+  /// Usable bytes of a buffer, a multiple of `record_size`
+  size_t buffer_bytes;
+  unsigned char* buffers[2];
+  /// Bytes of whole records in each buffer
+  size_t lengths[2];
+  /// Bytes of a partial record at the end of the last read, they start the next buffer
+  unsigned char* carry;
+  size_t carry_len;
+  /// Set by the reader once the file has been read completely
+  bool eof;
+
+  /// The buffer being consumed, -1 before the first one
+  int front;
+  size_t pos;
+  long idx;
+  fileRecord_t record;
+
+  bool read_ahead;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  /// Set by the reader thread, cleared by the consumer once it is done with a buffer
+  bool filled[2];
+  /// The reader thread has filled its last buffer
+  bool finished;
+  bool stop;
+} fileiter_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Iterates over the records in `fd`, starting at its current offset.
+/// Records are read through a reusable buffer and the values point into it,
+/// so a value is only valid until the next call to `iter_next` (`ITER_TRANSIENT`).
+/// Consumers that keep values, like `iter_max`, copy them. A copied `fileRecord_t` still points into the buffer.
+/// Fixed-size records are yielded as is, a partial record at the end of the file is ignored.
+/// Their amount is known (`ITER_KNOWNSIZE`) if `fd` is a regular file.
+/// With `FILEITER_LENGTH_PREFIXED` the values are `fileRecord_t`, records larger than a buffer end the iteration.
+/// `fd` is not closed by the iterator.
+/// Returns NULL if memory could not be allocated
+iter_t* iter_fromFd(int fd, size_t record_size, int flags);
+/// Like `iter_fromFd`, the file is closed when the iterator is destroyed
+/// Returns NULL if the file could not be opened
+iter_t* iter_fromFile(const char* path, size_t record_size, int flags);
+
+#ifdef CT_FILEITERATOR_IMPL
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// Bytes of whole records at the start of `buf`
+size_t _fileiter_completeBytes(const fileiter_t* fi, const unsigned char* buf, size_t len) {
+  if (fi->record_size != FILEITER_LENGTH_PREFIXED)
+    return len - len % fi->record_size;
+  size_t pos = 0;
+  while (len - pos >= sizeof(uint32_t)) {
+    uint32_t size;
+    memcpy(&size, buf + pos, sizeof(uint32_t));
+    if (len - pos - sizeof(uint32_t) < size) break;
+    pos += sizeof(uint32_t) + size;
+  }
+  return pos;
+}
+
+/// Fills `buf` with whole records, sets `eof` once nothing more can be read
+/// Returns the amount of bytes of whole records
+size_t _fileiter_fill(fileiter_t* fi, unsigned char* buf) {
+  size_t len = fi->carry_len;
+  memcpy(buf, fi->carry, len);
+  while (len < fi->buffer_bytes) {
+    ssize_t r = read(fi->fd, buf + len, fi->buffer_bytes - len);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) {
+      fi->eof = true;
+      break;
+    }
+    len += (size_t)r;
+  }
+  size_t complete = _fileiter_completeBytes(fi, buf, len);
+  // A full buffer without a whole record holds a record that can never fit
+  if (complete == 0 && len == fi->buffer_bytes) fi->eof = true;
+  fi->carry_len = len - complete;
+  memcpy(fi->carry, buf + complete, fi->carry_len);
+  return complete;
+}
+
+void* _fileiter_reader(void* arg) {
+  fileiter_t* fi = (fileiter_t*)arg;
+  for (int i = 0;; i ^= 1) {
+    pthread_mutex_lock(&fi->mutex);
+    while (fi->filled[i] && !fi->stop)
+      pthread_cond_wait(&fi->cond, &fi->mutex);
+    bool stop = fi->stop;
+    pthread_mutex_unlock(&fi->mutex);
+    if (stop) break;
+
+    size_t length = _fileiter_fill(fi, fi->buffers[i]);
+
+    pthread_mutex_lock(&fi->mutex);
+    fi->lengths[i] = length;
+    fi->filled[i] = true;
+    fi->finished = fi->eof;
+    pthread_cond_broadcast(&fi->cond);
+    pthread_mutex_unlock(&fi->mutex);
+    if (fi->eof) break;
+  }
+  return NULL;
+}
+
+/// Moves to the next buffer with records
+/// Returns false at the end of the file
+bool _fileiter_advance(fileiter_t* fi) {
+  if (!fi->read_ahead) {
+    do {
+      if (fi->eof) return false;
+      fi->front = 0;
+      fi->lengths[0] = _fileiter_fill(fi, fi->buffers[0]);
+    } while (fi->lengths[0] == 0);
+    fi->pos = 0;
+    return true;
+  }
+
+  pthread_mutex_lock(&fi->mutex);
+  do {
+    // Hand the consumed buffer back to the reader
+    if (fi->front >= 0) {
+      fi->filled[fi->front] = false;
+      pthread_cond_broadcast(&fi->cond);
+    }
+    fi->front = fi->front < 0 ? 0 : fi->front ^ 1;
+    while (!fi->filled[fi->front] && !fi->finished)
+      pthread_cond_wait(&fi->cond, &fi->mutex);
+    if (!fi->filled[fi->front]) {
+      pthread_mutex_unlock(&fi->mutex);
+      return false;
+    }
+  } while (fi->lengths[fi->front] == 0);
+  pthread_mutex_unlock(&fi->mutex);
+  fi->pos = 0;
+  return true;
+}
+
+bool _fileiter_hasRecord(fileiter_t* fi) {
+  if (fi->front >= 0 && fi->pos < fi->lengths[fi->front]) return true;
+  return _fileiter_advance(fi);
+}
+
+void* _fileiter_next(void* data) {
+  fileiter_t* fi = (fileiter_t*)data;
+  if (!_fileiter_hasRecord(fi)) return NULL;
+  unsigned char* value = fi->buffers[fi->front] + fi->pos;
+  fi->idx++;
+  if (fi->record_size != FILEITER_LENGTH_PREFIXED) {
+    fi->pos += fi->record_size;
+    return value;
+  }
+  uint32_t size;
+  memcpy(&size, value, sizeof(uint32_t));
+  fi->record.size = size;
+  fi->record.data = value + sizeof(uint32_t);
+  fi->pos += sizeof(uint32_t) + size;
+  return &fi->record;
+}
+
+/// Yields the whole records left in the current buffer
+size_t _fileiter_nextBatch(void* data, void** outSpan, void* buf, size_t max) {
+  (void)buf;
+  fileiter_t* fi = (fileiter_t*)data;
+  if (!_fileiter_hasRecord(fi)) return 0;
+  size_t count = (fi->lengths[fi->front] - fi->pos) / fi->record_size;
+  if (count > max) count = max;
+  *outSpan = fi->buffers[fi->front] + fi->pos;
+  fi->pos += count * fi->record_size;
+  fi->idx += count;
+  return count;
+}
+
+void _fileiter_free(iter_t* iter) {
+  fileiter_t* fi = (fileiter_t*)iter->data;
+  if (fi->read_ahead) {
+    pthread_mutex_lock(&fi->mutex);
+    fi->stop = true;
+    pthread_cond_broadcast(&fi->cond);
+    pthread_mutex_unlock(&fi->mutex);
+    pthread_join(fi->thread, NULL);
+    pthread_mutex_destroy(&fi->mutex);
+    pthread_cond_destroy(&fi->cond);
+  }
+  if (fi->owns_fd) close(fi->fd);
+  free(fi->buffers[0]);
+  free(iter);
+}
+
+iter_t* iter_fromFd(int fd, size_t record_size, int flags) {
+  iter_t* iter = malloc(sizeof(iter_t) + sizeof(fileiter_t));
+  if (iter == NULL) return NULL;
+  fileiter_t* fi = ((void*)iter) + sizeof(iter_t);
+  memset(fi, 0, sizeof(fileiter_t));
+
+  fi->fd = fd;
+  fi->record_size = record_size;
+  fi->buffer_bytes = CFILEITERATOR_BUFFER_BYTES;
+  if (record_size != FILEITER_LENGTH_PREFIXED) {
+    fi->buffer_bytes -= fi->buffer_bytes % record_size;
+    if (fi->buffer_bytes == 0) fi->buffer_bytes = record_size;
+  }
+  fi->read_ahead = flags & FILEITER_READ_AHEAD;
+  fi->front = -1;
+  fi->idx = -1;
+
+  // The two buffers and the carry share one allocation
+  int bufferCount = fi->read_ahead ? 2 : 1;
+  unsigned char* memory = malloc((bufferCount + 1) * fi->buffer_bytes);
+  if (memory == NULL) {
+    free(iter);
+    return NULL;
+  }
+  fi->buffers[0] = memory;
+  fi->buffers[1] = fi->read_ahead ? memory + fi->buffer_bytes : NULL;
+  fi->carry = memory + bufferCount * fi->buffer_bytes;
+
+  iter->opt = ITER_ENUMERATED | ITER_TRANSIENT;
+  iter->kept = NULL;
+  iter->data = fi;
+  iter->next = _fileiter_next;
+  iter->idx = &fi->idx;
+  iter->known_size = 0;
+  iter->contiguous_buffer = NULL;
+  iter->free = _fileiter_free;
+  iter->type_size = record_size;
+  iter->next_batch = _fileiter_nextBatch;
+  _CITERATOR_STATS_INIT(iter);
+
+  if (record_size == FILEITER_LENGTH_PREFIXED) {
+    iter->type_size = sizeof(fileRecord_t);
+    iter->next_batch = NULL;
+  } else {
+    struct stat st;
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && offset >= 0 && st.st_size >= offset) {
+      iter->opt |= ITER_KNOWNSIZE;
+      iter->known_size = (size_t)(st.st_size - offset) / record_size;
+    }
+  }
+
+  if (fi->read_ahead) {
+    pthread_mutex_init(&fi->mutex, NULL);
+    pthread_cond_init(&fi->cond, NULL);
+    if (pthread_create(&fi->thread, NULL, _fileiter_reader, fi) != 0) {
+      // Read on the calling thread instead
+      pthread_mutex_destroy(&fi->mutex);
+      pthread_cond_destroy(&fi->cond);
+      fi->read_ahead = false;
+    }
+  }
+
+  return iter;
+}
+
+iter_t* iter_fromFile(const char* path, size_t record_size, int flags) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return NULL;
+  iter_t* iter = iter_fromFd(fd, record_size, flags);
+  if (iter == NULL) {
+    close(fd);
+    return NULL;
+  }
+  ((fileiter_t*)iter->data)->owns_fd = true;
+  return iter;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
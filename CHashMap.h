@@ -0,0 +1,626 @@
+#ifndef _CTYPES_HASHMAP_H
+#define _CTYPES_HASHMAP_H
+
+#include "CAllocator.h"
+#include "CArray.h"
+#include "CIterator.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Amount of control bytes probed at once
+#define CHASHMAP_GROUP 16
+/// The smallest capacity, so that a probed group never wraps more than once
+#define CHASHMAP_MIN_CAP CHASHMAP_GROUP
+
+typedef size_t(*HashMapHashFn)(const void* key);
+typedef bool(*HashMapEqFn)(const void* a, const void* b);
+/// Writes the group key of `value` to `outKey`
+typedef void(*GroupKeyFn)(const void* value, void* outKey);
+
+#ifndef CHASHMAP_GROUP_BUDGET
+/// Bytes the table of `iter_groupReduce` may use before new keys are spilled into partitions,
+/// about the size of an L2 cache
+#define CHASHMAP_GROUP_BUDGET (1 << 20)
+#endif
+/// Spilled values are split into `1 << CHASHMAP_PARTITION_BITS` partitions by their hash
+#define CHASHMAP_PARTITION_BITS 6
+
+#define _CHASHMAP_ALIGN_UP(n, align) (((n) + (align) - 1) & ~((size_t)(align) - 1))
+
+static inline size_t _hashmap_alignOf(size_t size) {
+  if (size >= 16) return 16;
+  if (size >= 8) return 8;
+  if (size >= 4) return 4;
+  if (size >= 2) return 2;
+  return 1;
+}
+
+/// Open-addressing hash map with linear probing.
+/// Every slot has a control byte, which is either empty or holds 7 bits of the key's hash,
+/// so a lookup compares 16 slots at once and only calls `eq` on likely matches.
+/// Removal shifts the following entries back instead of leaving tombstones.
+///
+/// Entries are stored as the key followed by the (aligned) value.
+typedef struct HashMap {
+  size_t size;
+  /// Amount of slots, 0 or a power of 2
+  size_t cap;
+  size_t key_size;
+  size_t value_size;
+  /// Offset of the value in an entry
+  size_t value_offset;
+  size_t entry_size;
+  /// `cap` control bytes, followed by a copy of the first `CHASHMAP_GROUP`
+  uint8_t* ctrl;
+  void* entries;
+  /// `NULL` hashes the bytes of the key
+  HashMapHashFn hash;
+  /// `NULL` compares the bytes of the keys
+  HashMapEqFn eq;
+  /// Used for the map and its data, `NULL` uses malloc/realloc/free
+  allocator_t* allocator;
+} hashmap_t;
+
+typedef struct GroupReduceOptions {
+  /// `NULL` hashes the bytes of the key
+  HashMapHashFn hash;
+  /// `NULL` compares the bytes of the keys
+  HashMapEqFn eq;
+  /// Bytes the table may use before new keys are spilled into partitions, 0 never spills
+  size_t budget;
+  /// Used for the table, the partitions and the result, `NULL` uses malloc/realloc/free
+  allocator_t* allocator;
+} groupReduceOptions_t;
+
+typedef struct HashMapIterData {
+  hashmap_t* map;
+  size_t slot;
+} hashmapiter_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// == Create ==
+/// `hash` and `eq` can be `NULL` to hash and compare the bytes of the keys (padding included)
+hashmap_t* hashmap_create(size_t key_size, size_t value_size, HashMapHashFn hash, HashMapEqFn eq);
+/// The allocator must outlive the map
+hashmap_t* hashmap_createWithAllocator(size_t key_size, size_t value_size, HashMapHashFn hash, HashMapEqFn eq, allocator_t* a);
+
+// == Destroy ==
+void hashmap_destroy(hashmap_t* map);
+
+// == Access ==
+
+/// Returns a pointer to the value of `key` or `NULL`
+void* hashmap_get(const hashmap_t* map, const void* key);
+bool hashmap_contains(const hashmap_t* map, const void* key);
+
+/// Copies `key` and `value` into the map, replacing the value if `key` already exists
+/// Returns 1 if memory could not be allocated
+int hashmap_put(hashmap_t* map, const void* key, const void* value);
+
+/// Returns a pointer to the value of `key`, inserting `key` with a zeroed value if it doesn't exist.
+/// `outInserted` (if not NULL) is set to whether `key` was inserted
+/// Returns NULL if memory could not be allocated
+void* hashmap_getOrPut(hashmap_t* map, const void* key, bool* outInserted);
+
+/// Removes `key` and stores its value in `outValue` (if `outValue` is not NULL)
+/// Returns false if `key` doesn't exist
+bool hashmap_remove(hashmap_t* map, const void* key, void* outValue);
+
+// == Memory ==
+
+/// Makes room for at least `count` entries without rehashing
+/// Returns 1 if memory couldn't be allocated
+int hashmap_reserve(hashmap_t* map, size_t count);
+
+/// Removes all entries, but keeps the capacity
+void hashmap_reset(hashmap_t* map);
+
+// == Entries ==
+
+static inline void* hashmap_entryKey(const hashmap_t* map, const void* entry) {
+  (void)map;
+  return (void*)entry;
+}
+
+static inline void* hashmap_entryValue(const hashmap_t* map, const void* entry) {
+  return (unsigned char*)entry + map->value_offset;
+}
+
+/// Yields the entries of the map in no particular order, see `hashmap_entryKey` and `hashmap_entryValue`
+/// The map must not be modified while iterating
+iter_t* hashmap_createIterator(hashmap_t* map);
+
+// == Aggregation ==
+
+/// Offset of the value in an entry of a map, and of the accumulator in a record of `iter_groupReduce`
+static inline size_t hashmap_valueOffset(size_t key_size, size_t value_size) {
+  return _CHASHMAP_ALIGN_UP(key_size, _hashmap_alignOf(value_size));
+}
+
+/// Aggregates the values of `iter` by key in one pass over a hash table. `keyFn` extracts the key
+/// of every value, the first value of a key gets an accumulator initialized with `init` (zeroed if NULL),
+/// then `reduce` folds every value of the key into it.
+/// Returns an array of records (the key, followed by the accumulator at `hashmap_valueOffset`)
+/// in no particular order, or NULL if memory could not be allocated.
+/// Once the table outgrows `CHASHMAP_GROUP_BUDGET`, values of new keys are split into partitions by hash
+/// and every partition is aggregated on its own afterwards, so the table stays in cache.
+/// With `ITER_KNOWNSIZE` the table is sized for `known_size` keys up front (within the budget).
+/// Keys are hashed and compared by their bytes, `keyFn` has to write all `key_size` of them
+array_t* iter_groupReduce(iter_t* iter, GroupKeyFn keyFn, size_t key_size, size_t acc_size,
+  void(*init)(void* acc), void(*reduce)(const void* in, void* acc));
+/// `opt` can be NULL for the defaults of `iter_groupReduce`, its `hash` and `eq` replace the byte-wise ones
+array_t* iter_groupReduceWithOptions(iter_t* iter, GroupKeyFn keyFn, size_t key_size, size_t acc_size,
+  void(*init)(void* acc), void(*reduce)(const void* in, void* acc), const groupReduceOptions_t* opt);
+
+// == Hash functions ==
+
+size_t hashmap_hashBytes(const void* data, size_t len);
+size_t hashmap_hashU32(const void* key);
+size_t hashmap_hashU64(const void* key);
+/// For keys of type `char*`
+size_t hashmap_hashString(const void* key);
+bool hashmap_eqU32(const void* a, const void* b);
+bool hashmap_eqU64(const void* a, const void* b);
+/// For keys of type `char*`
+bool hashmap_eqString(const void* a, const void* b);
+
+#ifdef CT_HASHMAP_IMPL
+
+#include <string.h>
+
+#if defined(__SSE2__) && !defined(CHASHMAP_NO_SIMD)
+#include <emmintrin.h>
+#define _CHASHMAP_SSE2 1
+#endif
+
+#define _CHASHMAP_EMPTY 0x80
+
+/// Bitmask of the control bytes in the group starting at `ctrl` that equal `byte`
+static inline uint32_t _hashmap_match(const uint8_t* ctrl, uint8_t byte) {
+#ifdef _CHASHMAP_SSE2
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)byte)));
+#else
+  uint32_t mask = 0;
+  for (int i = 0; i < CHASHMAP_GROUP; i++)
+    mask |= (uint32_t)(ctrl[i] == byte) << i;
+  return mask;
+#endif
+}
+
+/// Mixes the user hash, so that weak hashes (like the identity) still spread over the slots
+static inline size_t _hashmap_hash(const hashmap_t* map, const void* key) {
+  uint64_t h = map->hash != NULL ? (uint64_t)map->hash(key) : (uint64_t)hashmap_hashBytes(key, map->key_size);
+  h ^= h >> 32;
+  h *= 0x9E3779B97F4A7C15ull;
+  h ^= h >> 29;
+  return (size_t)h;
+}
+
+static inline uint8_t _hashmap_h2(size_t hash) {
+  return (uint8_t)(hash & 0x7F);
+}
+
+static inline size_t _hashmap_home(const hashmap_t* map, size_t hash) {
+  return (hash >> 7) & (map->cap - 1);
+}
+
+static inline void* _hashmap_entry(const hashmap_t* map, size_t slot) {
+  return (unsigned char*)map->entries + slot * map->entry_size;
+}
+
+static inline bool _hashmap_eq(const hashmap_t* map, const void* a, const void* b) {
+  if (map->eq != NULL) return map->eq(a, b);
+  return memcmp(a, b, map->key_size) == 0;
+}
+
+static inline void _hashmap_setCtrl(hashmap_t* map, size_t slot, uint8_t byte) {
+  map->ctrl[slot] = byte;
+  if (slot < CHASHMAP_GROUP) map->ctrl[map->cap + slot] = byte;
+}
+
+/// Returns the slot of `key` or -1
+long _hashmap_find(const hashmap_t* map, const void* key, size_t hash) {
+  if (map->size == 0) return -1;
+  size_t mask = map->cap - 1;
+  uint8_t h2 = _hashmap_h2(hash);
+  size_t slot = _hashmap_home(map, hash);
+  for (;;) {
+    const uint8_t* group = map->ctrl + slot;
+    for (uint32_t m = _hashmap_match(group, h2); m != 0; m &= m - 1) {
+      size_t candidate = (slot + __builtin_ctz(m)) & mask;
+      if (_hashmap_eq(map, _hashmap_entry(map, candidate), key)) return (long)candidate;
+    }
+    // With linear probing the key can't be after an empty slot
+    if (_hashmap_match(group, _CHASHMAP_EMPTY) != 0) return -1;
+    slot = (slot + CHASHMAP_GROUP) & mask;
+  }
+}
+
+/// Returns the first empty slot starting at the home slot of `hash`, there has to be one
+size_t _hashmap_findEmpty(const hashmap_t* map, size_t hash) {
+  size_t mask = map->cap - 1;
+  size_t slot = _hashmap_home(map, hash);
+  for (;;) {
+    uint32_t m = _hashmap_match(map->ctrl + slot, _CHASHMAP_EMPTY);
+    if (m != 0) return (slot + __builtin_ctz(m)) & mask;
+    slot = (slot + CHASHMAP_GROUP) & mask;
+  }
+}
+
+/// Maps are kept at most 3/4 full, so probe sequences stay short
+static inline size_t _hashmap_maxSize(size_t cap) {
+  return cap - cap / 4;
+}
+
+static inline size_t _hashmap_entrySize(size_t key_size, size_t value_size) {
+  size_t keyAlign = _hashmap_alignOf(key_size);
+  size_t valueAlign = _hashmap_alignOf(value_size);
+  return _CHASHMAP_ALIGN_UP(hashmap_valueOffset(key_size, value_size) + value_size, keyAlign > valueAlign ? keyAlign : valueAlign);
+}
+
+int _hashmap_rehash(hashmap_t* map, size_t newCap) {
+  size_t ctrlBytes = _CHASHMAP_ALIGN_UP(newCap + CHASHMAP_GROUP, 16);
+  uint8_t* ctrl = allocator_alloc(map->allocator, ctrlBytes + newCap * map->entry_size);
+  if (ctrl == NULL) return 1;
+  memset(ctrl, _CHASHMAP_EMPTY, newCap + CHASHMAP_GROUP);
+
+  hashmap_t old = *map;
+  map->cap = newCap;
+  map->ctrl = ctrl;
+  map->entries = ctrl + ctrlBytes;
+  for (size_t slot = 0; slot < old.cap; slot++) {
+    if (old.ctrl[slot] & _CHASHMAP_EMPTY) continue;
+    void* entry = _hashmap_entry(&old, slot);
+    size_t hash = _hashmap_hash(map, entry);
+    size_t newSlot = _hashmap_findEmpty(map, hash);
+    _hashmap_setCtrl(map, newSlot, _hashmap_h2(hash));
+    memcpy(_hashmap_entry(map, newSlot), entry, map->entry_size);
+  }
+  allocator_free(map->allocator, old.ctrl);
+  return 0;
+}
+
+hashmap_t* hashmap_create(size_t key_size, size_t value_size, HashMapHashFn hash, HashMapEqFn eq) {
+  return hashmap_createWithAllocator(key_size, value_size, hash, eq, NULL);
+}
+
+hashmap_t* hashmap_createWithAllocator(size_t key_size, size_t value_size, HashMapHashFn hash, HashMapEqFn eq, allocator_t* a) {
+  hashmap_t* map = allocator_alloc(a, sizeof(hashmap_t));
+  if (map == NULL) return NULL;
+  memset(map, 0, sizeof(hashmap_t));
+  map->key_size = key_size;
+  map->value_size = value_size;
+  map->value_offset = hashmap_valueOffset(key_size, value_size);
+  map->entry_size = _hashmap_entrySize(key_size, value_size);
+  map->hash = hash;
+  map->eq = eq;
+  map->allocator = a;
+  return map;
+}
+
+void hashmap_destroy(hashmap_t* map) {
+  allocator_free(map->allocator, map->ctrl);
+  allocator_free(map->allocator, map);
+}
+
+void* hashmap_get(const hashmap_t* map, const void* key) {
+  long slot = _hashmap_find(map, key, _hashmap_hash(map, key));
+  if (slot < 0) return NULL;
+  return hashmap_entryValue(map, _hashmap_entry(map, slot));
+}
+
+bool hashmap_contains(const hashmap_t* map, const void* key) {
+  return hashmap_get(map, key) != NULL;
+}
+
+/// Inserts `key`, which isn't in the map, with a zeroed value
+/// Returns a pointer to the value or NULL if memory could not be allocated
+void* _hashmap_insert(hashmap_t* map, const void* key, size_t hash) {
+  if (map->size + 1 > _hashmap_maxSize(map->cap)) {
+    if (_hashmap_rehash(map, map->cap == 0 ? CHASHMAP_MIN_CAP : map->cap * 2) != 0) return NULL;
+  }
+  size_t slot = _hashmap_findEmpty(map, hash);
+  _hashmap_setCtrl(map, slot, _hashmap_h2(hash));
+  void* entry = _hashmap_entry(map, slot);
+  memcpy(entry, key, map->key_size);
+  memset(hashmap_entryValue(map, entry), 0, map->value_size);
+  map->size += 1;
+  return hashmap_entryValue(map, entry);
+}
+
+void* hashmap_getOrPut(hashmap_t* map, const void* key, bool* outInserted) {
+  size_t hash = _hashmap_hash(map, key);
+  long found = _hashmap_find(map, key, hash);
+  if (outInserted != NULL) *outInserted = found < 0;
+  if (found >= 0) return hashmap_entryValue(map, _hashmap_entry(map, found));
+  return _hashmap_insert(map, key, hash);
+}
+
+int hashmap_put(hashmap_t* map, const void* key, const void* value) {
+  void* dst = hashmap_getOrPut(map, key, NULL);
+  if (dst == NULL) return 1;
+  memcpy(dst, value, map->value_size);
+  return 0;
+}
+
+bool hashmap_remove(hashmap_t* map, const void* key, void* outValue) {
+  long found = _hashmap_find(map, key, _hashmap_hash(map, key));
+  if (found < 0) return false;
+  size_t hole = (size_t)found;
+  if (outValue != NULL)
+    memcpy(outValue, hashmap_entryValue(map, _hashmap_entry(map, hole)), map->value_size);
+
+  // Backward shift: move every following entry of the cluster that may live
+  // in the hole into it, so lookups never have to skip deleted slots
+  size_t mask = map->cap - 1;
+  size_t slot = hole;
+  for (;;) {
+    slot = (slot + 1) & mask;
+    if (map->ctrl[slot] & _CHASHMAP_EMPTY) break;
+    void* entry = _hashmap_entry(map, slot);
+    size_t home = _hashmap_home(map, _hashmap_hash(map, entry));
+    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+      memcpy(_hashmap_entry(map, hole), entry, map->entry_size);
+      _hashmap_setCtrl(map, hole, map->ctrl[slot]);
+      hole = slot;
+    }
+  }
+  _hashmap_setCtrl(map, hole, _CHASHMAP_EMPTY);
+  map->size -= 1;
+  return true;
+}
+
+int hashmap_reserve(hashmap_t* map, size_t count) {
+  if (count <= _hashmap_maxSize(map->cap)) return 0;
+  size_t cap = map->cap == 0 ? CHASHMAP_MIN_CAP : map->cap;
+  while (_hashmap_maxSize(cap) < count) cap *= 2;
+  return _hashmap_rehash(map, cap);
+}
+
+void hashmap_reset(hashmap_t* map) {
+  if (map->ctrl != NULL) memset(map->ctrl, _CHASHMAP_EMPTY, map->cap + CHASHMAP_GROUP);
+  map->size = 0;
+}
+
+void* _hashmapiter_next(void* data) {
+  hashmapiter_t* iter = (hashmapiter_t*)data;
+  hashmap_t* map = iter->map;
+  while (iter->slot < map->cap) {
+    size_t slot = iter->slot++;
+    if (!(map->ctrl[slot] & _CHASHMAP_EMPTY)) return _hashmap_entry(map, slot);
+  }
+  return NULL;
+}
+
+iter_t* hashmap_createIterator(hashmap_t* map) {
+  iter_t* iter = malloc(sizeof(iter_t) + sizeof(hashmapiter_t));
+  if (iter == NULL) return NULL;
+  hashmapiter_t* mapiter = ((void*)iter) + sizeof(iter_t);
+
+  mapiter->map = map;
+  mapiter->slot = 0;
+
+  iter->opt = ITER_KNOWNSIZE;
+  iter->data = mapiter;
+  iter->next = _hashmapiter_next;
+  iter->type_size = map->entry_size;
+
+  iter->known_size = map->size;
+  iter->idx = NULL;
+  iter->contiguous_buffer = NULL;
+
+  iter->free = (void(*)(iter_t*)) free;
+  iter->next_batch = NULL;
+  _CITERATOR_STATS_INIT(iter);
+
+  return iter;
+}
+
+static inline uint64_t _hashmap_read64(const unsigned char* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t _hashmap_mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+size_t hashmap_hashBytes(const void* data, size_t len) {
+  const unsigned char* p = data;
+  uint64_t h = 0x27D4EB2F165667C5ull ^ (len * 0x9E3779B97F4A7C15ull);
+  for (; len >= 8; len -= 8, p += 8)
+    h = _hashmap_mix(h ^ _hashmap_read64(p)) * 0x9E3779B97F4A7C15ull;
+  uint64_t tail = 0;
+  for (size_t i = 0; i < len; i++)
+    tail |= (uint64_t)p[i] << (8 * i);
+  return (size_t)_hashmap_mix(h ^ tail);
+}
+
+size_t hashmap_hashU32(const void* key) {
+  return (size_t)_hashmap_mix(*(const uint32_t*)key);
+}
+
+size_t hashmap_hashU64(const void* key) {
+  return (size_t)_hashmap_mix(*(const uint64_t*)key);
+}
+
+size_t hashmap_hashString(const void* key) {
+  const char* str = *(const char* const*)key;
+  return hashmap_hashBytes(str, strlen(str));
+}
+
+bool hashmap_eqU32(const void* a, const void* b) {
+  return *(const uint32_t*)a == *(const uint32_t*)b;
+}
+
+bool hashmap_eqU64(const void* a, const void* b) {
+  return *(const uint64_t*)a == *(const uint64_t*)b;
+}
+
+bool hashmap_eqString(const void* a, const void* b) {
+  return strcmp(*(const char* const*)a, *(const char* const*)b) == 0;
+}
+
+typedef struct _GroupReduceSpec {
+  GroupKeyFn keyFn;
+  size_t key_size;
+  size_t acc_size;
+  void(*init)(void* acc);
+  void(*reduce)(const void* in, void* acc);
+  groupReduceOptions_t opt;
+} _groupReduceSpec_t;
+
+/// Partitions split on the hash bits below the ones of the previous levels, the table uses the lowest bits
+#define _CHASHMAP_MAX_PARTITION_DEPTH ((sizeof(size_t) * 8 - 32) / CHASHMAP_PARTITION_BITS)
+
+/// Whether the table may grow past `map->cap` without exceeding `budget`
+static inline bool _hashmap_fitsBudget(const hashmap_t* map, size_t budget) {
+  if (budget == 0 || map->cap == 0 || map->size + 1 <= _hashmap_maxSize(map->cap)) return true;
+  size_t cap = map->cap == 0 ? CHASHMAP_MIN_CAP : map->cap * 2;
+  return cap * (map->entry_size + 1) <= budget;
+}
+
+/// Aggregates `iter` and pushes the records to `out`, partitions are aggregated recursively
+/// Returns 1 if memory could not be allocated
+int _hashmap_groupInto(array_t* out, iter_t* iter, const _groupReduceSpec_t* spec, size_t depth) {
+  allocator_t* a = spec->opt.allocator;
+  size_t budget = depth < _CHASHMAP_MAX_PARTITION_DEPTH ? spec->opt.budget : 0;
+  hashmap_t* map = hashmap_createWithAllocator(spec->key_size, spec->acc_size, spec->opt.hash, spec->opt.eq, a);
+  unsigned char* key = allocator_alloc(a, spec->key_size == 0 ? 1 : spec->key_size);
+  if (map == NULL || key == NULL) {
+    if (map != NULL) hashmap_destroy(map);
+    allocator_free(a, key);
+    return 1;
+  }
+  if (iter->opt & ITER_KNOWNSIZE) {
+    // Every value could be its own key, but the table never grows past the budget
+    size_t count = iter->known_size;
+    if (budget > 0) {
+      size_t cap = CHASHMAP_MIN_CAP;
+      while (cap * 2 * (map->entry_size + 1) <= budget) cap *= 2;
+      if (count > _hashmap_maxSize(cap)) count = _hashmap_maxSize(cap);
+    }
+    hashmap_reserve(map, count);
+  }
+
+  array_t* parts = NULL;
+  size_t partCount = (size_t)1 << CHASHMAP_PARTITION_BITS;
+  size_t shift = sizeof(size_t) * 8 - CHASHMAP_PARTITION_BITS * (depth + 1);
+  int failed = 0;
+  _Alignas(16) unsigned char buf[CITERATOR_BATCH_BYTES];
+  size_t max = CITERATOR_BATCH_BYTES / iter->type_size;
+  while (!failed) {
+    void* span;
+    size_t count;
+    if (max > 0) {
+      count = iter_nextBatch(iter, &span, buf, max);
+    } else {
+      span = iter_next(iter);
+      count = span != NULL;
+    }
+    if (count == 0) break;
+
+    for (size_t i = 0; i < count && !failed; i++) {
+      const unsigned char* value = (const unsigned char*)span + i * iter->type_size;
+      spec->keyFn(value, key);
+      size_t hash = _hashmap_hash(map, key);
+      long slot = _hashmap_find(map, key, hash);
+      void* acc;
+      if (slot >= 0) {
+        acc = hashmap_entryValue(map, _hashmap_entry(map, slot));
+      } else if (parts == NULL && _hashmap_fitsBudget(map, budget)) {
+        acc = _hashmap_insert(map, key, hash);
+        if (acc == NULL) {
+          failed = 1;
+          break;
+        }
+        if (spec->init != NULL) spec->init(acc);
+      } else {
+        // The table is full: its keys keep aggregating in place, every new key goes to a
+        // partition, so all values of a key end up either in the table or in one partition
+        if (parts == NULL) {
+          parts = allocator_alloc(a, partCount * sizeof(array_t));
+          if (parts == NULL) {
+            failed = 1;
+            break;
+          }
+          for (size_t p = 0; p < partCount; p++)
+            array_initInPlace(&parts[p], iter->type_size, NULL, 0, a);
+        }
+        failed = array_push(&parts[(hash >> shift) & (partCount - 1)], value);
+        continue;
+      }
+      spec->reduce(value, acc);
+    }
+  }
+
+  if (!failed && array_reserve(out, map->size) == 0) {
+    for (size_t slot = 0; slot < map->cap; slot++) {
+      if (map->ctrl[slot] & _CHASHMAP_EMPTY) continue;
+      memcpy(array_get(out, out->size), _hashmap_entry(map, slot), map->entry_size);
+      out->size++;
+    }
+  } else {
+    failed = 1;
+  }
+  allocator_free(a, key);
+  hashmap_destroy(map);
+
+  if (parts != NULL) {
+    for (size_t p = 0; p < partCount; p++) {
+      if (!failed && parts[p].size > 0) {
+        iterStorage_t storage;
+        failed = _hashmap_groupInto(out, array_initIterator(&parts[p], &storage), spec, depth + 1);
+      }
+      array_destroy(&parts[p]);
+    }
+    allocator_free(a, parts);
+  }
+  return failed;
+}
+
+array_t* iter_groupReduce(iter_t* iter, GroupKeyFn keyFn, size_t key_size, size_t acc_size,
+    void(*init)(void* acc), void(*reduce)(const void* in, void* acc)) {
+  return iter_groupReduceWithOptions(iter, keyFn, key_size, acc_size, init, reduce, NULL);
+}
+
+array_t* iter_groupReduceWithOptions(iter_t* iter, GroupKeyFn keyFn, size_t key_size, size_t acc_size,
+    void(*init)(void* acc), void(*reduce)(const void* in, void* acc), const groupReduceOptions_t* opt) {
+  _groupReduceSpec_t spec = {
+    .keyFn = keyFn,
+    .key_size = key_size,
+    .acc_size = acc_size,
+    .init = init,
+    .reduce = reduce,
+    .opt = { .budget = CHASHMAP_GROUP_BUDGET },
+  };
+  if (opt != NULL) spec.opt = *opt;
+
+  // The records are copies of the entries of the tables
+  array_t* out = array_createWithAllocator(_hashmap_entrySize(key_size, acc_size), spec.opt.allocator);
+  if (out == NULL) return NULL;
+  if (_hashmap_groupInto(out, iter, &spec, 0) != 0) {
+    array_destroy(out);
+    return NULL;
+  }
+  return out;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
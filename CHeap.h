@@ -0,0 +1,413 @@
+#ifndef _CTYPES_HEAP_H
+#define _CTYPES_HEAP_H
+
+#include "CAllocator.h"
+#include "CArray.h"
+#include "CIterator.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/// Returned by `heap_pushHandle` if memory could not be allocated
+#define HEAP_NO_HANDLE ((size_t)-1)
+
+enum HeapOptionSet {
+  /// Every value gets a handle, which stays valid while the value is in the heap
+  /// and can be used to change (`heap_update`) or remove (`heap_removeHandle`) it
+  HEAP_HANDLES = 0b0001,
+};
+
+/// Priority queue stored in an array, the smallest value according to `compare` is on top.
+/// Every node has `arity` children, 4 halves the depth of the tree and keeps the children of a
+/// node closer together in memory, 2 needs fewer comparisons per level.
+typedef struct Heap {
+  /// The values in heap order, `array->data` holds the top
+  array_t* array;
+  ArrayCmpFn compare;
+  /// log2 of the amount of children per node
+  size_t arity_shift;
+  enum HeapOptionSet opt;
+  /// With `HEAP_HANDLES`, the index of every handle's value or `HEAP_NO_HANDLE`
+  array_t positions;
+  /// With `HEAP_HANDLES`, the handle of every value in `array`
+  array_t handles;
+  /// With `HEAP_HANDLES`, handles that can be reused
+  array_t free_handles;
+} heap_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// == Create ==
+/// A binary heap
+heap_t* heap_create(size_t type_size, ArrayCmpFn compare);
+/// `arity` has to be a power of 2, `opt` is a combination of `HeapOptionSet`
+/// The allocator must outlive the heap
+heap_t* heap_createWithOptions(size_t type_size, ArrayCmpFn compare, size_t arity, int opt, allocator_t* a);
+/// Turns the values of `arr` into a heap in O(n), the heap takes over `arr`
+/// `arity` has to be a power of 2
+/// Returns NULL if memory could not be allocated, `arr` is left untouched in that case
+heap_t* heap_heapify(array_t* arr, ArrayCmpFn compare, size_t arity);
+
+// == Destroy ==
+/// Also destroys the array of the heap
+void heap_destroy(heap_t* heap);
+
+// == Methods ==
+size_t heap_size(const heap_t* heap);
+/// Returns the top value, or NULL if the heap is empty
+void* heap_peek(const heap_t* heap);
+/// Returns 1 if memory could not be allocated
+int heap_push(heap_t* heap, const void* value);
+/// Removes the top value and stores it in `outValue` (if `outValue` is not NULL)
+/// Returns the new size or -1 if the heap is empty
+long heap_pop(heap_t* heap, void* outValue);
+/// Pushes `value` and pops the top into `outValue`, without growing the heap.
+/// If `value` would be on top it is copied to `outValue` directly
+/// Returns 1 if memory could not be allocated (only with `HEAP_HANDLES`)
+int heap_pushPop(heap_t* heap, const void* value, void* outValue);
+void heap_reset(heap_t* heap);
+
+// == Handles ==
+// Only for heaps created with `HEAP_HANDLES`
+
+/// Pushes `value` and returns its handle, or `HEAP_NO_HANDLE` if memory could not be allocated
+size_t heap_pushHandle(heap_t* heap, const void* value);
+/// Returns the current value of `handle`
+void* heap_getHandle(const heap_t* heap, size_t handle);
+/// Replaces the value of `handle` and moves it up (decrease key) or down as needed
+void heap_update(heap_t* heap, size_t handle, const void* value);
+/// Removes the value of `handle` and stores it in `outValue` (if `outValue` is not NULL)
+/// Returns the new size
+long heap_removeHandle(heap_t* heap, size_t handle, void* outValue);
+
+// == Selection ==
+
+/// Pushes the `k` greatest values of `iter` according to `compare` to `outArr`, greatest first.
+/// The values stream through a heap of `k` values, O(n log k), so `iter` doesn't need `ITER_KNOWNSIZE`;
+/// most values only cost one comparison with the smallest value kept so far.
+/// Pass a reversed comparator for the `k` smallest values
+/// Returns 1 if memory could not be allocated, `outArr` keeps its previous values in that case
+int iter_topK(iter_t* iter, size_t k, ArrayCmpFn compare, array_t* outArr);
+
+/// Defines typed heap functions on arrays of `T` ordered by `LESS(a, b)`, with `ARITY` children per node:
+/// `name_push(array_t*, T)`, `name_pop(array_t*, T*)` and `name_heapify(array_t*)`.
+/// The comparisons are inlined, which makes them faster than the `heap_*` functions
+#define CT_HEAP_DEFINE(name, T, LESS, ARITY) \
+  static inline void name##_siftUp(T* data, size_t i) { \
+    T value = data[i]; \
+    while (i > 0) { \
+      size_t parent = (i - 1) / (ARITY); \
+      if (!(LESS(value, data[parent]))) break; \
+      data[i] = data[parent]; \
+      i = parent; \
+    } \
+    data[i] = value; \
+  } \
+  static inline void name##_siftDown(T* data, size_t size, size_t i) { \
+    T value = data[i]; \
+    for (;;) { \
+      size_t first = i * (ARITY) + 1; \
+      if (first >= size) break; \
+      size_t last = first + (ARITY) < size ? first + (ARITY) : size; \
+      size_t best = first; \
+      for (size_t c = first + 1; c < last; c++) \
+        if (LESS(data[c], data[best])) best = c; \
+      if (!(LESS(data[best], value))) break; \
+      data[i] = data[best]; \
+      i = best; \
+    } \
+    data[i] = value; \
+  } \
+  /* Returns 1 if memory could not be allocated */ \
+  static inline int name##_push(array_t* arr, T value) { \
+    if (array_reserve(arr, 1)) return 1; \
+    ((T*)arr->data)[arr->size++] = value; \
+    name##_siftUp((T*)arr->data, arr->size - 1); \
+    return 0; \
+  } \
+  /* Returns the new size or -1 if the heap is empty */ \
+  static inline long name##_pop(array_t* arr, T* outValue) { \
+    if (arr->size == 0) return -1; \
+    T* data = (T*)arr->data; \
+    if (outValue != NULL) *outValue = data[0]; \
+    arr->size -= 1; \
+    if (arr->size > 0) { \
+      data[0] = data[arr->size]; \
+      name##_siftDown(data, arr->size, 0); \
+    } \
+    return arr->size; \
+  } \
+  static inline void name##_heapify(array_t* arr) { \
+    if (arr->size < 2) return; \
+    for (size_t i = (arr->size - 2) / (ARITY) + 1; i-- > 0;) \
+      name##_siftDown((T*)arr->data, arr->size, i); \
+  }
+
+#ifdef CT_HEAP_IMPL
+
+#include <string.h>
+
+#define _HEAP_AT(heap, i) ((unsigned char*)(heap)->array->data + (i) * (heap)->array->type_size)
+
+/// Records that the value of `handle` is now at `i`
+static inline void _heap_place(heap_t* heap, size_t i, size_t handle) {
+  ((size_t*)heap->handles.data)[i] = handle;
+  ((size_t*)heap->positions.data)[handle] = i;
+}
+
+/// Moves the value at `from` to the hole at `to`
+static inline void _heap_move(heap_t* heap, size_t to, size_t from) {
+  memcpy(_HEAP_AT(heap, to), _HEAP_AT(heap, from), heap->array->type_size);
+  if (heap->opt & HEAP_HANDLES)
+    _heap_place(heap, to, ((size_t*)heap->handles.data)[from]);
+}
+
+/// Moves `value` (which belongs to `handle`) up from the hole at `i`
+/// Returns the final index
+size_t _heap_siftUp(heap_t* heap, size_t i, const void* value, size_t handle) {
+  while (i > 0) {
+    size_t parent = (i - 1) >> heap->arity_shift;
+    if (heap->compare(value, _HEAP_AT(heap, parent)) >= 0) break;
+    _heap_move(heap, i, parent);
+    i = parent;
+  }
+  memcpy(_HEAP_AT(heap, i), value, heap->array->type_size);
+  if (heap->opt & HEAP_HANDLES) _heap_place(heap, i, handle);
+  return i;
+}
+
+/// Moves `value` (which belongs to `handle`) down from the hole at `i`
+void _heap_siftDown(heap_t* heap, size_t i, const void* value, size_t handle) {
+  size_t size = heap->array->size;
+  size_t arity = (size_t)1 << heap->arity_shift;
+  for (;;) {
+    size_t first = (i << heap->arity_shift) + 1;
+    if (first >= size) break;
+    size_t last = first + arity < size ? first + arity : size;
+    size_t best = first;
+    for (size_t c = first + 1; c < last; c++)
+      if (heap->compare(_HEAP_AT(heap, c), _HEAP_AT(heap, best)) < 0) best = c;
+    if (heap->compare(_HEAP_AT(heap, best), value) >= 0) break;
+    _heap_move(heap, i, best);
+    i = best;
+  }
+  memcpy(_HEAP_AT(heap, i), value, heap->array->type_size);
+  if (heap->opt & HEAP_HANDLES) _heap_place(heap, i, handle);
+}
+
+size_t _heap_arityShift(size_t arity) {
+  size_t shift = 0;
+  while (((size_t)2 << shift) <= arity) shift++;
+  return shift;
+}
+
+heap_t* _heap_createFor(array_t* arr, ArrayCmpFn compare, size_t arity, int opt) {
+  heap_t* heap = allocator_alloc(arr->allocator, sizeof(heap_t));
+  if (heap == NULL) return NULL;
+  heap->array = arr;
+  heap->compare = compare;
+  heap->arity_shift = _heap_arityShift(arity);
+  heap->opt = opt;
+  array_initInPlace(&heap->positions, sizeof(size_t), NULL, 0, arr->allocator);
+  array_initInPlace(&heap->handles, sizeof(size_t), NULL, 0, arr->allocator);
+  array_initInPlace(&heap->free_handles, sizeof(size_t), NULL, 0, arr->allocator);
+  return heap;
+}
+
+heap_t* heap_create(size_t type_size, ArrayCmpFn compare) {
+  return heap_createWithOptions(type_size, compare, 2, 0, NULL);
+}
+
+heap_t* heap_createWithOptions(size_t type_size, ArrayCmpFn compare, size_t arity, int opt, allocator_t* a) {
+  array_t* arr = array_createWithAllocator(type_size, a);
+  if (arr == NULL) return NULL;
+  heap_t* heap = _heap_createFor(arr, compare, arity, opt);
+  if (heap == NULL) array_destroy(arr);
+  return heap;
+}
+
+heap_t* heap_heapify(array_t* arr, ArrayCmpFn compare, size_t arity) {
+  heap_t* heap = _heap_createFor(arr, compare, arity, 0);
+  if (heap == NULL || arr->size < 2) return heap;
+  unsigned char value[arr->type_size];
+  // Sift down every node with children, starting at the last one
+  for (size_t i = ((arr->size - 2) >> heap->arity_shift) + 1; i-- > 0;) {
+    memcpy(value, _HEAP_AT(heap, i), arr->type_size);
+    _heap_siftDown(heap, i, value, 0);
+  }
+  return heap;
+}
+
+void heap_destroy(heap_t* heap) {
+  allocator_t* a = heap->array->allocator;
+  array_destroy(&heap->positions);
+  array_destroy(&heap->handles);
+  array_destroy(&heap->free_handles);
+  array_destroy(heap->array);
+  allocator_free(a, heap);
+}
+
+size_t heap_size(const heap_t* heap) {
+  return heap->array->size;
+}
+
+void* heap_peek(const heap_t* heap) {
+  return array_first(heap->array);
+}
+
+size_t heap_pushHandle(heap_t* heap, const void* value) {
+  array_t* arr = heap->array;
+  if (array_reserve(arr, 1) != 0) return HEAP_NO_HANDLE;
+  size_t handle = 0;
+  if (heap->opt & HEAP_HANDLES) {
+    if (array_reserve(&heap->handles, 1) != 0) return HEAP_NO_HANDLE;
+    if (heap->free_handles.size > 0) {
+      array_pop(&heap->free_handles, &handle);
+    } else {
+      handle = heap->positions.size;
+      if (array_push(&heap->positions, &handle) != 0) return HEAP_NO_HANDLE;
+    }
+    heap->handles.size += 1;
+  }
+  arr->size += 1;
+  _CARRAY_STAT_SIZE(arr);
+  _heap_siftUp(heap, arr->size - 1, value, handle);
+  return handle;
+}
+
+int heap_push(heap_t* heap, const void* value) {
+  return heap_pushHandle(heap, value) == HEAP_NO_HANDLE ? 1 : 0;
+}
+
+/// Removes the value at `i`, filling its place with the last value
+void _heap_removeAt(heap_t* heap, size_t i, void* outValue) {
+  array_t* arr = heap->array;
+  size_t ts = arr->type_size;
+  if (outValue != NULL) memcpy(outValue, _HEAP_AT(heap, i), ts);
+  if (heap->opt & HEAP_HANDLES) {
+    size_t handle = ((size_t*)heap->handles.data)[i];
+    ((size_t*)heap->positions.data)[handle] = HEAP_NO_HANDLE;
+    // If this fails the handle is just not reused
+    array_push(&heap->free_handles, &handle);
+    heap->handles.size -= 1;
+  }
+  arr->size -= 1;
+  if (i == arr->size) return;
+
+  unsigned char last[ts];
+  memcpy(last, _HEAP_AT(heap, arr->size), ts);
+  size_t lastHandle = (heap->opt & HEAP_HANDLES) ? ((size_t*)heap->handles.data)[arr->size] : 0;
+  if (_heap_siftUp(heap, i, last, lastHandle) == i)
+    _heap_siftDown(heap, i, last, lastHandle);
+}
+
+long heap_pop(heap_t* heap, void* outValue) {
+  if (heap->array->size == 0) return -1;
+  _heap_removeAt(heap, 0, outValue);
+  return heap->array->size;
+}
+
+int heap_pushPop(heap_t* heap, const void* value, void* outValue) {
+  size_t ts = heap->array->type_size;
+  if (heap->array->size == 0 || heap->compare(value, _HEAP_AT(heap, 0)) <= 0) {
+    memcpy(outValue, value, ts);
+    return 0;
+  }
+  if (heap->opt & HEAP_HANDLES) {
+    // The pushed value needs a handle of its own
+    if (heap_push(heap, value) != 0) return 1;
+    heap_pop(heap, outValue);
+    return 0;
+  }
+  memcpy(outValue, _HEAP_AT(heap, 0), ts);
+  _heap_siftDown(heap, 0, value, 0);
+  return 0;
+}
+
+void heap_reset(heap_t* heap) {
+  array_reset(heap->array);
+  array_reset(&heap->positions);
+  array_reset(&heap->handles);
+  array_reset(&heap->free_handles);
+}
+
+void* heap_getHandle(const heap_t* heap, size_t handle) {
+  return _HEAP_AT(heap, ((size_t*)heap->positions.data)[handle]);
+}
+
+void heap_update(heap_t* heap, size_t handle, const void* value) {
+  size_t i = ((size_t*)heap->positions.data)[handle];
+  unsigned char copy[heap->array->type_size];
+  memcpy(copy, value, heap->array->type_size);
+  if (_heap_siftUp(heap, i, copy, handle) == i)
+    _heap_siftDown(heap, i, copy, handle);
+}
+
+long heap_removeHandle(heap_t* heap, size_t handle, void* outValue) {
+  _heap_removeAt(heap, ((size_t*)heap->positions.data)[handle], outValue);
+  return heap->array->size;
+}
+
+int iter_topK(iter_t* iter, size_t k, ArrayCmpFn compare, array_t* outArr) {
+  if (k == 0) return 0;
+  size_t ts = outArr->type_size;
+  size_t start = outArr->size;
+  if (iter->opt & ITER_KNOWNSIZE) {
+    if (array_reserve(outArr, k < iter->known_size ? k : iter->known_size) != 0) return 1;
+  }
+
+  // A binary min-heap over the end of `outArr`: its top is the smallest value kept,
+  // which every further value has to beat
+  array_t view;
+  heap_t heap = { .array = &view, .compare = compare, .arity_shift = 1 };
+  _Alignas(16) unsigned char buf[CITERATOR_BATCH_BYTES];
+  size_t max = CITERATOR_BATCH_BYTES / ts;
+  for (;;) {
+    void* span;
+    size_t count;
+    if (max > 0) {
+      count = iter_nextBatch(iter, &span, buf, max);
+    } else {
+      span = iter_next(iter);
+      count = span != NULL;
+    }
+    if (count == 0) break;
+
+    const unsigned char* value = span;
+    for (; count > 0 && outArr->size - start < k; count--, value += ts) {
+      if (array_reserve(outArr, 1) != 0) {
+        outArr->size = start;
+        return 1;
+      }
+      view = (array_t){ .data = array_get(outArr, start), .size = outArr->size - start + 1, .type_size = ts };
+      outArr->size++;
+      _heap_siftUp(&heap, view.size - 1, value, 0);
+    }
+    view = (array_t){ .data = array_get(outArr, start), .size = outArr->size - start, .type_size = ts };
+    for (; count > 0; count--, value += ts) {
+      if (compare(value, view.data) <= 0) continue;
+      _heap_siftDown(&heap, 0, value, 0);
+    }
+  }
+
+  // Popping the smallest value into the freed last place leaves the greatest first
+  view = (array_t){ .data = array_get(outArr, start), .size = outArr->size - start, .type_size = ts };
+  unsigned char last[ts];
+  while (view.size > 1) {
+    view.size--;
+    void* end = _HEAP_AT(&heap, view.size);
+    memcpy(last, end, ts);
+    memcpy(end, view.data, ts);
+    _heap_siftDown(&heap, 0, last, 0);
+  }
+  return 0;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
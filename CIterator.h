@@ -4,6 +4,15 @@
 #include "CArray.h"
 #include <stddef.h>
 
+#ifndef CITERATOR_BATCH_BYTES
+/// Size of the stack buffer used when consuming iterators in batches
+#define CITERATOR_BATCH_BYTES 4096
+#endif
+
+// glibc's __nonnull is restored at the end of this file, so that system headers
+// included after this one still compile
+#pragma push_macro("__nonnull")
+#pragma push_macro("__nullable")
 #undef __nonnull
 #ifndef __nonnull
 #define __nonnull
@@ -15,10 +24,30 @@
 
 typedef int(*CmpFn)(const void* a, const void* b);
 
+#ifdef CT_STATS
+typedef struct IteratorStats {
+  /// Values requested with `iter_next`
+  size_t next_calls;
+  /// Spans requested with `iter_nextBatch`
+  size_t batch_calls;
+  /// Consumers that read the contiguous storage directly (with memcpy or a CArray.h kernel)
+  size_t contiguous_paths;
+  /// Consumers that read spans from `next_batch`
+  size_t batch_paths;
+  /// Consumers that called `next` for every value
+  size_t element_paths;
+} iterStats_t;
+#endif
+
 enum IteratorOptionSet {
+  /// The values are stored in `contiguous_buffer`, spans returned by `next_batch` point into it
   ITER_CONTIGUOUS = 0b0001,
   ITER_KNOWNSIZE = 0b0010,
   ITER_ENUMERATED = 0b0100,
+  /// Built in caller-provided `iterStorage_t`, destroying it doesn't free the storage
+  ITER_IN_PLACE = 0b1000,
+  /// A value is only valid until the next call to `next`, consumers that keep one copy it into `kept`
+  ITER_TRANSIENT = 0b10000,
 };
 
 typedef struct Iterator {
@@ -36,8 +65,28 @@ typedef struct Iterator {
   void* __nullable contiguous_buffer;
   /// Optional free
   void(* __nullable free)(struct Iterator*);
+  /// Optional. Stores the start of the next span of at most `max` values in `*outSpan`
+  /// and returns its length, or 0 when the iterator is exhausted.
+  /// The span either points into the iterator's own storage or into `buf`,
+  /// which has room for `max` values.
+  size_t(* __nullable next_batch)(void* data, void** outSpan, void* buf, size_t max);
+  /// available if `ITER_TRANSIENT`, NULL until a consumer keeps a value. Freed by `iter_destroy`
+  void* __nullable kept;
+#ifdef CT_STATS
+  /// Initialized by `_CITERATOR_STATS_INIT`, which iterator sources should call
+  iterStats_t stats;
+#endif
 } iter_t;
 
+#ifdef CT_STATS
+#define _CITERATOR_STATS_INIT(iter) memset(&(iter)->stats, 0, sizeof(iterStats_t))
+#define _CITERATOR_STAT(iter, field, n) \
+  ((iter)->stats.field += (n), __atomic_fetch_add(&iter_globalStats.field, (n), __ATOMIC_RELAXED))
+#else
+#define _CITERATOR_STATS_INIT(iter) ((void)0)
+#define _CITERATOR_STAT(iter, field, n) ((void)0)
+#endif
+
 typedef void(*IteratorFreeFn)(iter_t*);
 
 typedef struct EnumeratedValue {
@@ -70,17 +119,67 @@ typedef struct ZippedIteratorValue {
   zippedValue_t value;
 } zippedIterValue_t;
 
+typedef struct MapIteratorData {
+  iter_t* inner_iter;
+  void(*mutate)(const void* in, void* out);
+  /// The size of a mapped value
+  size_t type_size;
+  /// Holds the last mapped value (`type_size` bytes)
+  void* value;
+} mapIterData_t;
+
+typedef struct FilterIteratorData {
+  iter_t* inner_iter;
+  bool(*where)(const void*);
+} filterIterData_t;
+
+/// Used by `iter_take`, `iter_skip` and `iter_stepBy`
+typedef struct CountingIteratorData {
+  iter_t* inner_iter;
+  size_t count;
+  bool started;
+} countingIterData_t;
+
+typedef struct ChainedIteratorData {
+  iter_t* first;
+  iter_t* second;
+  bool on_second;
+} chainedIterData_t;
+
+/// Room for any iterator of this header, for building it without allocating (see `array_initIterator`).
+/// The storage has to outlive the iterator, which is still destroyed with `iter_destroy`
+typedef struct IteratorStorage {
+  iter_t iter;
+  union {
+    arrayiter_t array;
+    enumeratedValue_t enumerated;
+    zippedIterValue_t zipped;
+    mapIterData_t map;
+    filterIterData_t filter;
+    countingIterData_t counting;
+    chainedIterData_t chained;
+  } data;
+} iterStorage_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 iter_t* array_createIterator(array_t* arr);
+/// Like `array_createIterator`, built in `storage`
+iter_t* array_initIterator(array_t* arr, iterStorage_t* storage);
 
 void iter_destroy(iter_t* iter);
 
 void* iter_next(iter_t* iter);
+/// Returns the next span of at most `max` values, see `iter_t.next_batch`
+/// Iterators without `next_batch` copy their values into `buf` one by one
+size_t iter_nextBatch(iter_t* iter, void** outSpan, void* buf, size_t max);
 array_t* iter_collect(iter_t* iter, array_t* outArr);
 array_t* iter_collectCreate(iter_t* iter);
+/// Pushes every value of `iter` to `arr`, reserving once if the size of `iter` is known
+/// Returns 1 if memory could not be allocated
+int array_extendFromIterator(array_t* arr, iter_t* iter);
 
 /// Returns `outArr`
 /// The array will be reset before inserting new values
@@ -119,34 +218,129 @@ long long iter_indexOfFirst(iter_t* iter, bool(*where)(const void*));
 /// Returns NULL if the iterator cannot be reversed
 // iter_t* iter_reversed(iter_t* iter);
 
-/// Return the maximum value in an iterator
+/// Return the maximum value in an iterator.
+/// For `ITER_TRANSIENT` iterators it is a copy owned by the iterator, valid until it is destroyed.
+/// Returns NULL if the iterator is empty or the copy could not be allocated
 const void* iter_max(iter_t* iter, CmpFn compare);
 const void* iter_min(iter_t* iter, CmpFn compare);
 
 /// `iter` will be invalidated
 iter_t* iter_enumerated(iter_t* iter);
-
+/// Yields pairs (`zippedValue_t`) until both iterators are exhausted
+/// The returned iterator owns `left` and `right`
 iter_t* iter_zipped(iter_t* left, iter_t* right);
 
+// == Lazy adapters ==
+// These wrap `iter` without materializing anything, values are produced on
+// `iter_next`. The returned iterator owns `iter` (`iter` will be invalidated).
+
+/// Calls `mutate` on every value, the mapped values have size `type_size`
+/// The returned pointer is only valid until the next call to `iter_next`
+iter_t* iter_lazyMap(iter_t* iter, size_t type_size, void(*mutate)(const void* in, void* out));
+/// Only yields the values satisfying `where`
+iter_t* iter_filter(iter_t* iter, bool(*where)(const void*));
+/// Yields at most `count` values
+iter_t* iter_take(iter_t* iter, size_t count);
+/// Skips the first `count` values
+iter_t* iter_skip(iter_t* iter, size_t count);
+/// Yields the values of `first` and then those of `second`
+/// Both iterators should have the same `type_size`
+iter_t* iter_chain(iter_t* first, iter_t* second);
+/// Yields the first value and then every `step`th value
+iter_t* iter_stepBy(iter_t* iter, size_t step);
+
+// == In place ==
+// The same iterators built in caller-provided storage, without allocating.
+// They return the iterator in `storage` (or `iter` itself for `iter_initEnumerated`
+// on an enumerated iterator) and own their inner iterators like the functions above.
+
+iter_t* iter_initEnumerated(iterStorage_t* storage, iter_t* iter);
+iter_t* iter_initZipped(iterStorage_t* storage, iter_t* left, iter_t* right);
+/// `value` holds the last mapped value, it needs room for `type_size` bytes
+iter_t* iter_initLazyMap(iterStorage_t* storage, iter_t* iter, size_t type_size, void(*mutate)(const void* in, void* out), void* value);
+iter_t* iter_initFilter(iterStorage_t* storage, iter_t* iter, bool(*where)(const void*));
+iter_t* iter_initTake(iterStorage_t* storage, iter_t* iter, size_t count);
+iter_t* iter_initSkip(iterStorage_t* storage, iter_t* iter, size_t count);
+iter_t* iter_initChain(iterStorage_t* storage, iter_t* first, iter_t* second);
+iter_t* iter_initStepBy(iterStorage_t* storage, iter_t* iter, size_t step);
+
+#ifdef CT_STATS
+// == Stats ==
+
+/// The counters of all iterators
+extern iterStats_t iter_globalStats;
+/// Prints the counters of `iter`, or the global ones if `iter` is NULL
+void iter_statsDump(const iter_t* iter, FILE* out);
+#endif
+
 #ifdef CT_ITERATOR_IMPL
 
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef CT_STATS
+
+iterStats_t iter_globalStats;
+
+void iter_statsDump(const iter_t* iter, FILE* out) {
+  const iterStats_t* stats = iter == NULL ? &iter_globalStats : &iter->stats;
+  fprintf(out, "%s: next_calls=%zu batch_calls=%zu contiguous_paths=%zu batch_paths=%zu element_paths=%zu\n",
+    iter == NULL ? "iterators" : "iterator", stats->next_calls, stats->batch_calls,
+    stats->contiguous_paths, stats->batch_paths, stats->element_paths);
+}
+
+#endif
+
+#define _CITERATOR_ALIGN(n) (((n) + 15) & ~(size_t)15)
+
 void* _arrayiter_next(void* data) {
   arrayiter_t* iter = (arrayiter_t*)data;
   return array_getChecked(iter->storage, ++iter->idx);
 }
 
+size_t _arrayiter_nextBatch(void* data, void** outSpan, void* buf, size_t max) {
+  arrayiter_t* iter = (arrayiter_t*)data;
+  size_t start = (size_t)(iter->idx + 1);
+  if (start >= iter->storage->size) return 0;
+  size_t count = iter->storage->size - start;
+  if (count > max) count = max;
+  *outSpan = array_get(iter->storage, start);
+  iter->idx += count;
+  return count;
+}
+
+/// Releases the memory of an adapter, unless it was built in place
+void _iter_release(iter_t* iter) {
+  if (!(iter->opt & ITER_IN_PLACE)) free(iter);
+}
+
+/// Storage for an iterator created on the heap, followed by `extra` bytes
+iterStorage_t* _iter_allocStorage(size_t extra) {
+  return malloc(_CITERATOR_ALIGN(sizeof(iterStorage_t)) + extra);
+}
+
+/// Marks an iterator built in heap storage as owning it
+iter_t* _iter_owned(iter_t* iter) {
+  iter->opt &= ~ITER_IN_PLACE;
+  return iter;
+}
+
 iter_t* array_createIterator(array_t* arr) {
-  iter_t* iter = malloc(sizeof(iter_t) + sizeof(arrayiter_t));
-  if (iter == NULL) return NULL;
-  arrayiter_t* arriter = ((void*)iter) + sizeof(iter_t);
+  iterStorage_t* storage = _iter_allocStorage(0);
+  if (storage == NULL) return NULL;
+  iter_t* iter = _iter_owned(array_initIterator(arr, storage));
+  iter->free = (void(*)(iter_t*)) free;
+  return iter;
+}
+
+iter_t* array_initIterator(array_t* arr, iterStorage_t* storage) {
+  iter_t* iter = &storage->iter;
+  arrayiter_t* arriter = &storage->data.array;
 
   arriter->storage = arr;
   arriter->idx = -1;
 
-  iter->opt = ITER_KNOWNSIZE | ITER_CONTIGUOUS | ITER_ENUMERATED;
+  iter->opt = ITER_KNOWNSIZE | ITER_CONTIGUOUS | ITER_ENUMERATED | ITER_IN_PLACE;
   iter->data = arriter;
   iter->next = _arrayiter_next;
   iter->type_size = arr->type_size;
@@ -155,27 +349,73 @@ iter_t* array_createIterator(array_t* arr) {
   iter->idx = &arriter->idx;
   iter->contiguous_buffer = arr->data;
 
-  iter->free = (void(*)(iter_t*)) free;
+  iter->free = NULL;
+  iter->next_batch = _arrayiter_nextBatch;
+  _CITERATOR_STATS_INIT(iter);
 
   return iter;
 }
 
 void iter_destroy(iter_t* iter) {
+  if (iter->opt & ITER_TRANSIENT) free(iter->kept);
   if (iter->free != NULL)
     iter->free(iter);
 }
 
 void* iter_next(iter_t* iter) {
+  _CITERATOR_STAT(iter, next_calls, 1);
   return iter->next(iter->data);
 }
 
+size_t iter_nextBatch(iter_t* iter, void** outSpan, void* buf, size_t max) {
+  _CITERATOR_STAT(iter, batch_calls, 1);
+  if (iter->next_batch != NULL)
+    return iter->next_batch(iter->data, outSpan, buf, max);
+
+  size_t count = 0;
+  void* value;
+  while (count < max && (value = iter_next(iter))) {
+    memcpy(buf + count * iter->type_size, value, iter->type_size);
+    count++;
+  }
+  *outSpan = buf;
+  return count;
+}
+
+/// Declares `buf` and `max` for reading `iter` in batches
+/// `max` is 0 if the iterator doesn't support batches
+#define _CITERATOR_BATCH_BUFFER(iter, buf, max) \
+  _Alignas(16) unsigned char buf[CITERATOR_BATCH_BYTES]; \
+  size_t max = (iter)->next_batch == NULL ? 0 : CITERATOR_BATCH_BYTES / (iter)->type_size
+
+/// Declares `buf` and `max` for consuming `iter` in batches and records the path taken
+/// `max` is 0 if the iterator doesn't support batches, the consumer then calls `next` for every value
+#define _CITERATOR_BATCH(iter, buf, max) \
+  _CITERATOR_BATCH_BUFFER(iter, buf, max); \
+  if (max > 0) _CITERATOR_STAT(iter, batch_paths, 1); else _CITERATOR_STAT(iter, element_paths, 1)
+
+/// Spans of contiguous iterators point into their storage, so pointers to values stay valid
+#define _CITERATOR_HAS_STABLE_BATCH(iter) ((iter)->next_batch != NULL && ((iter)->opt & ITER_CONTIGUOUS))
+
 array_t* iter_collect(iter_t* iter, array_t* outArr) {
   if (iter->opt & ITER_KNOWNSIZE)
     array_reserveAtLeast(outArr, iter->known_size);
 
   if ((iter->opt & ITER_CONTIGUOUS) && (iter->opt & ITER_KNOWNSIZE)) {
+    _CITERATOR_STAT(iter, contiguous_paths, 1);
     memcpy(outArr->data, iter->contiguous_buffer, iter->known_size * iter->type_size);
     outArr->size = iter->known_size;
+    _CARRAY_STAT_SIZE(outArr);
+    return outArr;
+  }
+
+  _CITERATOR_BATCH(iter, buf, max);
+  if (max > 0) {
+    void* span;
+    size_t count;
+    while ((count = iter_nextBatch(iter, &span, buf, max))) {
+      if (array_pushMany(outArr, span, count)) return outArr;
+    }
     return outArr;
   }
 
@@ -197,35 +437,79 @@ array_t* iter_collectCreate(iter_t* iter) {
   return iter_collect(iter, arr);
 }
 
-array_t* iter_map(iter_t* iter, array_t* outArr, void(*mutate)(const void* in, void* out)) {
-  iter_t* it = iter;
-  if ((iter->opt & ITER_ENUMERATED) == 0) {
-    it = iter_enumerated(iter);
-    if (it == NULL) return NULL;
+int array_extendFromIterator(array_t* arr, iter_t* iter) {
+  if (iter->opt & ITER_KNOWNSIZE) {
+    if (array_reserveAtLeast(arr, arr->size + iter->known_size)) return 1;
   }
 
-  const void* value;
-  if (it->opt & ITER_KNOWNSIZE) {
-    if (it->known_size <= outArr->size) {
-      if (array_reserveAtLeast(outArr, it->known_size)) { return NULL; }
-      outArr->size = it->known_size;
+  void* span;
+  size_t count;
+  // Contiguous spans are copied straight from their storage, without a size limit
+  if (_CITERATOR_HAS_STABLE_BATCH(iter)) {
+    _CITERATOR_STAT(iter, contiguous_paths, 1);
+    size_t max = (size_t)-1 / iter->type_size;
+    while ((count = iter_nextBatch(iter, &span, NULL, max))) {
+      if (array_pushMany(arr, span, count)) return 1;
     }
-    while ((value = iter_next(it))) {
-      mutate(value, array_get(outArr, *(it->idx)));
+    return 0;
+  }
+
+  _CITERATOR_BATCH(iter, buf, max);
+  if (max > 0) {
+    while ((count = iter_nextBatch(iter, &span, buf, max))) {
+      if (array_pushMany(arr, span, count)) return 1;
     }
+    return 0;
+  }
+
+  void* value;
+  while ((value = iter_next(iter))) {
+    if (array_push(arr, value)) return 1;
+  }
+  return 0;
+}
+
+array_t* iter_map(iter_t* iter, array_t* outArr, void(*mutate)(const void* in, void* out)) {
+  // For known sizes the size is set up front, so that `outArr` can also be the mapped array
+  bool knownSize = iter->opt & ITER_KNOWNSIZE;
+  if (knownSize) {
+    if (array_reserveAtLeast(outArr, iter->known_size)) { return NULL; }
+    outArr->size = iter->known_size;
   } else {
     outArr->size = 0;
-    size_t cap = 10;
-    array_reserveAtLeast(outArr, cap);
-    while ((value = iter_next(it))) {
-      if (*(it->idx) == cap) {
-        cap *= 2;
-        array_grow(outArr, cap);
+  }
+
+  size_t n = 0;
+  _CITERATOR_BATCH(iter, buf, max);
+  if (max > 0) {
+    void* span;
+    size_t count;
+    while ((count = iter_nextBatch(iter, &span, buf, max))) {
+      // Grows by the array's policy, without a known size growing to fit every batch would be linear
+      if (n + count > outArr->cap) {
+        outArr->size = n;
+        if (array_reserve(outArr, count)) { return NULL; }
+      }
+      for (size_t i = 0; i < count; i++) {
+        mutate(span + i * iter->type_size, array_get(outArr, n + i));
       }
-      mutate(value, array_get(outArr, *(it->idx)));
+      n += count;
+    }
+  } else {
+    const void* value;
+    while ((value = iter_next(iter))) {
+      if (n == outArr->cap) {
+        outArr->size = n;
+        if (array_reserve(outArr, 1)) { return NULL; }
+      }
+      mutate(value, array_get(outArr, n));
+      n++;
     }
-    outArr->size = *(it->idx);
   }
+
+  // `known_size` is only a hint, the source may have yielded fewer or more values
+  outArr->size = n;
+  _CARRAY_STAT_SIZE(outArr);
   return outArr;
 }
 
@@ -235,15 +519,75 @@ array_t* iter_mapCreate(iter_t* iter, void(*mutate)(const void* in, void* out))
   return arr;
 }
 
+/// An untouched contiguous iterator can hand its whole buffer to the numeric kernels of CArray.h
+#define _CITERATOR_KERNEL_READY(iter, size) \
+  (((iter)->opt & (ITER_CONTIGUOUS | ITER_KNOWNSIZE | ITER_ENUMERATED)) == (ITER_CONTIGUOUS | ITER_KNOWNSIZE | ITER_ENUMERATED) \
+   && (iter)->next_batch != NULL && (iter)->type_size == (size) && (iter)->known_size > 0 && *(iter)->idx == -1)
+
+static inline array_t _iter_kernelView(iter_t* iter) {
+  return (array_t) {
+    .size = iter->known_size,
+    .cap = iter->known_size,
+    .type_size = iter->type_size,
+    .data = iter->contiguous_buffer,
+    .allocator = NULL,
+  };
+}
+
+/// Leaves a kernel-consumed iterator exhausted, contiguous spans make this O(1)
+static inline void _iter_kernelConsume(iter_t* iter) {
+  _CITERATOR_STAT(iter, contiguous_paths, 1);
+  void* span;
+  size_t max = (size_t)-1 / iter->type_size;
+  while (iter_nextBatch(iter, &span, NULL, max));
+}
+
 const void* iter_reduce(iter_t* iter, void* intoValue, void(*reduce)(const void* in, void* out)) {
+  if (reduce == array_addI32 && _CITERATOR_KERNEL_READY(iter, sizeof(int32_t))) {
+    array_t view = _iter_kernelView(iter);
+    int64_t sum = array_sumI32(&view);
+    *(int32_t*)intoValue = (int32_t)((uint32_t)*(int32_t*)intoValue + (uint32_t)sum);
+    _iter_kernelConsume(iter);
+    return intoValue;
+  }
+  if (reduce == array_addI64 && _CITERATOR_KERNEL_READY(iter, sizeof(int64_t))) {
+    array_t view = _iter_kernelView(iter);
+    int64_t sum = array_sumI64(&view);
+    *(int64_t*)intoValue = (int64_t)((uint64_t)*(int64_t*)intoValue + (uint64_t)sum);
+    _iter_kernelConsume(iter);
+    return intoValue;
+  }
+
+  _CITERATOR_BATCH(iter, buf, max);
+  if (max > 0) {
+    void* span;
+    size_t count;
+    while ((count = iter_nextBatch(iter, &span, buf, max))) {
+      for (size_t i = 0; i < count; i++)
+        reduce(span + i * iter->type_size, intoValue);
+    }
+    return intoValue;
+  }
+
   const void* value;
   while ((value = iter_next(iter))) {
     reduce(value, intoValue);
   }
-  return value;
+  return intoValue;
 }
 
 bool iter_allSatisfy(iter_t* iter, bool(*where)(const void*)) {
+  _CITERATOR_BATCH(iter, buf, max);
+  if (max > 0) {
+    void* span;
+    size_t count;
+    while ((count = iter_nextBatch(iter, &span, buf, max))) {
+      for (size_t i = 0; i < count; i++)
+        if (!where(span + i * iter->type_size)) return false;
+    }
+    return true;
+  }
+
   const void* value;
   while ((value = iter_next(iter))) {
     if (!where(value)) return false;
@@ -252,6 +596,20 @@ bool iter_allSatisfy(iter_t* iter, bool(*where)(const void*)) {
 }
 
 array_t* iter_findAll(iter_t* iter, array_t* intoArray, bool(*where)(const void*)) {
+  _CITERATOR_BATCH(iter, buf, max);
+  if (max > 0) {
+    void* span;
+    size_t count;
+    while ((count = iter_nextBatch(iter, &span, buf, max))) {
+      for (size_t i = 0; i < count; i++) {
+        void* value = span + i * iter->type_size;
+        if (where(value))
+          array_push(intoArray, value);
+      }
+    }
+    return intoArray;
+  }
+
   void* value;
   while ((value = iter_next(iter))) {
     if (where(value))
@@ -266,10 +624,10 @@ array_t* iter_findAllCreate(iter_t* iter, bool(*where)(const void*)) {
 }
 
 array_t* iter_findAllIndexes(iter_t* iter, array_t* intoArray, bool(*where)(const void*)) {
-  iter_t* it = iter;
-  if ((iter->opt & ITER_ENUMERATED) == 0)
-    it = iter_enumerated(iter);
+  iterStorage_t storage;
+  iter_t* it = iter_initEnumerated(&storage, iter);
 
+  _CITERATOR_STAT(it, element_paths, 1);
   const void* value;
   while ((value = iter_next(it))) {
     if (where(value))
@@ -284,6 +642,7 @@ array_t* iter_findAllIndexesCreate(iter_t* iter, bool(*where)(const void*)) {
 }
 
 const void* iter_findFirst(iter_t* iter, bool(*where)(const void*)) {
+  _CITERATOR_STAT(iter, element_paths, 1);
   const void* value;
   while ((value = iter_next(iter))) {
     if (where(value)) return value;
@@ -292,10 +651,10 @@ const void* iter_findFirst(iter_t* iter, bool(*where)(const void*)) {
 }
 
 long long iter_indexOfFirst(iter_t* iter, bool(*where)(const void*)) {
-  iter_t* it = iter;
-  if ((iter->opt & ITER_ENUMERATED) == 0)
-    it = iter_enumerated(iter);
+  iterStorage_t storage;
+  iter_t* it = iter_initEnumerated(&storage, iter);
 
+  _CITERATOR_STAT(it, element_paths, 1);
   const void* value;
   while ((value = iter_next(it))) {
     if (where(value)) return *(it->idx);
@@ -303,26 +662,92 @@ long long iter_indexOfFirst(iter_t* iter, bool(*where)(const void*)) {
   return -1;
 }
 
-const void* iter_max(iter_t* iter, CmpFn compare) {
-  void* currentMax = iter_next(iter);
-  void* value;
-  while ((value = iter_next(iter))) {
-    if (compare(currentMax, value) > 0) {
-      currentMax = value;
+const void* _iter_extremeBatched(iter_t* iter, CmpFn compare, int sign) {
+  _CITERATOR_STAT(iter, contiguous_paths, 1);
+  void* current = NULL;
+  void* span;
+  size_t count;
+  size_t max = (size_t)-1 / iter->type_size;
+  while ((count = iter_nextBatch(iter, &span, NULL, max))) {
+    size_t i = 0;
+    if (current == NULL) {
+      current = span;
+      i = 1;
+    }
+    for (; i < count; i++) {
+      void* value = span + i * iter->type_size;
+      if (compare(current, value) * sign > 0)
+        current = value;
     }
   }
-  return currentMax;
+  return current;
 }
 
-const void* iter_min(iter_t* iter, CmpFn compare) {
-  void* currentMin = iter_next(iter);
+/// Calls `next` for every value, values of transient iterators are copied into `iter->kept`
+const void* _iter_extremeElements(iter_t* iter, CmpFn compare, int sign) {
+  _CITERATOR_STAT(iter, element_paths, 1);
+  void* current = iter_next(iter);
   void* value;
-  while ((value = iter_next(iter))) {
-    if (compare(currentMin, value) < 0) {
-      currentMin = value;
+  if (current == NULL || !(iter->opt & ITER_TRANSIENT)) {
+    while ((value = iter_next(iter))) {
+      if (compare(current, value) * sign > 0)
+        current = value;
     }
+    return current;
+  }
+
+  if (iter->kept == NULL) iter->kept = malloc(iter->type_size);
+  if (iter->kept == NULL) return NULL;
+  memcpy(iter->kept, current, iter->type_size);
+  while ((value = iter_next(iter))) {
+    if (compare(iter->kept, value) * sign > 0)
+      memcpy(iter->kept, value, iter->type_size);
+  }
+  return iter->kept;
+}
+
+#define _CITERATOR_EXTREME_KERNEL(T, name) \
+  if (compare == array_cmp##name && _CITERATOR_KERNEL_READY(iter, sizeof(T))) { \
+    array_t view = _iter_kernelView(iter); \
+    T min, max; \
+    array_minMax##name(&view, &min, &max); \
+    return array_findFirstEq##name(&view, smallest ? min : max); \
+  }
+
+/// Returns the index of the first smallest (or largest) element,
+/// or -1 if there is no kernel for `compare` (or a NaN has to be compared)
+long _iter_extremeKernel(iter_t* iter, CmpFn compare, bool smallest) {
+  _CITERATOR_EXTREME_KERNEL(int32_t, I32)
+  _CITERATOR_EXTREME_KERNEL(int64_t, I64)
+  _CITERATOR_EXTREME_KERNEL(float, F32)
+  _CITERATOR_EXTREME_KERNEL(double, F64)
+  return -1;
+}
+
+/// `iter_max` keeps the value for which `compare(current, value) <= 0`,
+/// so with an ascending comparator it finds the first smallest element
+const void* iter_max(iter_t* iter, CmpFn compare) {
+  long idx = _iter_extremeKernel(iter, compare, true);
+  if (idx >= 0) {
+    _iter_kernelConsume(iter);
+    return iter->contiguous_buffer + idx * iter->type_size;
+  }
+  if (_CITERATOR_HAS_STABLE_BATCH(iter))
+    return _iter_extremeBatched(iter, compare, 1);
+
+  return _iter_extremeElements(iter, compare, 1);
+}
+
+const void* iter_min(iter_t* iter, CmpFn compare) {
+  long idx = _iter_extremeKernel(iter, compare, false);
+  if (idx >= 0) {
+    _iter_kernelConsume(iter);
+    return iter->contiguous_buffer + idx * iter->type_size;
   }
-  return currentMin;
+  if (_CITERATOR_HAS_STABLE_BATCH(iter))
+    return _iter_extremeBatched(iter, compare, -1);
+
+  return _iter_extremeElements(iter, compare, -1);
 }
 
 const void* iter_min(iter_t* iter, CmpFn compare);
@@ -332,6 +757,13 @@ void* _iter_enumerated_next(void* data) {
   val->i += 1;
   return val->inner_iter->next(val->inner_iter->data);
 }
+
+size_t _iter_enumerated_nextBatch(void* data, void** outSpan, void* buf, size_t max) {
+  enumeratedValue_t* val = (enumeratedValue_t*)data;
+  size_t count = iter_nextBatch(val->inner_iter, outSpan, buf, max);
+  val->i += count;
+  return count;
+}
 #define BYTE_TO_BINARY_PATTERN "%c%c%c%c%c%c%c%c"
 #define BYTE_TO_BINARY(byte)  \
   ((byte) & 0x80 ? '1' : '0'), \
@@ -345,18 +777,25 @@ void* _iter_enumerated_next(void* data) {
 
 void _iter_enumerated_free(iter_t* iter) {
   enumeratedValue_t* val = (enumeratedValue_t*)iter->data;
-  if (val->inner_iter->free)
-    val->inner_iter->free(val->inner_iter);
-  free(iter);
+  iter_destroy(val->inner_iter);
+  _iter_release(iter);
 }
 
 iter_t* iter_enumerated(iter_t* iter) {
   if (iter->opt & ITER_ENUMERATED) return iter;
-  iter_t* newIter = malloc(sizeof(iter_t) + sizeof(enumeratedValue_t));
-  if (newIter == NULL) return NULL;
+  iterStorage_t* storage = _iter_allocStorage(0);
+  if (storage == NULL) return NULL;
+  return _iter_owned(iter_initEnumerated(storage, iter));
+}
+
+iter_t* iter_initEnumerated(iterStorage_t* storage, iter_t* iter) {
+  if (iter->opt & ITER_ENUMERATED) return iter;
+  iter_t* newIter = &storage->iter;
   *newIter = *iter;
-  newIter->opt |= ITER_ENUMERATED;
-  enumeratedValue_t* val = (enumeratedValue_t*)(((void*)newIter) + sizeof(iter_t)); //malloc(sizeof(enumeratedValue_t));
+  newIter->opt |= ITER_ENUMERATED | ITER_IN_PLACE;
+  newIter->kept = NULL;
+  _CITERATOR_STATS_INIT(newIter);
+  enumeratedValue_t* val = &storage->data.enumerated;
   val->i = (long) -1;
   val->inner_iter = iter;
   // val->inner_free = iter->free;
@@ -367,6 +806,7 @@ iter_t* iter_enumerated(iter_t* iter) {
   newIter->idx = &val->i;
   newIter->free = _iter_enumerated_free;
   newIter->next = _iter_enumerated_next;
+  newIter->next_batch = iter->next_batch == NULL ? NULL : _iter_enumerated_nextBatch;
 
   return newIter;
 }
@@ -385,29 +825,360 @@ void _iter_zipped_free(iter_t* iter) {
 
   iter_destroy(data->left);
   iter_destroy(data->right);
-  free(iter);
+  _iter_release(iter);
 }
 
 iter_t* iter_zipped(iter_t* left, iter_t* right) {
-  iter_t* iter = malloc(sizeof(iter_t) + sizeof(zippedIterValue_t));
+  iterStorage_t* storage = _iter_allocStorage(0);
+  if (storage == NULL) return NULL;
+  return _iter_owned(iter_initZipped(storage, left, right));
+}
 
-  zippedIterValue_t* data = (zippedIterValue_t*)(((void*)iter) + sizeof(iter_t));
+iter_t* iter_initZipped(iterStorage_t* storage, iter_t* left, iter_t* right) {
+  iter_t* iter = &storage->iter;
+  zippedIterValue_t* data = &storage->data.zipped;
   data->left = left;
   data->right = right;
 
-  iter->opt = 0;
+  // The value is rewritten by every call
+  iter->opt = ITER_IN_PLACE | ITER_TRANSIENT;
+  iter->kept = NULL;
   iter->data = data;
+  iter->idx = NULL;
+  iter->known_size = 0;
+  iter->contiguous_buffer = NULL;
   iter->next = _iter_zipped_next;
   iter->free = _iter_zipped_free;
+  iter->next_batch = NULL;
   iter->type_size = sizeof(zippedValue_t);
+  _CITERATOR_STATS_INIT(iter);
 
   return iter;
 }
 
+/// Sets up the iterator in `storage` for an adapter of `inner`
+/// Only `type_size` and `ITER_TRANSIENT` are copied from `inner`
+iter_t* _iter_initAdapter(iterStorage_t* storage, const iter_t* inner) {
+  iter_t* iter = &storage->iter;
+  iter->opt = ITER_IN_PLACE | (inner->opt & ITER_TRANSIENT);
+  iter->kept = NULL;
+  iter->data = &storage->data;
+  iter->idx = NULL;
+  iter->known_size = 0;
+  iter->type_size = inner->type_size;
+  iter->contiguous_buffer = NULL;
+  iter->next_batch = NULL;
+  _CITERATOR_STATS_INIT(iter);
+  return iter;
+}
+
+void* _iter_lazyMap_next(void* _data) {
+  mapIterData_t* data = (mapIterData_t*)_data;
+  const void* value = iter_next(data->inner_iter);
+  if (value == NULL) return NULL;
+  data->mutate(value, data->value);
+  return data->value;
+}
+
+/// Adapters that read their inner iterator in batches need their own buffer,
+/// so they only support batches if an inner value fits into it
+#define _CITERATOR_CAN_BATCH(iter) ((iter)->next_batch != NULL && (iter)->type_size <= CITERATOR_BATCH_BYTES)
+
+size_t _iter_lazyMap_nextBatch(void* _data, void** outSpan, void* buf, size_t max) {
+  mapIterData_t* data = (mapIterData_t*)_data;
+  iter_t* inner = data->inner_iter;
+  _CITERATOR_BATCH_BUFFER(inner, innerBuf, innerMax);
+  if (innerMax > max) innerMax = max;
+
+  void* span;
+  size_t count = iter_nextBatch(inner, &span, innerBuf, innerMax);
+  for (size_t i = 0; i < count; i++)
+    data->mutate(span + i * inner->type_size, buf + i * data->type_size);
+  *outSpan = buf;
+  return count;
+}
+
+void _iter_lazyMap_free(iter_t* iter) {
+  mapIterData_t* data = (mapIterData_t*)iter->data;
+  iter_destroy(data->inner_iter);
+  _iter_release(iter);
+}
+
+iter_t* iter_lazyMap(iter_t* iter, size_t type_size, void(*mutate)(const void* in, void* out)) {
+  // The mapped value is stored after the iterator
+  iterStorage_t* storage = _iter_allocStorage(type_size);
+  if (storage == NULL) return NULL;
+  void* value = ((void*)storage) + _CITERATOR_ALIGN(sizeof(iterStorage_t));
+  return _iter_owned(iter_initLazyMap(storage, iter, type_size, mutate, value));
+}
+
+iter_t* iter_initLazyMap(iterStorage_t* storage, iter_t* iter, size_t type_size, void(*mutate)(const void* in, void* out), void* value) {
+  iter_t* newIter = _iter_initAdapter(storage, iter);
+  mapIterData_t* data = (mapIterData_t*)newIter->data;
+  data->inner_iter = iter;
+  data->mutate = mutate;
+  data->type_size = type_size;
+  data->value = value;
+
+  // Mapping keeps the amount of values and their indexes, the mapped value is rewritten by every call
+  newIter->opt |= (iter->opt & (ITER_KNOWNSIZE | ITER_ENUMERATED)) | ITER_TRANSIENT;
+  newIter->known_size = iter->known_size;
+  newIter->idx = iter->idx;
+  newIter->type_size = type_size;
+  newIter->next = _iter_lazyMap_next;
+  newIter->free = _iter_lazyMap_free;
+  if (_CITERATOR_CAN_BATCH(iter)) newIter->next_batch = _iter_lazyMap_nextBatch;
+  return newIter;
+}
+
+void* _iter_filter_next(void* _data) {
+  filterIterData_t* data = (filterIterData_t*)_data;
+  void* value;
+  while ((value = iter_next(data->inner_iter))) {
+    if (data->where(value)) return value;
+  }
+  return NULL;
+}
+
+size_t _iter_filter_nextBatch(void* _data, void** outSpan, void* buf, size_t max) {
+  filterIterData_t* data = (filterIterData_t*)_data;
+  iter_t* inner = data->inner_iter;
+  _CITERATOR_BATCH_BUFFER(inner, innerBuf, innerMax);
+
+  size_t found = 0;
+  while (found < max) {
+    void* span;
+    size_t count = iter_nextBatch(inner, &span, innerBuf, innerMax < max - found ? innerMax : max - found);
+    if (count == 0) break;
+    for (size_t i = 0; i < count; i++) {
+      void* value = span + i * inner->type_size;
+      if (data->where(value)) {
+        memcpy(buf + found * inner->type_size, value, inner->type_size);
+        found++;
+      }
+    }
+  }
+  *outSpan = buf;
+  return found;
+}
+
+void _iter_filter_free(iter_t* iter) {
+  filterIterData_t* data = (filterIterData_t*)iter->data;
+  iter_destroy(data->inner_iter);
+  _iter_release(iter);
+}
+
+iter_t* iter_filter(iter_t* iter, bool(*where)(const void*)) {
+  iterStorage_t* storage = _iter_allocStorage(0);
+  if (storage == NULL) return NULL;
+  return _iter_owned(iter_initFilter(storage, iter, where));
+}
+
+iter_t* iter_initFilter(iterStorage_t* storage, iter_t* iter, bool(*where)(const void*)) {
+  iter_t* newIter = _iter_initAdapter(storage, iter);
+  filterIterData_t* data = (filterIterData_t*)newIter->data;
+  data->inner_iter = iter;
+  data->where = where;
+
+  newIter->next = _iter_filter_next;
+  newIter->free = _iter_filter_free;
+  if (_CITERATOR_CAN_BATCH(iter)) newIter->next_batch = _iter_filter_nextBatch;
+  return newIter;
+}
+
+void _iter_counting_free(iter_t* iter) {
+  countingIterData_t* data = (countingIterData_t*)iter->data;
+  iter_destroy(data->inner_iter);
+  _iter_release(iter);
+}
+
+void* _iter_take_next(void* _data) {
+  countingIterData_t* data = (countingIterData_t*)_data;
+  if (data->count == 0) return NULL;
+  data->count -= 1;
+  return iter_next(data->inner_iter);
+}
+
+size_t _iter_take_nextBatch(void* _data, void** outSpan, void* buf, size_t max) {
+  countingIterData_t* data = (countingIterData_t*)_data;
+  if (max > data->count) max = data->count;
+  if (max == 0) return 0;
+  size_t count = iter_nextBatch(data->inner_iter, outSpan, buf, max);
+  data->count -= count;
+  return count;
+}
+
+iter_t* iter_take(iter_t* iter, size_t count) {
+  iterStorage_t* storage = _iter_allocStorage(0);
+  if (storage == NULL) return NULL;
+  return _iter_owned(iter_initTake(storage, iter, count));
+}
+
+iter_t* iter_initTake(iterStorage_t* storage, iter_t* iter, size_t count) {
+  iter_t* newIter = _iter_initAdapter(storage, iter);
+  countingIterData_t* data = (countingIterData_t*)newIter->data;
+  data->inner_iter = iter;
+  data->count = count;
+
+  // The values are a prefix of `iter`, so its buffer and indexes stay valid
+  newIter->opt |= iter->opt & (ITER_CONTIGUOUS | ITER_ENUMERATED);
+  newIter->idx = iter->idx;
+  newIter->contiguous_buffer = iter->contiguous_buffer;
+  if (iter->opt & ITER_KNOWNSIZE) {
+    newIter->opt |= ITER_KNOWNSIZE;
+    newIter->known_size = iter->known_size < count ? iter->known_size : count;
+  }
+  newIter->next = _iter_take_next;
+  newIter->free = _iter_counting_free;
+  newIter->next_batch = iter->next_batch == NULL ? NULL : _iter_take_nextBatch;
+  return newIter;
+}
+
+void* _iter_skip_next(void* _data) {
+  countingIterData_t* data = (countingIterData_t*)_data;
+  while (data->count > 0) {
+    data->count -= 1;
+    if (iter_next(data->inner_iter) == NULL) {
+      data->count = 0;
+      return NULL;
+    }
+  }
+  return iter_next(data->inner_iter);
+}
+
+size_t _iter_skip_nextBatch(void* _data, void** outSpan, void* buf, size_t max) {
+  countingIterData_t* data = (countingIterData_t*)_data;
+  iter_t* inner = data->inner_iter;
+  while (data->count > 0) {
+    size_t count = iter_nextBatch(inner, outSpan, buf, data->count < max ? data->count : max);
+    if (count == 0) {
+      data->count = 0;
+      return 0;
+    }
+    data->count -= count;
+  }
+  return iter_nextBatch(inner, outSpan, buf, max);
+}
+
+iter_t* iter_skip(iter_t* iter, size_t count) {
+  iterStorage_t* storage = _iter_allocStorage(0);
+  if (storage == NULL) return NULL;
+  return _iter_owned(iter_initSkip(storage, iter, count));
+}
+
+iter_t* iter_initSkip(iterStorage_t* storage, iter_t* iter, size_t count) {
+  iter_t* newIter = _iter_initAdapter(storage, iter);
+  countingIterData_t* data = (countingIterData_t*)newIter->data;
+  data->inner_iter = iter;
+  data->count = count;
+
+  if (iter->opt & ITER_KNOWNSIZE) {
+    size_t skipped = iter->known_size < count ? iter->known_size : count;
+    newIter->opt |= ITER_KNOWNSIZE;
+    newIter->known_size = iter->known_size - skipped;
+    if (iter->opt & ITER_CONTIGUOUS) {
+      newIter->opt |= ITER_CONTIGUOUS;
+      newIter->contiguous_buffer = iter->contiguous_buffer + skipped * iter->type_size;
+    }
+  }
+  newIter->next = _iter_skip_next;
+  newIter->free = _iter_counting_free;
+  newIter->next_batch = iter->next_batch == NULL ? NULL : _iter_skip_nextBatch;
+  return newIter;
+}
+
+void* _iter_stepBy_next(void* _data) {
+  countingIterData_t* data = (countingIterData_t*)_data;
+  if (data->started) {
+    for (size_t i = 1; i < data->count; i++) {
+      if (iter_next(data->inner_iter) == NULL) return NULL;
+    }
+  }
+  data->started = true;
+  return iter_next(data->inner_iter);
+}
+
+iter_t* iter_stepBy(iter_t* iter, size_t step) {
+  iterStorage_t* storage = _iter_allocStorage(0);
+  if (storage == NULL) return NULL;
+  return _iter_owned(iter_initStepBy(storage, iter, step));
+}
+
+iter_t* iter_initStepBy(iterStorage_t* storage, iter_t* iter, size_t step) {
+  iter_t* newIter = _iter_initAdapter(storage, iter);
+  countingIterData_t* data = (countingIterData_t*)newIter->data;
+  data->inner_iter = iter;
+  data->count = step == 0 ? 1 : step;
+  data->started = false;
+
+  if (iter->opt & ITER_KNOWNSIZE) {
+    newIter->opt |= ITER_KNOWNSIZE;
+    newIter->known_size = iter->known_size == 0 ? 0 : (iter->known_size - 1) / data->count + 1;
+  }
+  newIter->next = _iter_stepBy_next;
+  newIter->free = _iter_counting_free;
+  return newIter;
+}
+
+void* _iter_chain_next(void* _data) {
+  chainedIterData_t* data = (chainedIterData_t*)_data;
+  if (!data->on_second) {
+    void* value = iter_next(data->first);
+    if (value != NULL) return value;
+    data->on_second = true;
+  }
+  return iter_next(data->second);
+}
+
+size_t _iter_chain_nextBatch(void* _data, void** outSpan, void* buf, size_t max) {
+  chainedIterData_t* data = (chainedIterData_t*)_data;
+  if (!data->on_second) {
+    size_t count = iter_nextBatch(data->first, outSpan, buf, max);
+    if (count != 0) return count;
+    data->on_second = true;
+  }
+  return iter_nextBatch(data->second, outSpan, buf, max);
+}
+
+void _iter_chain_free(iter_t* iter) {
+  chainedIterData_t* data = (chainedIterData_t*)iter->data;
+  iter_destroy(data->first);
+  iter_destroy(data->second);
+  _iter_release(iter);
+}
+
+iter_t* iter_chain(iter_t* first, iter_t* second) {
+  iterStorage_t* storage = _iter_allocStorage(0);
+  if (storage == NULL) return NULL;
+  return _iter_owned(iter_initChain(storage, first, second));
+}
+
+iter_t* iter_initChain(iterStorage_t* storage, iter_t* first, iter_t* second) {
+  iter_t* newIter = _iter_initAdapter(storage, first);
+  chainedIterData_t* data = (chainedIterData_t*)newIter->data;
+  data->first = first;
+  data->second = second;
+  data->on_second = false;
+
+  newIter->opt |= second->opt & ITER_TRANSIENT;
+  if ((first->opt & ITER_KNOWNSIZE) && (second->opt & ITER_KNOWNSIZE)) {
+    newIter->opt |= ITER_KNOWNSIZE;
+    newIter->known_size = first->known_size + second->known_size;
+  }
+  newIter->next = _iter_chain_next;
+  newIter->free = _iter_chain_free;
+  if (first->next_batch != NULL && second->next_batch != NULL)
+    newIter->next_batch = _iter_chain_nextBatch;
+  return newIter;
+}
+
 #endif
 
 #ifdef __cplusplus
 }
 #endif
 
+#pragma pop_macro("__nullable")
+#pragma pop_macro("__nonnull")
+
 #endif
@@ -0,0 +1,479 @@
+#ifndef _CTYPES_PARALLEL_H
+#define _CTYPES_PARALLEL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "CArray.h"
+#include "CIterator.h"
+
+#ifndef CPARALLEL_CHUNK_BYTES
+/// Preferred amount of bytes processed per chunk of work
+#define CPARALLEL_CHUNK_BYTES (64 * 1024)
+#endif
+
+#ifndef CPARALLEL_CACHE_LINE
+#define CPARALLEL_CACHE_LINE 64
+#endif
+
+/// `worker` is in `[0, thread_count)`, the thread calling `threadpool_run` is worker 0
+typedef void(*ThreadPoolTaskFn)(void* ctx, size_t worker);
+
+/// The chunks a worker starts with, other workers steal from it once theirs are done
+typedef struct ParallelRange {
+  _Alignas(CPARALLEL_CACHE_LINE) atomic_size_t next;
+  size_t end;
+} parallelRange_t;
+
+typedef struct ThreadPool {
+  /// Amount of workers, including the thread calling `threadpool_run`
+  size_t thread_count;
+  pthread_t* threads;
+  pthread_mutex_t mutex;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+  size_t generation;
+  size_t active;
+  bool stop;
+  ThreadPoolTaskFn task;
+  void* task_ctx;
+  /// One per worker
+  parallelRange_t* ranges;
+} threadpool_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// == Thread pool ==
+
+/// `thread_count` includes the calling thread, 0 uses the amount of online processors
+threadpool_t* threadpool_create(size_t thread_count);
+void threadpool_destroy(threadpool_t* pool);
+/// Runs `task` once on every worker and waits for all of them to return
+/// A pool runs one task at a time, it should not be shared between threads calling this
+void threadpool_run(threadpool_t* pool, ThreadPoolTaskFn task, void* ctx);
+
+// == Parallel iterator functions ==
+// These split iterators that are `ITER_CONTIGUOUS | ITER_KNOWNSIZE` into
+// cache-line aligned chunks that are processed by the workers of `pool`.
+// Other iterators (or a `NULL` pool) fall back to the sequential version.
+// The callbacks are called concurrently and should be thread safe.
+// Either way `iter` is exhausted afterwards, except by the fallback of
+// `iter_parAllSatisfy`, which stops at the first failing value like `iter_allSatisfy`.
+
+/// Like `iter_map`, the values in `outArr` keep the order of `iter`
+array_t* iter_parMap(threadpool_t* pool, iter_t* iter, array_t* outArr, void(*mutate)(const void* in, void* out));
+
+/// Reduces every chunk into a copy of `identity` (of `value_size` bytes), the
+/// results of the chunks are then merged into `intoValue` in order with `combine`.
+/// `identity` must therefore be neutral and `combine` associative.
+/// Returns `intoValue`
+const void* iter_parReduce(
+  threadpool_t* pool, iter_t* iter,
+  void* intoValue, const void* identity, size_t value_size,
+  void(*reduce)(const void* in, void* out),
+  void(*combine)(const void* in, void* out)
+);
+
+/// Like `iter_findAll`, the found values keep the order of `iter`
+/// Returns NULL if memory could not be allocated, `intoArray` keeps its previous values in that case
+array_t* iter_parFindAll(threadpool_t* pool, iter_t* iter, array_t* intoArray, bool(*where)(const void*));
+
+/// Stops all workers as soon as a value doesn't satisfy `where`.
+/// Unlike `iter_allSatisfy` the split path still leaves `iter` exhausted, the fallback doesn't
+bool iter_parAllSatisfy(threadpool_t* pool, iter_t* iter, bool(*where)(const void*));
+
+#ifdef CT_PARALLEL_IMPL
+
+void* _threadpool_worker(void* arg);
+
+typedef struct _ThreadPoolWorkerArg {
+  threadpool_t* pool;
+  size_t worker;
+} _threadpoolWorkerArg_t;
+
+threadpool_t* threadpool_create(size_t thread_count) {
+  if (thread_count == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count = online > 0 ? (size_t)online : 1;
+  }
+
+  threadpool_t* pool = calloc(1, sizeof(threadpool_t));
+  if (pool == NULL) return NULL;
+  pool->thread_count = thread_count;
+  pool->ranges = aligned_alloc(CPARALLEL_CACHE_LINE, thread_count * sizeof(parallelRange_t));
+  pool->threads = malloc(thread_count * sizeof(pthread_t));
+  _threadpoolWorkerArg_t* args = malloc(thread_count * sizeof(_threadpoolWorkerArg_t));
+  if (pool->ranges == NULL || pool->threads == NULL || args == NULL) {
+    free(pool->ranges);
+    free(pool->threads);
+    free(args);
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+
+  // Worker 0 is the caller of `threadpool_run`
+  for (size_t i = 1; i < thread_count; i++) {
+    args[i].pool = pool;
+    args[i].worker = i;
+    if (pthread_create(&pool->threads[i], NULL, _threadpool_worker, &args[i]) != 0) {
+      pool->thread_count = i;
+      break;
+    }
+  }
+
+  // Wait until every worker copied its argument
+  pthread_mutex_lock(&pool->mutex);
+  while (pool->active < pool->thread_count - 1)
+    pthread_cond_wait(&pool->done_cond, &pool->mutex);
+  pool->active = 0;
+  pthread_mutex_unlock(&pool->mutex);
+  free(args);
+
+  return pool;
+}
+
+void* _threadpool_worker(void* _arg) {
+  _threadpoolWorkerArg_t* arg = (_threadpoolWorkerArg_t*)_arg;
+  threadpool_t* pool = arg->pool;
+  size_t worker = arg->worker;
+
+  pthread_mutex_lock(&pool->mutex);
+  size_t seen = pool->generation;
+  pool->active += 1;
+  pthread_cond_signal(&pool->done_cond);
+
+  for (;;) {
+    while (pool->generation == seen && !pool->stop)
+      pthread_cond_wait(&pool->work_cond, &pool->mutex);
+    if (pool->stop) break;
+    seen = pool->generation;
+    ThreadPoolTaskFn task = pool->task;
+    void* ctx = pool->task_ctx;
+    pthread_mutex_unlock(&pool->mutex);
+
+    task(ctx, worker);
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->active -= 1;
+    if (pool->active == 0)
+      pthread_cond_signal(&pool->done_cond);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+void threadpool_destroy(threadpool_t* pool) {
+  pthread_mutex_lock(&pool->mutex);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for (size_t i = 1; i < pool->thread_count; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_cond_destroy(&pool->done_cond);
+  free(pool->ranges);
+  free(pool->threads);
+  free(pool);
+}
+
+void threadpool_run(threadpool_t* pool, ThreadPoolTaskFn task, void* ctx) {
+  pthread_mutex_lock(&pool->mutex);
+  pool->task = task;
+  pool->task_ctx = ctx;
+  pool->active = pool->thread_count - 1;
+  pool->generation += 1;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  task(ctx, 0);
+
+  pthread_mutex_lock(&pool->mutex);
+  while (pool->active > 0)
+    pthread_cond_wait(&pool->done_cond, &pool->mutex);
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+// == Chunked execution ==
+
+typedef struct _ParallelFor {
+  threadpool_t* pool;
+  const void* src;
+  size_t count;
+  size_t type_size;
+  size_t chunk;
+  size_t chunk_count;
+  void(*body)(struct _ParallelFor* job, size_t chunkIdx, size_t from, size_t to);
+  void* ctx;
+  atomic_bool cancelled;
+} _parallelFor_t;
+
+size_t _parallel_gcd(size_t a, size_t b) {
+  while (b != 0) {
+    size_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+/// Picks a chunk size that is a multiple of the cache line size in bytes,
+/// while leaving enough chunks to balance the workers
+void _parallel_initChunks(_parallelFor_t* job) {
+  size_t unit = CPARALLEL_CACHE_LINE / _parallel_gcd(CPARALLEL_CACHE_LINE, job->type_size);
+  size_t chunk = CPARALLEL_CHUNK_BYTES / job->type_size;
+  size_t balanced = job->count / (job->pool->thread_count * 4);
+  if (balanced < chunk) chunk = balanced;
+  chunk = (chunk + unit - 1) / unit * unit;
+  if (chunk == 0) chunk = unit;
+  job->chunk = chunk;
+  job->chunk_count = (job->count + chunk - 1) / chunk;
+}
+
+bool _parallel_runChunk(_parallelFor_t* job, parallelRange_t* range, size_t worker) {
+  size_t c = atomic_fetch_add_explicit(&range->next, 1, memory_order_relaxed);
+  if (c >= range->end) return false;
+  if (atomic_load_explicit(&job->cancelled, memory_order_relaxed)) return true;
+  size_t from = c * job->chunk;
+  size_t to = from + job->chunk;
+  if (to > job->count) to = job->count;
+  job->body(job, c, from, to);
+  return true;
+}
+
+void _parallel_worker(void* ctx, size_t worker) {
+  _parallelFor_t* job = (_parallelFor_t*)ctx;
+  threadpool_t* pool = job->pool;
+  while (_parallel_runChunk(job, &pool->ranges[worker], worker));
+  // Steal from the other workers
+  for (size_t i = 1; i < pool->thread_count; i++) {
+    parallelRange_t* victim = &pool->ranges[(worker + i) % pool->thread_count];
+    while (_parallel_runChunk(job, victim, worker));
+  }
+}
+
+void _parallel_for(_parallelFor_t* job) {
+  threadpool_t* pool = job->pool;
+  size_t workers = pool->thread_count;
+  for (size_t w = 0; w < workers; w++) {
+    atomic_store_explicit(&pool->ranges[w].next, job->chunk_count * w / workers, memory_order_relaxed);
+    pool->ranges[w].end = job->chunk_count * (w + 1) / workers;
+  }
+  threadpool_run(pool, _parallel_worker, job);
+}
+
+bool _parallel_canSplit(threadpool_t* pool, iter_t* iter) {
+  return pool != NULL && (iter->opt & ITER_CONTIGUOUS) && (iter->opt & ITER_KNOWNSIZE);
+}
+
+/// Leaves a split iterator exhausted like the sequential versions, contiguous spans make this O(1)
+void _parallel_consume(iter_t* iter) {
+  if (iter->next_batch == NULL) {
+    while (iter_next(iter));
+    return;
+  }
+  void* span;
+  size_t max = (size_t)-1 / iter->type_size;
+  while (iter_nextBatch(iter, &span, NULL, max));
+}
+
+void _parallel_initJob(_parallelFor_t* job, threadpool_t* pool, iter_t* iter, void* ctx) {
+  job->pool = pool;
+  job->src = iter->contiguous_buffer;
+  job->count = iter->known_size;
+  job->type_size = iter->type_size;
+  job->ctx = ctx;
+  atomic_init(&job->cancelled, false);
+  _parallel_initChunks(job);
+}
+
+// == Map ==
+
+typedef struct _ParallelMap {
+  array_t* out;
+  void(*mutate)(const void* in, void* out);
+} _parallelMap_t;
+
+void _parallel_mapBody(_parallelFor_t* job, size_t chunkIdx, size_t from, size_t to) {
+  _parallelMap_t* map = (_parallelMap_t*)job->ctx;
+  for (size_t i = from; i < to; i++)
+    map->mutate(job->src + i * job->type_size, array_get(map->out, i));
+}
+
+array_t* iter_parMap(threadpool_t* pool, iter_t* iter, array_t* outArr, void(*mutate)(const void* in, void* out)) {
+  if (!_parallel_canSplit(pool, iter))
+    return iter_map(iter, outArr, mutate);
+
+  if (array_reserveAtLeast(outArr, iter->known_size)) return NULL;
+  outArr->size = iter->known_size;
+
+  _parallelMap_t map = { .out = outArr, .mutate = mutate };
+  _parallelFor_t job;
+  _parallel_initJob(&job, pool, iter, &map);
+  job.body = _parallel_mapBody;
+  _parallel_for(&job);
+  _parallel_consume(iter);
+  return outArr;
+}
+
+// == Reduce ==
+
+typedef struct _ParallelReduce {
+  void* partials;
+  const void* identity;
+  size_t value_size;
+  void(*reduce)(const void* in, void* out);
+} _parallelReduce_t;
+
+void _parallel_reduceBody(_parallelFor_t* job, size_t chunkIdx, size_t from, size_t to) {
+  _parallelReduce_t* red = (_parallelReduce_t*)job->ctx;
+  void* acc = red->partials + chunkIdx * red->value_size;
+  memcpy(acc, red->identity, red->value_size);
+  for (size_t i = from; i < to; i++)
+    red->reduce(job->src + i * job->type_size, acc);
+}
+
+const void* iter_parReduce(
+  threadpool_t* pool, iter_t* iter,
+  void* intoValue, const void* identity, size_t value_size,
+  void(*reduce)(const void* in, void* out),
+  void(*combine)(const void* in, void* out)
+) {
+  if (!_parallel_canSplit(pool, iter))
+    return iter_reduce(iter, intoValue, reduce);
+
+  _parallelReduce_t red = { .identity = identity, .value_size = value_size, .reduce = reduce };
+  _parallelFor_t job;
+  _parallel_initJob(&job, pool, iter, &red);
+  job.body = _parallel_reduceBody;
+
+  red.partials = malloc(job.chunk_count * value_size);
+  if (red.partials == NULL)
+    return iter_reduce(iter, intoValue, reduce);
+  _parallel_for(&job);
+
+  for (size_t c = 0; c < job.chunk_count; c++)
+    combine(red.partials + c * value_size, intoValue);
+  free(red.partials);
+  _parallel_consume(iter);
+  return intoValue;
+}
+
+// == Find all ==
+
+typedef struct _ParallelFindAll {
+  /// Matches of every chunk
+  array_t* found;
+  /// Offset of every chunk's matches in the output
+  size_t* offsets;
+  array_t* out;
+  bool(*where)(const void*);
+} _parallelFindAll_t;
+
+void _parallel_findAllBody(_parallelFor_t* job, size_t chunkIdx, size_t from, size_t to) {
+  _parallelFindAll_t* find = (_parallelFindAll_t*)job->ctx;
+  array_t* found = &find->found[chunkIdx];
+  for (size_t i = from; i < to; i++) {
+    const void* value = job->src + i * job->type_size;
+    if (find->where(value) && array_push(found, value))
+      atomic_store(&job->cancelled, true);
+  }
+}
+
+void _parallel_concatBody(_parallelFor_t* job, size_t chunkIdx, size_t from, size_t to) {
+  _parallelFindAll_t* find = (_parallelFindAll_t*)job->ctx;
+  array_t* found = &find->found[chunkIdx];
+  if (found->size == 0) return;
+  memcpy(array_get(find->out, find->offsets[chunkIdx]), found->data, found->size * found->type_size);
+}
+
+array_t* iter_parFindAll(threadpool_t* pool, iter_t* iter, array_t* intoArray, bool(*where)(const void*)) {
+  if (!_parallel_canSplit(pool, iter))
+    return iter_findAll(iter, intoArray, where);
+
+  _parallelFindAll_t find = { .out = intoArray, .where = where };
+  _parallelFor_t job;
+  _parallel_initJob(&job, pool, iter, &find);
+  job.body = _parallel_findAllBody;
+
+  find.found = malloc(job.chunk_count * sizeof(array_t));
+  find.offsets = malloc(job.chunk_count * sizeof(size_t));
+  if (find.found == NULL || find.offsets == NULL) {
+    free(find.found);
+    free(find.offsets);
+    return iter_findAll(iter, intoArray, where);
+  }
+  for (size_t c = 0; c < job.chunk_count; c++)
+    array_initInPlace(&find.found[c], iter->type_size, NULL, 0, NULL);
+
+  _parallel_for(&job);
+
+  size_t total = intoArray->size;
+  for (size_t c = 0; c < job.chunk_count; c++) {
+    find.offsets[c] = total;
+    total += find.found[c].size;
+  }
+  // A chunk that couldn't store a match cancels the job
+  bool failed = atomic_load(&job.cancelled) || array_reserveAtLeast(intoArray, total) != 0;
+  if (!failed) {
+    job.body = _parallel_concatBody;
+    _parallel_for(&job);
+    intoArray->size = total;
+    _CARRAY_STAT_SIZE(intoArray);
+  }
+
+  for (size_t c = 0; c < job.chunk_count; c++)
+    array_destroy(&find.found[c]);
+  free(find.found);
+  free(find.offsets);
+  _parallel_consume(iter);
+  return failed ? NULL : intoArray;
+}
+
+// == All satisfy ==
+
+/// Amount of values between checks for cancellation
+#define _CPARALLEL_CANCEL_STRIDE 1024
+
+void _parallel_allSatisfyBody(_parallelFor_t* job, size_t chunkIdx, size_t from, size_t to) {
+  bool(*where)(const void*) = (bool(*)(const void*))job->ctx;
+  for (size_t i = from; i < to; i++) {
+    if (!where(job->src + i * job->type_size)) {
+      atomic_store_explicit(&job->cancelled, true, memory_order_relaxed);
+      return;
+    }
+    if ((i - from) % _CPARALLEL_CANCEL_STRIDE == 0 && atomic_load_explicit(&job->cancelled, memory_order_relaxed))
+      return;
+  }
+}
+
+bool iter_parAllSatisfy(threadpool_t* pool, iter_t* iter, bool(*where)(const void*)) {
+  if (!_parallel_canSplit(pool, iter))
+    return iter_allSatisfy(iter, where);
+
+  _parallelFor_t job;
+  _parallel_initJob(&job, pool, iter, (void*)where);
+  job.body = _parallel_allSatisfyBody;
+  _parallel_for(&job);
+  _parallel_consume(iter);
+  return !atomic_load(&job.cancelled);
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef _CTYPES_SEGARRAY_H
+#define _CTYPES_SEGARRAY_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "CAllocator.h"
+#include "CIterator.h"
+
+#ifndef CSEGARRAY_FIRST_SHIFT
+/// log2 of the capacity of the first segment, every following segment is twice as large
+#define CSEGARRAY_FIRST_SHIFT 4
+#endif
+
+#ifndef CSEGARRAY_CACHE_LINE
+#define CSEGARRAY_CACHE_LINE 64
+#endif
+
+/// Enough segments to index every `size_t`
+#define CSEGARRAY_SEGMENTS (sizeof(size_t) * 8 - CSEGARRAY_FIRST_SHIFT)
+
+/// Array stored in segments of exponentially growing size, values never move once pushed,
+/// so pointers to them stay valid until the array is destroyed or reset.
+/// `segarray_push` can be called from many threads at once, and readers can access the first
+/// `segarray_size` values while other threads push.
+typedef struct SegArray {
+  size_t type_size;
+  /// Used for the segments, it has to be thread safe if pushing from several threads
+  allocator_t* allocator;
+  /// Segment `k` holds `1 << (CSEGARRAY_FIRST_SHIFT + k)` values followed by a ready flag per value,
+  /// NULL until it is needed
+  _Atomic(void*) segments[CSEGARRAY_SEGMENTS];
+  /// Amount of indexes handed out to pushes
+  _Alignas(CSEGARRAY_CACHE_LINE) atomic_size_t reserved;
+  /// Amount of values written, the values before it can be read.
+  /// A push flags its values as ready and then moves `committed` past every ready value,
+  /// so values are published in the order of their indexes without waiting for slower pushes
+  _Alignas(CSEGARRAY_CACHE_LINE) atomic_size_t committed;
+} segarray_t;
+
+typedef struct SegArrayIterData {
+  segarray_t* storage;
+  long idx;
+  /// The size of the array when the iterator was created
+  size_t end;
+} segarrayiter_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// == Create ==
+segarray_t* segarray_create(size_t type_size);
+/// The allocator must outlive the array
+segarray_t* segarray_createWithAllocator(size_t type_size, allocator_t* a);
+
+// == Destroy ==
+/// Not thread safe
+void segarray_destroy(segarray_t* sa);
+
+// == Methods ==
+
+/// The amount of values that can be read
+size_t segarray_size(const segarray_t* sa);
+/// `idx` has to be smaller than `segarray_size`, or an index returned by a push of this thread
+void* segarray_get(const segarray_t* sa, size_t idx);
+/// Returns `NULL` if the index doesn't exist
+void* segarray_getChecked(const segarray_t* sa, size_t idx);
+
+/// Copies `value` to the end of the array. Thread safe
+/// Returns the index of the value, or -1 if memory could not be allocated
+long segarray_push(segarray_t* sa, const void* value);
+/// Copies `count` values to consecutive indexes, they are published together. Thread safe
+/// Returns the index of the first value, or -1 if memory could not be allocated
+long segarray_pushMany(segarray_t* sa, const void* values, size_t count);
+
+/// Removes every value, but keeps the segments for reuse. Not thread safe
+void segarray_reset(segarray_t* sa);
+
+// == Iterators ==
+
+/// Iterates over the values readable when it is created, pushes that happen while iterating are not yielded.
+/// Every batch is (a part of) one segment
+iter_t* segarray_createIterator(segarray_t* sa);
+/// Like `segarray_createIterator`, built in `storage`
+iter_t* segarray_initIterator(segarray_t* sa, iterStorage_t* storage);
+
+#ifdef CT_SEGARRAY_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(segarrayiter_t) <= sizeof(((iterStorage_t*)0)->data), "segarrayiter_t has to fit into iterStorage_t");
+
+/// The segment holding `idx`, found by counting the leading zeros of `idx` shifted past the first segment
+static inline size_t _segarray_segment(size_t idx) {
+  size_t biased = idx + ((size_t)1 << CSEGARRAY_FIRST_SHIFT);
+  return (size_t)(63 - __builtin_clzll((unsigned long long)biased)) - CSEGARRAY_FIRST_SHIFT;
+}
+
+/// The index of the first value in segment `k`
+static inline size_t _segarray_segmentStart(size_t k) {
+  return ((size_t)1 << (k + CSEGARRAY_FIRST_SHIFT)) - ((size_t)1 << CSEGARRAY_FIRST_SHIFT);
+}
+
+static inline size_t _segarray_segmentCap(size_t k) {
+  return (size_t)1 << (k + CSEGARRAY_FIRST_SHIFT);
+}
+
+segarray_t* segarray_create(size_t type_size) {
+  return segarray_createWithAllocator(type_size, NULL);
+}
+
+segarray_t* segarray_createWithAllocator(size_t type_size, allocator_t* a) {
+  segarray_t* sa = allocator_alloc(a, sizeof(segarray_t));
+  if (sa == NULL) return NULL;
+  sa->type_size = type_size;
+  sa->allocator = a;
+  for (size_t k = 0; k < CSEGARRAY_SEGMENTS; k++)
+    atomic_init(&sa->segments[k], NULL);
+  atomic_init(&sa->reserved, 0);
+  atomic_init(&sa->committed, 0);
+  return sa;
+}
+
+void segarray_destroy(segarray_t* sa) {
+  for (size_t k = 0; k < CSEGARRAY_SEGMENTS; k++) {
+    void* segment = atomic_load_explicit(&sa->segments[k], memory_order_relaxed);
+    if (segment != NULL) allocator_free(sa->allocator, segment);
+  }
+  allocator_free(sa->allocator, sa);
+}
+
+size_t segarray_size(const segarray_t* sa) {
+  return atomic_load_explicit(&((segarray_t*)sa)->committed, memory_order_acquire);
+}
+
+void* segarray_get(const segarray_t* sa, size_t idx) {
+  size_t k = _segarray_segment(idx);
+  unsigned char* segment = atomic_load_explicit(&((segarray_t*)sa)->segments[k], memory_order_acquire);
+  return segment + (idx - _segarray_segmentStart(k)) * sa->type_size;
+}
+
+void* segarray_getChecked(const segarray_t* sa, size_t idx) {
+  if (idx >= segarray_size(sa)) return NULL;
+  return segarray_get(sa, idx);
+}
+
+/// The ready flags of segment `k`, stored after its values
+static inline atomic_uchar* _segarray_flags(const segarray_t* sa, void* segment, size_t k) {
+  return (atomic_uchar*)(segment + _segarray_segmentCap(k) * sa->type_size);
+}
+
+/// Allocates the segments for the indexes `[start, end)` that don't exist yet
+/// Returns 1 if memory could not be allocated
+int _segarray_ensureSegments(segarray_t* sa, size_t start, size_t end) {
+  if (start == end) return 0;
+  size_t last = _segarray_segment(end - 1);
+  for (size_t k = _segarray_segment(start); k <= last; k++) {
+    if (atomic_load_explicit(&sa->segments[k], memory_order_acquire) != NULL) continue;
+    void* segment = allocator_alloc(sa->allocator, _segarray_segmentCap(k) * (sa->type_size + 1));
+    if (segment == NULL) return 1;
+    memset(_segarray_flags(sa, segment, k), 0, _segarray_segmentCap(k));
+    void* expected = NULL;
+    // Another thread may have installed the segment in the meantime
+    if (!atomic_compare_exchange_strong_explicit(&sa->segments[k], &expected, segment, memory_order_acq_rel, memory_order_acquire))
+      allocator_free(sa->allocator, segment);
+  }
+  return 0;
+}
+
+/// Reserves `count` indexes, their segments exist once this returns
+/// Returns the first index or -1 if memory could not be allocated
+long _segarray_reserve(segarray_t* sa, size_t count) {
+  size_t idx = atomic_load_explicit(&sa->reserved, memory_order_relaxed);
+  // The segments are allocated before the indexes are taken,
+  // so a failed allocation never leaves a reserved index that can't be committed
+  do {
+    if (_segarray_ensureSegments(sa, idx, idx + count) != 0) return -1;
+  } while (!atomic_compare_exchange_weak_explicit(&sa->reserved, &idx, idx + count, memory_order_relaxed, memory_order_relaxed));
+  return (long)idx;
+}
+
+/// Copies `count` values to the segments, starting at `idx`, and flags them as ready
+void _segarray_write(segarray_t* sa, size_t idx, const void* values, size_t count) {
+  while (count > 0) {
+    size_t k = _segarray_segment(idx);
+    size_t offset = idx - _segarray_segmentStart(k);
+    size_t n = _segarray_segmentCap(k) - offset;
+    if (n > count) n = count;
+    void* segment = atomic_load_explicit(&sa->segments[k], memory_order_acquire);
+    memcpy(segment + offset * sa->type_size, values, n * sa->type_size);
+    atomic_uchar* flags = _segarray_flags(sa, segment, k) + offset;
+    for (size_t i = 0; i < n; i++)
+      atomic_store_explicit(&flags[i], 1, memory_order_release);
+    values += n * sa->type_size;
+    idx += n;
+    count -= n;
+  }
+}
+
+/// The first index from `idx` on whose value is not ready
+size_t _segarray_readyEnd(const segarray_t* sa, size_t idx) {
+  for (;;) {
+    size_t k = _segarray_segment(idx);
+    void* segment = atomic_load_explicit(&((segarray_t*)sa)->segments[k], memory_order_acquire);
+    if (segment == NULL) return idx;
+    atomic_uchar* flags = _segarray_flags(sa, segment, k);
+    size_t start = _segarray_segmentStart(k), cap = _segarray_segmentCap(k);
+    size_t offset = idx - start;
+    while (offset < cap && atomic_load_explicit(&flags[offset], memory_order_acquire))
+      offset++;
+    idx = start + offset;
+    if (offset < cap) return idx;
+  }
+}
+
+/// Moves `committed` past every ready value
+void _segarray_commit(segarray_t* sa) {
+  // Orders the flags written by this push before reading those of the others, so that of two
+  // concurrent pushes at least one sees both flags and no ready value is left unpublished
+  atomic_thread_fence(memory_order_seq_cst);
+  size_t committed = atomic_load_explicit(&sa->committed, memory_order_acquire);
+  for (;;) {
+    size_t end = _segarray_readyEnd(sa, committed);
+    if (end == committed) return;
+    // On failure another push moved `committed`, continue from there
+    if (atomic_compare_exchange_weak_explicit(&sa->committed, &committed, end, memory_order_acq_rel, memory_order_acquire))
+      committed = end;
+  }
+}
+
+long segarray_push(segarray_t* sa, const void* value) {
+  return segarray_pushMany(sa, value, 1);
+}
+
+long segarray_pushMany(segarray_t* sa, const void* values, size_t count) {
+  long idx = _segarray_reserve(sa, count);
+  if (idx < 0) return -1;
+  _segarray_write(sa, (size_t)idx, values, count);
+  _segarray_commit(sa);
+  return idx;
+}
+
+void segarray_reset(segarray_t* sa) {
+  size_t size = atomic_load_explicit(&sa->reserved, memory_order_relaxed);
+  for (size_t k = 0; _segarray_segmentStart(k) < size; k++) {
+    size_t used = size - _segarray_segmentStart(k);
+    if (used > _segarray_segmentCap(k)) used = _segarray_segmentCap(k);
+    memset(_segarray_flags(sa, atomic_load_explicit(&sa->segments[k], memory_order_relaxed), k), 0, used);
+  }
+  atomic_store_explicit(&sa->reserved, 0, memory_order_relaxed);
+  atomic_store_explicit(&sa->committed, 0, memory_order_relaxed);
+}
+
+void* _segarrayiter_next(void* data) {
+  segarrayiter_t* iter = (segarrayiter_t*)data;
+  if ((size_t)(iter->idx + 1) >= iter->end) return NULL;
+  return segarray_get(iter->storage, (size_t)++iter->idx);
+}
+
+size_t _segarrayiter_nextBatch(void* data, void** outSpan, void* buf, size_t max) {
+  (void)buf;
+  segarrayiter_t* iter = (segarrayiter_t*)data;
+  size_t start = (size_t)(iter->idx + 1);
+  if (start >= iter->end) return 0;
+  size_t k = _segarray_segment(start);
+  size_t segmentEnd = _segarray_segmentStart(k) + _segarray_segmentCap(k);
+  size_t count = (segmentEnd < iter->end ? segmentEnd : iter->end) - start;
+  if (count > max) count = max;
+  *outSpan = segarray_get(iter->storage, start);
+  iter->idx += count;
+  return count;
+}
+
+iter_t* segarray_createIterator(segarray_t* sa) {
+  iterStorage_t* storage = malloc(sizeof(iterStorage_t));
+  if (storage == NULL) return NULL;
+  iter_t* iter = segarray_initIterator(sa, storage);
+  iter->opt &= ~ITER_IN_PLACE;
+  iter->free = (void(*)(iter_t*)) free;
+  return iter;
+}
+
+iter_t* segarray_initIterator(segarray_t* sa, iterStorage_t* storage) {
+  iter_t* iter = &storage->iter;
+  segarrayiter_t* data = (segarrayiter_t*)&storage->data;
+  data->storage = sa;
+  data->idx = -1;
+  data->end = segarray_size(sa);
+
+  iter->opt = ITER_KNOWNSIZE | ITER_ENUMERATED | ITER_IN_PLACE;
+  iter->data = data;
+  iter->next = _segarrayiter_next;
+  iter->idx = &data->idx;
+  iter->known_size = data->end;
+  iter->type_size = sa->type_size;
+  iter->contiguous_buffer = NULL;
+  iter->free = NULL;
+  iter->next_batch = _segarrayiter_nextBatch;
+  _CITERATOR_STATS_INIT(iter);
+  return iter;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
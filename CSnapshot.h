@@ -0,0 +1,325 @@
+#ifndef _CTYPES_SNAPSHOT_H
+#define _CTYPES_SNAPSHOT_H
+
+#include "CAllocator.h"
+#include "CArray.h"
+#include "CIterator.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/// On-disk format of a snapshot, all fields are in the byte order of the machine that wrote it:
+///
+/// | offset        | size  | field                                                     |
+/// |---------------|-------|-----------------------------------------------------------|
+/// | 0             | 8     | magic, `CSNAPSHOT_MAGIC`                                  |
+/// | 8             | 4     | version, `CSNAPSHOT_VERSION`                              |
+/// | 12            | 4     | byte order, `CSNAPSHOT_BYTE_ORDER` as written by the host |
+/// | 16            | 8     | `type_size`                                               |
+/// | 24            | 8     | count of elements                                         |
+/// | 32            | 4     | CRC-32C of the data                                       |
+/// | 36            | 4     | data offset, from the start of the snapshot               |
+/// | 40            | 24    | reserved, 0                                               |
+/// | data offset   | count * type_size | the elements                                  |
+///
+/// The header is followed by zeros up to the data offset, which the writer picks so that the data
+/// starts at a multiple of `CSNAPSHOT_ALIGN` in the file. Mapped snapshots are aligned the same way in memory.
+/// Snapshots are written and read at the current offset of the file, so several can follow each other.
+/// Snapshots from a machine with another byte order are rejected, the elements would need swapping.
+typedef struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t type_size;
+  uint64_t count;
+  uint32_t checksum;
+  uint32_t data_offset;
+  uint8_t reserved[24];
+} snapshotHeader_t;
+
+#define CSNAPSHOT_MAGIC "CTSNAPSH"
+#define CSNAPSHOT_VERSION 1
+#define CSNAPSHOT_BYTE_ORDER 0x01020304u
+#define CSNAPSHOT_ALIGN 64
+
+#ifndef CSNAPSHOT_BUFFER_BYTES
+/// Size of the buffer `iter_save` collects values in before writing them
+#define CSNAPSHOT_BUFFER_BYTES (64 << 10)
+#endif
+
+enum SnapshotLoadFlags {
+  /// Checks the checksum of a mapped snapshot, which reads every page of it
+  SNAPSHOT_VERIFY = 0b0001,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// == Save ==
+
+/// Writes the elements of `arr` as a snapshot at the current offset of `fd`
+/// Returns 1 if the file could not be written
+int array_save(const array_t* arr, int fd);
+/// Writes the remaining values of `iter` as a snapshot at the current offset of `fd`, in batches,
+/// so the values never have to be collected in memory. The iterator doesn't need `ITER_KNOWNSIZE`:
+/// the count and checksum are written into the header once the iterator is exhausted, so `fd` has to be seekable.
+/// Returns 1 if the file could not be written or memory could not be allocated
+int iter_save(iter_t* iter, int fd);
+
+// == Load ==
+
+/// Reads the snapshot at the current offset of `fd` into a new array and checks its checksum
+/// Returns NULL if the snapshot is invalid, has another byte order, or memory could not be allocated
+array_t* array_load(int fd);
+/// The allocator must outlive the array
+array_t* array_loadWithAllocator(int fd, allocator_t* a);
+/// Maps the snapshot at the current offset of `fd` without reading it: `data` points straight into
+/// the file and pages are loaded on first access. The array is read-only, growing it fails.
+/// `fd` can be closed right away. `flags` is a combination of `SnapshotLoadFlags`.
+/// Returns NULL if the snapshot is invalid or could not be mapped (or on platforms without mmap)
+array_t* array_loadMapped(int fd, int flags);
+
+/// CRC-32C (Castagnoli) of `len` bytes, continuing from `crc` (0 to start)
+uint32_t snapshot_crc32c(uint32_t crc, const void* data, size_t len);
+
+#ifdef CT_SNAPSHOT_IMPL
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && !defined(CARRAY_NO_SIMD)
+#define _CSNAPSHOT_X86 1
+#include <immintrin.h>
+#define _CSNAPSHOT_SSE42 __attribute__((target("sse4.2")))
+#endif
+
+_Static_assert(sizeof(snapshotHeader_t) == 64, "the snapshot header has to be 64 bytes");
+
+static const uint32_t _snapshot_crcTable[256] = {
+  0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c, 0x26a1e7e8, 0xd4ca64eb,
+  0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b, 0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24,
+  0x105ec76f, 0xe235446c, 0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+  0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc, 0xbc267848, 0x4e4dfb4b,
+  0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a, 0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35,
+  0xaa64d611, 0x580f5512, 0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+  0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad, 0x1642ae59, 0xe4292d5a,
+  0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a, 0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595,
+  0x417b1dbc, 0xb3109ebf, 0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+  0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f, 0xed03a29b, 0x1f682198,
+  0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927, 0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38,
+  0xdbfc821c, 0x2997011f, 0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+  0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e, 0x4767748a, 0xb50cf789,
+  0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859, 0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46,
+  0x7198540d, 0x83f3d70e, 0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+  0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de, 0xdde0eb2a, 0x2f8b6829,
+  0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c, 0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93,
+  0x082f63b7, 0xfa44e0b4, 0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+  0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b, 0xb4091bff, 0x466298fc,
+  0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c, 0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033,
+  0xa24bb5a6, 0x502036a5, 0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+  0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975, 0x0e330a81, 0xfc588982,
+  0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d, 0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622,
+  0x38cc2a06, 0xcaa7a905, 0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+  0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8, 0xe52cc12c, 0x1747422f,
+  0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff, 0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0,
+  0xd3d3e1ab, 0x21b862a8, 0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+  0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78, 0x7fab5e8c, 0x8dc0dd8f,
+  0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee, 0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1,
+  0x69e9f0d5, 0x9b8273d6, 0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+  0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69, 0xd5cf889d, 0x27a40b9e,
+  0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e, 0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351,
+};
+
+#ifdef _CSNAPSHOT_X86
+/// The crc32 instruction computes CRC-32C, 8 bytes at a time
+_CSNAPSHOT_SSE42 uint32_t _snapshot_crc32cSse42(uint32_t crc, const unsigned char* bytes, size_t len) {
+  uint64_t crc64 = crc;
+  for (; len >= 8; bytes += 8, len -= 8) {
+    uint64_t word;
+    memcpy(&word, bytes, 8);
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = (uint32_t)crc64;
+  for (; len > 0; bytes++, len--)
+    crc = _mm_crc32_u8(crc, *bytes);
+  return crc;
+}
+#endif
+
+uint32_t snapshot_crc32c(uint32_t crc, const void* data, size_t len) {
+  const unsigned char* bytes = data;
+  crc = ~crc;
+#ifdef _CSNAPSHOT_X86
+  if (_array_cpuFeatures() & _CARRAY_CPU_SSE42) return ~_snapshot_crc32cSse42(crc, bytes, len);
+#endif
+  for (; len > 0; bytes++, len--)
+    crc = _snapshot_crcTable[(crc ^ *bytes) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+/// Returns 1 unless all `len` bytes could be written
+int _snapshot_writeAll(int fd, const void* data, size_t len) {
+  const char* bytes = data;
+  while (len > 0) {
+    ssize_t written = write(fd, bytes, len);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return 1;
+    bytes += written;
+    len -= (size_t)written;
+  }
+  return 0;
+}
+
+/// Returns 1 unless all `len` bytes could be read
+int _snapshot_readAll(int fd, void* data, size_t len) {
+  char* bytes = data;
+  while (len > 0) {
+    ssize_t got = read(fd, bytes, len);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) return 1;
+    bytes += got;
+    len -= (size_t)got;
+  }
+  return 0;
+}
+
+/// Writes the header followed by the zeros up to the data
+int _snapshot_writeHeader(int fd, const snapshotHeader_t* header) {
+  unsigned char bytes[2 * CSNAPSHOT_ALIGN] = { 0 };
+  memcpy(bytes, header, sizeof(snapshotHeader_t));
+  return _snapshot_writeAll(fd, bytes, header->data_offset);
+}
+
+/// An empty header for a snapshot starting at byte `start` of the file
+void _snapshot_initHeader(snapshotHeader_t* header, size_t type_size, off_t start) {
+  memset(header, 0, sizeof(snapshotHeader_t));
+  memcpy(header->magic, CSNAPSHOT_MAGIC, sizeof(header->magic));
+  header->version = CSNAPSHOT_VERSION;
+  header->byte_order = CSNAPSHOT_BYTE_ORDER;
+  header->type_size = type_size;
+  // Unseekable files count as starting at 0
+  size_t misalign = (size_t)(start < 0 ? 0 : start) % CSNAPSHOT_ALIGN;
+  header->data_offset = sizeof(snapshotHeader_t) + (CSNAPSHOT_ALIGN - misalign) % CSNAPSHOT_ALIGN;
+}
+
+/// Returns 1 if `header` isn't a snapshot this build can read
+int _snapshot_checkHeader(const snapshotHeader_t* header) {
+  if (memcmp(header->magic, CSNAPSHOT_MAGIC, sizeof(header->magic)) != 0) return 1;
+  if (header->byte_order != CSNAPSHOT_BYTE_ORDER || header->version != CSNAPSHOT_VERSION) return 1;
+  if (header->type_size == 0 || header->type_size > SIZE_MAX || header->count > SIZE_MAX / header->type_size) return 1;
+  return header->data_offset < sizeof(snapshotHeader_t);
+}
+
+int array_save(const array_t* arr, int fd) {
+  snapshotHeader_t header;
+  _snapshot_initHeader(&header, arr->type_size, lseek(fd, 0, SEEK_CUR));
+  size_t bytes = arr->size * arr->type_size;
+  header.count = arr->size;
+  header.checksum = snapshot_crc32c(0, arr->data, bytes);
+  if (_snapshot_writeHeader(fd, &header) != 0) return 1;
+  return _snapshot_writeAll(fd, arr->data, bytes);
+}
+
+int iter_save(iter_t* iter, int fd) {
+  off_t start = lseek(fd, 0, SEEK_CUR);
+  if (start < 0) return 1;
+  size_t ts = iter->type_size;
+  size_t cap = CSNAPSHOT_BUFFER_BYTES < ts ? ts : CSNAPSHOT_BUFFER_BYTES;
+  unsigned char* buf = malloc(cap);
+  if (buf == NULL) return 1;
+
+  // The header is rewritten with the count and checksum at the end
+  snapshotHeader_t header;
+  _snapshot_initHeader(&header, ts, start);
+  int failed = _snapshot_writeHeader(fd, &header);
+  // Spans of contiguous iterators point into their storage, they are written without copying
+  bool contiguous = (iter->opt & ITER_CONTIGUOUS) && iter->next_batch != NULL;
+  size_t fill = 0;
+  uint32_t crc = 0;
+  while (!failed) {
+    size_t room = (cap - fill) / ts;
+    if (room == 0) {
+      failed = _snapshot_writeAll(fd, buf, fill);
+      fill = 0;
+      continue;
+    }
+    void* span;
+    size_t count = iter_nextBatch(iter, &span, buf + fill, contiguous ? SIZE_MAX / ts : room);
+    if (count == 0) break;
+    size_t bytes = count * ts;
+    crc = snapshot_crc32c(crc, span, bytes);
+    header.count += count;
+    if (span == buf + fill) {
+      fill += bytes;
+    } else {
+      failed = _snapshot_writeAll(fd, buf, fill) || _snapshot_writeAll(fd, span, bytes);
+      fill = 0;
+    }
+  }
+  if (!failed) failed = _snapshot_writeAll(fd, buf, fill);
+  free(buf);
+  if (failed) return 1;
+
+  header.checksum = crc;
+  return pwrite(fd, &header, sizeof(snapshotHeader_t), start) != (ssize_t)sizeof(snapshotHeader_t);
+}
+
+array_t* array_load(int fd) {
+  return array_loadWithAllocator(fd, NULL);
+}
+
+array_t* array_loadWithAllocator(int fd, allocator_t* a) {
+  snapshotHeader_t header;
+  if (_snapshot_readAll(fd, &header, sizeof(snapshotHeader_t)) != 0 || _snapshot_checkHeader(&header) != 0)
+    return NULL;
+  unsigned char padding[CSNAPSHOT_ALIGN];
+  for (size_t skip = header.data_offset - sizeof(snapshotHeader_t); skip > 0;) {
+    size_t len = skip < sizeof(padding) ? skip : sizeof(padding);
+    if (_snapshot_readAll(fd, padding, len) != 0) return NULL;
+    skip -= len;
+  }
+
+  array_t* arr = array_createWithCapAndAllocator(header.type_size, header.count, a);
+  if (arr == NULL) return NULL;
+  size_t bytes = header.count * header.type_size;
+  if ((bytes > 0 && arr->data == NULL) || _snapshot_readAll(fd, arr->data, bytes) != 0
+      || snapshot_crc32c(0, arr->data, bytes) != header.checksum) {
+    array_destroy(arr);
+    return NULL;
+  }
+  arr->size = header.count;
+  _CARRAY_STAT_SIZE(arr);
+  return arr;
+}
+
+array_t* array_loadMapped(int fd, int flags) {
+  off_t start = lseek(fd, 0, SEEK_CUR);
+  struct stat st;
+  snapshotHeader_t header;
+  if (start < 0 || fstat(fd, &st) != 0) return NULL;
+  if (pread(fd, &header, sizeof(snapshotHeader_t), start) != (ssize_t)sizeof(snapshotHeader_t)) return NULL;
+  if (_snapshot_checkHeader(&header) != 0) return NULL;
+  size_t bytes = header.count * header.type_size;
+  size_t end = (size_t)start + header.data_offset + bytes;
+  if (end < bytes || end > (size_t)st.st_size) return NULL;
+
+  array_t* arr = array_mapReadOnly(fd, (size_t)start + header.data_offset, header.count, header.type_size);
+  if (arr == NULL) return NULL;
+  if ((flags & SNAPSHOT_VERIFY) && snapshot_crc32c(0, arr->data, bytes) != header.checksum) {
+    array_destroy(arr);
+    return NULL;
+  }
+  lseek(fd, (off_t)end, SEEK_SET);
+  return arr;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef _CTYPES_SOA_H
+#define _CTYPES_SOA_H
+
+#include "CAllocator.h"
+#include "CArray.h"
+#include "CIterator.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/// Struct of arrays: records are split into their fields and every field is stored
+/// in its own array (column), so scanning one field only reads that field's bytes.
+/// All columns always have `size` elements, row `i` is element `i` of every column.
+///
+/// ```c
+/// soa_t* points = soa_create((size_t[]){ sizeof(int32_t), sizeof(double), sizeof(double) }, 3);
+/// soa_push(points, (const void*[]){ &id, &x, &y });
+/// iter_t* xs = soa_fieldIterator(points, 1);
+/// ```
+typedef struct SoA {
+  size_t size;
+  size_t field_count;
+  /// One array per field, initialized in place
+  array_t* columns;
+  /// Used for the container and its columns, `NULL` uses malloc/realloc/free
+  allocator_t* allocator;
+} soa_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// == Create ==
+/// `field_sizes` holds the size of each of the `field_count` fields
+soa_t* soa_create(const size_t* field_sizes, size_t field_count);
+/// The allocator must outlive the container
+soa_t* soa_createWithAllocator(const size_t* field_sizes, size_t field_count, allocator_t* a);
+
+// == Destroy ==
+void soa_destroy(soa_t* soa);
+
+// == Access ==
+
+/// The array holding `field`, it can be read with every `array_*` function
+/// Changing its size directly breaks the other columns
+array_t* soa_column(const soa_t* soa, size_t field);
+void* soa_get(const soa_t* soa, size_t field, size_t idx);
+/// Copies one value per field from `values` into row `idx`
+void soa_set(soa_t* soa, size_t idx, const void* const* values);
+
+/// Copies one value per field from `values` to a new row at the end
+/// Returns 1 if memory could not be allocated, no column is changed in that case
+int soa_push(soa_t* soa, const void* const* values);
+/// Removes the last row, storing its fields in `outValues` (which can be NULL, as can its entries)
+/// Returns the new size or -1 if size is already 0
+long soa_pop(soa_t* soa, void* const* outValues);
+void soa_swap(soa_t* soa, size_t idx1, size_t idx2);
+
+// == Memory ==
+
+/// Returns 1 if memory couldn't be allocated
+int soa_reserveAtLeast(soa_t* soa, size_t newCap);
+void soa_reset(soa_t* soa);
+
+// == Sort ==
+
+/// Stable sort of the rows by the values of `field`
+/// Returns 1 if memory could not be allocated, the rows are left untouched in that case
+int soa_sortByField(soa_t* soa, size_t field, ArrayCmpFn compare);
+
+// == Iterators ==
+
+/// A contiguous iterator over the values of `field`, like `array_createIterator` on its column
+iter_t* soa_fieldIterator(soa_t* soa, size_t field);
+
+#ifdef CT_SOA_IMPL
+
+#include <string.h>
+
+soa_t* soa_create(const size_t* field_sizes, size_t field_count) {
+  return soa_createWithAllocator(field_sizes, field_count, NULL);
+}
+
+soa_t* soa_createWithAllocator(const size_t* field_sizes, size_t field_count, allocator_t* a) {
+  soa_t* soa = allocator_alloc(a, sizeof(soa_t) + field_count * sizeof(array_t));
+  if (soa == NULL) return NULL;
+  soa->size = 0;
+  soa->field_count = field_count;
+  soa->columns = (array_t*)(soa + 1);
+  soa->allocator = a;
+  for (size_t f = 0; f < field_count; f++)
+    array_initInPlace(&soa->columns[f], field_sizes[f], NULL, 0, a);
+  return soa;
+}
+
+void soa_destroy(soa_t* soa) {
+  for (size_t f = 0; f < soa->field_count; f++)
+    array_destroy(&soa->columns[f]);
+  allocator_free(soa->allocator, soa);
+}
+
+array_t* soa_column(const soa_t* soa, size_t field) {
+  return &soa->columns[field];
+}
+
+void* soa_get(const soa_t* soa, size_t field, size_t idx) {
+  return array_get(&soa->columns[field], idx);
+}
+
+void soa_set(soa_t* soa, size_t idx, const void* const* values) {
+  for (size_t f = 0; f < soa->field_count; f++)
+    array_set(&soa->columns[f], idx, values[f]);
+}
+
+int soa_push(soa_t* soa, const void* const* values) {
+  // Every column grows first, so that a failure leaves the rows consistent
+  for (size_t f = 0; f < soa->field_count; f++)
+    if (array_reserve(&soa->columns[f], 1) != 0) return 1;
+  for (size_t f = 0; f < soa->field_count; f++)
+    array_push(&soa->columns[f], values[f]);
+  soa->size += 1;
+  return 0;
+}
+
+long soa_pop(soa_t* soa, void* const* outValues) {
+  if (soa->size == 0) return -1;
+  for (size_t f = 0; f < soa->field_count; f++)
+    array_pop(&soa->columns[f], outValues == NULL ? NULL : outValues[f]);
+  soa->size -= 1;
+  return soa->size;
+}
+
+void soa_swap(soa_t* soa, size_t idx1, size_t idx2) {
+  for (size_t f = 0; f < soa->field_count; f++)
+    array_swap(&soa->columns[f], idx1, idx2);
+}
+
+int soa_reserveAtLeast(soa_t* soa, size_t newCap) {
+  for (size_t f = 0; f < soa->field_count; f++)
+    if (array_reserveAtLeast(&soa->columns[f], newCap) != 0) return 1;
+  return 0;
+}
+
+void soa_reset(soa_t* soa) {
+  for (size_t f = 0; f < soa->field_count; f++)
+    array_reset(&soa->columns[f]);
+  soa->size = 0;
+}
+
+int soa_sortByField(soa_t* soa, size_t field, ArrayCmpFn compare) {
+  if (soa->size < 2) return 0;
+  // Sort (key, row) entries, the comparator only reads the key at the start of an entry
+  size_t keySize = soa->columns[field].type_size;
+  size_t rowOffset = (keySize + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+  array_t entries;
+  array_initInPlace(&entries, rowOffset + sizeof(size_t), NULL, 0, soa->allocator);
+  if (array_reserveAtLeast(&entries, soa->size) != 0) return 1;
+  for (size_t i = 0; i < soa->size; i++) {
+    unsigned char* entry = array_get(&entries, i);
+    memcpy(entry, soa_get(soa, field, i), keySize);
+    memcpy(entry + rowOffset, &i, sizeof(size_t));
+  }
+  entries.size = soa->size;
+  if (array_mergeSort(&entries, compare, NULL) != 0) {
+    array_destroy(&entries);
+    return 1;
+  }
+
+  // Gather every column in the sorted order into `scratch` and copy it back
+  size_t maxSize = 0;
+  for (size_t f = 0; f < soa->field_count; f++)
+    if (soa->columns[f].type_size > maxSize) maxSize = soa->columns[f].type_size;
+  unsigned char* scratch = allocator_alloc(soa->allocator, maxSize * soa->size);
+  if (scratch == NULL) {
+    array_destroy(&entries);
+    return 1;
+  }
+  for (size_t f = 0; f < soa->field_count; f++) {
+    array_t* column = &soa->columns[f];
+    size_t ts = column->type_size;
+    for (size_t i = 0; i < soa->size; i++) {
+      size_t row;
+      memcpy(&row, (unsigned char*)array_get(&entries, i) + rowOffset, sizeof(size_t));
+      memcpy(scratch + i * ts, array_get(column, row), ts);
+    }
+    memcpy(column->data, scratch, soa->size * ts);
+  }
+  allocator_free(soa->allocator, scratch);
+  array_destroy(&entries);
+  return 0;
+}
+
+iter_t* soa_fieldIterator(soa_t* soa, size_t field) {
+  return array_createIterator(&soa->columns[field]);
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+// Single element array operations: push/pop at the end, insert/popAt in the middle and at the front
+//   cc -O2 bench/array_ops.c -o array_ops && ./array_ops
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+
+#define COUNT 10000000
+#define SHIFTING_COUNT 50000
+#define BATCH 1000
+
+int main(void) {
+  array_t* arr = array_create(sizeof(int));
+
+  double t = bench_now();
+  for (int i = 0; i < COUNT; i++)
+    array_push(arr, &i);
+  bench_report("push", COUNT, bench_now() - t);
+
+  int value;
+  long long sum = 0;
+  t = bench_now();
+  for (int i = 0; i < COUNT; i++) {
+    array_pop(arr, &value);
+    sum += value;
+  }
+  BENCH_KEEP(&sum);
+  bench_report("pop", COUNT, bench_now() - t);
+
+  // Push and pop on a warm array, without reallocations
+  t = bench_now();
+  for (int i = 0; i < COUNT; i++) {
+    array_push(arr, &i);
+    array_pop(arr, &value);
+  }
+  BENCH_KEEP(&value);
+  bench_report("push+pop warm", COUNT, bench_now() - t);
+
+  // Inserting in the middle moves half of the elements
+  array_reset(arr);
+  t = bench_now();
+  for (int i = 0; i < SHIFTING_COUNT; i++)
+    array_insert(arr, arr->size / 2, &i);
+  bench_report("insert middle", SHIFTING_COUNT, bench_now() - t);
+
+  t = bench_now();
+  for (int i = 0; i < SHIFTING_COUNT; i++)
+    array_popAt(arr, arr->size / 2, &value);
+  BENCH_KEEP(&value);
+  bench_report("popAt middle", SHIFTING_COUNT, bench_now() - t);
+
+  t = bench_now();
+  for (int i = 0; i < SHIFTING_COUNT; i++)
+    array_pushFirst(arr, &i);
+  bench_report("pushFirst", SHIFTING_COUNT, bench_now() - t);
+
+  t = bench_now();
+  for (int i = 0; i < SHIFTING_COUNT; i++)
+    array_popFirst(arr, &value);
+  BENCH_KEEP(&value);
+  bench_report("popFirst", SHIFTING_COUNT, bench_now() - t);
+
+  // Ingesting batches of records, one push per element against one pushMany per batch
+  int batch[BATCH];
+  for (int i = 0; i < BATCH; i++) batch[i] = i;
+  array_resetRemovingCapacity(arr);
+  t = bench_now();
+  for (int b = 0; b < COUNT / BATCH; b++) {
+    for (int i = 0; i < BATCH; i++)
+      array_push(arr, &batch[i]);
+  }
+  bench_report("push batches of 1000", COUNT, bench_now() - t);
+
+  array_resetRemovingCapacity(arr);
+  t = bench_now();
+  for (int b = 0; b < COUNT / BATCH; b++)
+    array_pushMany(arr, batch, BATCH);
+  bench_report("pushMany batches of 1000", COUNT, bench_now() - t);
+
+  // Removing a slice from the middle, one element at a time against a single move
+  t = bench_now();
+  for (int i = 0; i < 100; i++) {
+    for (int j = 0; j < 100; j++)
+      array_popAt(arr, arr->size / 2, NULL);
+  }
+  bench_report("popAt x100 middle", 100 * 100, bench_now() - t);
+
+  t = bench_now();
+  for (int i = 0; i < 100; i++)
+    array_removeRange(arr, arr->size / 2, 100);
+  bench_report("removeRange 100 middle", 100 * 100, bench_now() - t);
+
+  array_destroy(arr);
+  return 0;
+}
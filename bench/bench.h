@@ -0,0 +1,78 @@
+#ifndef _CTYPES_BENCH_H
+#define _CTYPES_BENCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/// Name of the suite in machine-readable output, defaults to the benchmark's source file
+#ifndef BENCH_SUITE
+#define BENCH_SUITE __BASE_FILE__
+#endif
+
+/// Keeps the compiler from optimizing away `ptr` and whatever it points to
+#define BENCH_KEEP(ptr) __asm__ volatile("" : : "r"(ptr) : "memory")
+
+static inline double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/// Peak resident set size of the process so far in KiB
+static inline long bench_peakRssKb(void) {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+#define BENCH_TEXT 0
+#define BENCH_CSV 1
+#define BENCH_JSON 2
+
+/// Selected with the `BENCH_FORMAT` environment variable: `text` (default), `csv` or `json`.
+/// `json` prints one object per line.
+static inline int bench_format(void) {
+  static int format = -1;
+  if (format < 0) {
+    const char* env = getenv("BENCH_FORMAT");
+    format = BENCH_TEXT;
+    if (env != NULL && strcmp(env, "csv") == 0) format = BENCH_CSV;
+    if (env != NULL && strcmp(env, "json") == 0) format = BENCH_JSON;
+  }
+  return format;
+}
+
+static inline void bench_report(const char* name, size_t ops, double seconds) {
+  double nsPerOp = seconds * 1e9 / (double)ops;
+  double mops = (double)ops / seconds * 1e-6;
+  long rss = bench_peakRssKb();
+
+  switch (bench_format()) {
+  case BENCH_CSV: {
+    static int header = 0;
+    if (!header) {
+      printf("suite,name,ops,seconds,ns_per_op,mops_per_s,peak_rss_kb\n");
+      header = 1;
+    }
+    printf("%s,\"%s\",%zu,%.6f,%.3f,%.3f,%ld\n", BENCH_SUITE, name, ops, seconds, nsPerOp, mops, rss);
+    break;
+  }
+  case BENCH_JSON:
+    printf("{\"suite\":\"%s\",\"name\":\"%s\",\"ops\":%zu,\"seconds\":%.6f,\"ns_per_op\":%.3f,\"mops_per_s\":%.3f,\"peak_rss_kb\":%ld}\n",
+      BENCH_SUITE, name, ops, seconds, nsPerOp, mops, rss);
+    break;
+  default:
+    printf("%-40s %10.3f ns/op %12.2f Mops/s %10ld KiB peak\n", name, nsPerOp, mops, rss);
+  }
+  fflush(stdout);
+}
+
+#endif
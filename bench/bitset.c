@@ -0,0 +1,79 @@
+// Selecting the elements matching two predicates: index arrays against bitset selection vectors
+//   cc -O2 bench/bitset.c -o bitset && ./bitset
+#include "bench.h"
+#include <stdint.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_BITSET_IMPL
+#include "../CBitset.h"
+
+#define COUNT (4 << 20)
+#define ROUNDS 5
+
+bool isOdd(const void* value) {
+  return *(const int32_t*)value & 1;
+}
+
+bool isLarge(const void* value) {
+  return *(const int32_t*)value > 1 << 20;
+}
+
+int main(void) {
+  array_t* arr = array_createWithCap(sizeof(int32_t), COUNT);
+  for (size_t i = 0; i < COUNT; i++) {
+    int32_t v = (int32_t)((i * 2654435761u) % (4 << 20));
+    array_push(arr, &v);
+  }
+  array_t* out = array_createWithCap(sizeof(int32_t), COUNT);
+
+  // Indexes of both predicates, intersected, then copied
+  size_t selected = 0;
+  double t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    array_t* odd = array_create(sizeof(size_t));
+    array_t* large = array_create(sizeof(size_t));
+    iter_t* iter = array_createIterator(arr);
+    iter_findAllIndexes(iter, odd, isOdd);
+    iter_destroy(iter);
+    iter = array_createIterator(arr);
+    iter_findAllIndexes(iter, large, isLarge);
+    iter_destroy(iter);
+    array_t* both = array_intersectSorted(odd, large, array_cmpI64);
+    array_reset(out);
+    for (size_t i = 0; i < both->size; i++)
+      array_push(out, array_get(arr, *(size_t*)array_get(both, i)));
+    selected = out->size;
+    array_destroy(odd);
+    array_destroy(large);
+    array_destroy(both);
+  }
+  bench_report("iter_findAllIndexes x2, intersect, copy", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    bitset_t* odd = bitset_create(0);
+    bitset_t* large = bitset_create(0);
+    iter_t* iter = array_createIterator(arr);
+    iter_findAllBits(iter, odd, isOdd);
+    iter_destroy(iter);
+    iter = array_createIterator(arr);
+    iter_findAllBits(iter, large, isLarge);
+    iter_destroy(iter);
+    bitset_and(odd, large);
+    array_reset(out);
+    array_gather(arr, odd, out);
+    bitset_destroy(odd);
+    bitset_destroy(large);
+  }
+  bench_report("iter_findAllBits x2, bitset_and, array_gather", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  if (out->size != selected) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+  array_destroy(out);
+  array_destroy(arr);
+  return 0;
+}
@@ -0,0 +1,74 @@
+// Streaming a file of records through iter_reduce: reading it all into an array first,
+// reading through a reused buffer, and reading ahead on a second thread
+//   cc -O2 -pthread bench/file_iterator.c -o file_iterator && ./file_iterator
+#include "bench.h"
+#include <unistd.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_FILEITERATOR_IMPL
+#include "../CFileIterator.h"
+
+#define COUNT (4 << 20)
+
+typedef struct {
+  uint64_t key;
+  uint64_t value;
+} record_t;
+
+/// Some work per record, so that reading and processing can overlap
+void mix(const void* in, void* out) {
+  const record_t* r = in;
+  uint64_t h = r->key ^ *(uint64_t*)out;
+  for (int i = 0; i < 8; i++)
+    h = (h ^ (h >> 29)) * 0xbf58476d1ce4e5b9ull;
+  *(uint64_t*)out = h + r->value;
+}
+
+int main(void) {
+  char path[] = "/tmp/bench_file_iterator_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) return 1;
+  array_t* records = array_createWithCap(sizeof(record_t), COUNT);
+  for (uint64_t i = 0; i < COUNT; i++) {
+    record_t r = { i * 2654435761u, i };
+    array_push(records, &r);
+  }
+  if (write(fd, records->data, COUNT * sizeof(record_t)) != COUNT * sizeof(record_t)) return 1;
+  close(fd);
+  array_destroy(records);
+
+  uint64_t slurped = 0;
+  double t = bench_now();
+  FILE* file = fopen(path, "rb");
+  array_t* arr = array_createWithCap(sizeof(record_t), COUNT);
+  arr->size = fread(arr->data, sizeof(record_t), COUNT, file);
+  fclose(file);
+  iter_t* iter = array_createIterator(arr);
+  iter_reduce(iter, &slurped, mix);
+  iter_destroy(iter);
+  bench_report("fread into array + iter_reduce", COUNT, bench_now() - t);
+  array_destroy(arr);
+
+  uint64_t streamed = 0;
+  t = bench_now();
+  iter = iter_fromFile(path, sizeof(record_t), 0);
+  iter_reduce(iter, &streamed, mix);
+  iter_destroy(iter);
+  bench_report("iter_fromFile + iter_reduce", COUNT, bench_now() - t);
+
+  uint64_t readAhead = 0;
+  t = bench_now();
+  iter = iter_fromFile(path, sizeof(record_t), FILEITER_READ_AHEAD);
+  iter_reduce(iter, &readAhead, mix);
+  iter_destroy(iter);
+  bench_report("iter_fromFile read-ahead + iter_reduce", COUNT, bench_now() - t);
+
+  unlink(path);
+  if (slurped != streamed || slurped != readAhead) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+  return 0;
+}
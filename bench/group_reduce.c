@@ -0,0 +1,109 @@
+// Per-key sums of samples: sorting and scanning against hash aggregation, with and without partitions
+//   cc -O2 bench/group_reduce.c -o group_reduce && ./group_reduce
+#include "bench.h"
+#include <stdint.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_HASHMAP_IMPL
+#include "../CHashMap.h"
+
+#define COUNT (4 << 20)
+
+typedef struct {
+  uint64_t key;
+  int64_t value;
+} sample_t;
+
+int cmpSample(const void* a, const void* b) {
+  uint64_t x = ((const sample_t*)a)->key, y = ((const sample_t*)b)->key;
+  return (x > y) - (x < y);
+}
+
+void sampleKey(const void* sample, void* outKey) {
+  *(uint64_t*)outKey = ((const sample_t*)sample)->key;
+}
+
+void addValue(const void* in, void* acc) {
+  *(int64_t*)acc += ((const sample_t*)in)->value;
+}
+
+/// Sorts a copy of `samples` and sums the runs of equal keys
+int64_t sortAndScan(const array_t* samples, size_t* outGroups) {
+  array_t* sorted = array_createWithCap(sizeof(sample_t), samples->size);
+  memcpy(sorted->data, samples->data, samples->size * sizeof(sample_t));
+  sorted->size = samples->size;
+  array_sort(sorted, cmpSample, NULL);
+  const sample_t* s = sorted->data;
+  int64_t checksum = 0;
+  size_t groups = 0;
+  for (size_t i = 0; i < sorted->size;) {
+    int64_t sum = 0;
+    size_t j = i;
+    for (; j < sorted->size && s[j].key == s[i].key; j++)
+      sum += s[j].value;
+    checksum += sum ^ (int64_t)s[i].key;
+    groups++;
+    i = j;
+  }
+  array_destroy(sorted);
+  *outGroups = groups;
+  return checksum;
+}
+
+int64_t groupReduce(array_t* samples, size_t budget, size_t* outGroups) {
+  groupReduceOptions_t options = { .hash = hashmap_hashU64, .eq = hashmap_eqU64, .budget = budget };
+  iter_t* iter = array_createIterator(samples);
+  array_t* sums = iter_groupReduceWithOptions(iter, sampleKey, sizeof(uint64_t), sizeof(int64_t), NULL, addValue, &options);
+  iter_destroy(iter);
+  int64_t checksum = 0;
+  for (size_t i = 0; i < sums->size; i++) {
+    const uint64_t* record = array_get(sums, i);
+    checksum += (int64_t)record[1] ^ (int64_t)record[0];
+  }
+  *outGroups = sums->size;
+  array_destroy(sums);
+  return checksum;
+}
+
+int main(void) {
+  size_t cardinalities[] = { 1000, 1 << 20 };
+  array_t* samples = array_createWithCap(sizeof(sample_t), COUNT);
+  int failed = 0;
+
+  for (size_t c = 0; c < sizeof(cardinalities) / sizeof(cardinalities[0]); c++) {
+    size_t keys = cardinalities[c];
+    array_reset(samples);
+    for (size_t i = 0; i < COUNT; i++) {
+      sample_t s = { ((uint64_t)i * 2654435761u) % keys * 0x9E3779B97F4A7C15ull, (int64_t)(i & 1023) };
+      array_push(samples, &s);
+    }
+    char name[64];
+    size_t sortedGroups, hashedGroups, flatGroups;
+
+    double t = bench_now();
+    int64_t sorted = sortAndScan(samples, &sortedGroups);
+    snprintf(name, sizeof(name), "sort + scan, %zu keys", keys);
+    bench_report(name, COUNT, bench_now() - t);
+
+    t = bench_now();
+    int64_t hashed = groupReduce(samples, CHASHMAP_GROUP_BUDGET, &hashedGroups);
+    snprintf(name, sizeof(name), "iter_groupReduce, %zu keys", keys);
+    bench_report(name, COUNT, bench_now() - t);
+
+    t = bench_now();
+    int64_t flat = groupReduce(samples, 0, &flatGroups);
+    snprintf(name, sizeof(name), "iter_groupReduce unpartitioned, %zu keys", keys);
+    bench_report(name, COUNT, bench_now() - t);
+
+    failed |= sorted != hashed || sorted != flat || sortedGroups != hashedGroups || sortedGroups != flatGroups;
+  }
+
+  array_destroy(samples);
+  if (failed) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+  return 0;
+}
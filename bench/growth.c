@@ -0,0 +1,63 @@
+// Growth patterns: pushing into an empty array, a reserved array, a reused array and many small arrays,
+// over several element sizes
+//   cc -O2 bench/growth.c -o growth && ./growth
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+
+#define TOTAL_BYTES (64 << 20)
+#define SMALL_ARRAYS 100000
+#define SMALL_COUNT 16
+
+void run(size_t typeSize) {
+  size_t count = TOTAL_BYTES / typeSize;
+  unsigned char value[typeSize];
+  memset(value, 7, typeSize);
+  char name[64];
+
+  double t = bench_now();
+  array_t* arr = array_create(typeSize);
+  for (size_t i = 0; i < count; i++)
+    array_push(arr, value);
+  BENCH_KEEP(arr->data);
+  snprintf(name, sizeof(name), "%zuB push from empty", typeSize);
+  bench_report(name, count, bench_now() - t);
+  array_destroy(arr);
+
+  t = bench_now();
+  arr = array_createWithCap(typeSize, count);
+  for (size_t i = 0; i < count; i++)
+    array_push(arr, value);
+  BENCH_KEEP(arr->data);
+  snprintf(name, sizeof(name), "%zuB push reserved", typeSize);
+  bench_report(name, count, bench_now() - t);
+
+  // The capacity is kept after a reset
+  array_reset(arr);
+  t = bench_now();
+  for (size_t i = 0; i < count; i++)
+    array_push(arr, value);
+  BENCH_KEEP(arr->data);
+  snprintf(name, sizeof(name), "%zuB push after reset", typeSize);
+  bench_report(name, count, bench_now() - t);
+  array_destroy(arr);
+
+  t = bench_now();
+  for (size_t a = 0; a < SMALL_ARRAYS; a++) {
+    arr = array_create(typeSize);
+    for (size_t i = 0; i < SMALL_COUNT; i++)
+      array_push(arr, value);
+    BENCH_KEEP(arr->data);
+    array_destroy(arr);
+  }
+  snprintf(name, sizeof(name), "%zuB %d-element arrays", typeSize, SMALL_COUNT);
+  bench_report(name, (size_t)SMALL_ARRAYS * SMALL_COUNT, bench_now() - t);
+}
+
+int main(void) {
+  run(4);
+  run(16);
+  run(64);
+  run(256);
+  return 0;
+}
@@ -0,0 +1,60 @@
+// Growth policies: time and worst single push while growing a large array, with the data in a
+// huge page mapping (the default above CARRAY_HUGE_THRESHOLD) or reallocated by malloc,
+// and the capacity left unused by each policy
+//   cc -O2 bench/growth_policy.c -o growth_policy && ./growth_policy
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+
+#define COUNT (64 << 20)
+
+void* mallocAlloc(size_t size, void* ctx) {
+  (void)ctx;
+  return malloc(size);
+}
+
+void* mallocRealloc(void* ptr, size_t size, void* ctx) {
+  (void)ctx;
+  return realloc(ptr, size);
+}
+
+void mallocFree(void* ptr, void* ctx) {
+  (void)ctx;
+  free(ptr);
+}
+
+/// A non-NULL allocator keeps the array out of the huge page mapping
+static allocator_t plainMalloc = { .alloc = mallocAlloc, .realloc = mallocRealloc, .free = mallocFree };
+
+void run(const char* label, allocator_t* a, ArrayGrowthFn growth) {
+  array_t* arr = array_createWithAllocator(sizeof(uint64_t), a);
+  arr->growth = growth;
+  double worst = 0;
+  double t = bench_now();
+  for (uint64_t i = 0; i < COUNT; i++) {
+    if (arr->size == arr->cap) {
+      double start = bench_now();
+      array_push(arr, &i);
+      double spent = bench_now() - start;
+      if (spent > worst) worst = spent;
+    } else {
+      array_push(arr, &i);
+    }
+  }
+  BENCH_KEEP(arr->data);
+  double seconds = bench_now() - t;
+
+  char name[128];
+  snprintf(name, sizeof(name), "%s (worst push %.2f ms, %.0f%% unused)",
+    label, worst * 1e3, 100.0 * (double)(arr->cap - arr->size) / (double)arr->cap);
+  bench_report(name, COUNT, seconds);
+  array_destroy(arr);
+}
+
+int main(void) {
+  run("huge mapping, double", NULL, array_growthDouble);
+  run("huge mapping, 1.5x", NULL, array_growthOneAndHalf);
+  run("malloc, double", &plainMalloc, array_growthDouble);
+  run("malloc, 1.5x", &plainMalloc, array_growthOneAndHalf);
+  return 0;
+}
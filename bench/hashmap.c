@@ -0,0 +1,150 @@
+// uint64 -> uint64 lookups: CHashMap against a linear scan over an array_t and a chained hash table
+//   cc -O2 bench/hashmap.c -o hashmap && ./hashmap
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_HASHMAP_IMPL
+#include "../CHashMap.h"
+
+#define LOOKUPS 4000000
+#define LINEAR_LOOKUPS 20000
+
+typedef struct {
+  uint64_t key;
+  uint64_t value;
+} pair_t;
+
+/// Separate chaining with one allocation per entry, the classic textbook map
+typedef struct ChainNode {
+  struct ChainNode* next;
+  pair_t pair;
+} chainNode_t;
+
+typedef struct {
+  chainNode_t** buckets;
+  size_t mask;
+} chained_t;
+
+void chained_init(chained_t* map, size_t count) {
+  size_t buckets = 16;
+  while (buckets < count) buckets *= 2;
+  map->buckets = calloc(buckets, sizeof(chainNode_t*));
+  map->mask = buckets - 1;
+}
+
+void chained_put(chained_t* map, uint64_t key, uint64_t value) {
+  chainNode_t** bucket = &map->buckets[hashmap_hashU64(&key) & map->mask];
+  chainNode_t* node = malloc(sizeof(chainNode_t));
+  node->pair = (pair_t) { key, value };
+  node->next = *bucket;
+  *bucket = node;
+}
+
+uint64_t* chained_get(const chained_t* map, uint64_t key) {
+  for (chainNode_t* node = map->buckets[hashmap_hashU64(&key) & map->mask]; node != NULL; node = node->next)
+    if (node->pair.key == key) return &node->pair.value;
+  return NULL;
+}
+
+void chained_destroy(chained_t* map) {
+  for (size_t i = 0; i <= map->mask; i++) {
+    chainNode_t* node = map->buckets[i];
+    while (node != NULL) {
+      chainNode_t* next = node->next;
+      free(node);
+      node = next;
+    }
+  }
+  free(map->buckets);
+}
+
+static uint64_t needle;
+
+bool isNeedle(const void* value) {
+  return ((const pair_t*)value)->key == needle;
+}
+
+uint64_t keyAt(size_t i) {
+  return (uint64_t)i * 0x9E3779B97F4A7C15ull;
+}
+
+void run(size_t count) {
+  char name[64];
+  uint64_t* queries = malloc(LOOKUPS * sizeof(uint64_t));
+  uint64_t seed = 88172645463325252ull;
+  for (size_t i = 0; i < LOOKUPS; i++) {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    queries[i] = keyAt(seed % count);
+  }
+
+  hashmap_t* map = hashmap_create(sizeof(uint64_t), sizeof(uint64_t), hashmap_hashU64, hashmap_eqU64);
+  double t = bench_now();
+  for (size_t i = 0; i < count; i++) {
+    uint64_t key = keyAt(i);
+    hashmap_put(map, &key, &i);
+  }
+  snprintf(name, sizeof(name), "hashmap put x %zu", count);
+  bench_report(name, count, bench_now() - t);
+
+  chained_t chained;
+  chained_init(&chained, count);
+  t = bench_now();
+  for (size_t i = 0; i < count; i++)
+    chained_put(&chained, keyAt(i), i);
+  snprintf(name, sizeof(name), "chained put x %zu", count);
+  bench_report(name, count, bench_now() - t);
+
+  array_t* pairs = array_createWithCap(sizeof(pair_t), count);
+  for (size_t i = 0; i < count; i++) {
+    pair_t pair = { keyAt(i), i };
+    array_push(pairs, &pair);
+  }
+
+  uint64_t mapSum = 0;
+  t = bench_now();
+  for (size_t i = 0; i < LOOKUPS; i++)
+    mapSum += *(uint64_t*)hashmap_get(map, &queries[i]);
+  snprintf(name, sizeof(name), "hashmap get x %zu", count);
+  bench_report(name, LOOKUPS, bench_now() - t);
+
+  uint64_t chainedSum = 0;
+  t = bench_now();
+  for (size_t i = 0; i < LOOKUPS; i++)
+    chainedSum += *chained_get(&chained, queries[i]);
+  snprintf(name, sizeof(name), "chained get x %zu", count);
+  bench_report(name, LOOKUPS, bench_now() - t);
+
+  uint64_t linearSum = 0;
+  uint64_t expectedLinear = 0;
+  size_t linearLookups = count > 10000 ? LINEAR_LOOKUPS / 100 : LINEAR_LOOKUPS;
+  t = bench_now();
+  for (size_t i = 0; i < linearLookups; i++) {
+    needle = queries[i];
+    iter_t* iter = array_createIterator(pairs);
+    linearSum += ((const pair_t*)iter_findFirst(iter, isNeedle))->value;
+    iter_destroy(iter);
+  }
+  snprintf(name, sizeof(name), "array_t linear scan x %zu", count);
+  bench_report(name, linearLookups, bench_now() - t);
+  for (size_t i = 0; i < linearLookups; i++)
+    expectedLinear += *(uint64_t*)hashmap_get(map, &queries[i]);
+
+  if (mapSum != chainedSum || linearSum != expectedLinear) {
+    fprintf(stderr, "result mismatch\n");
+    exit(1);
+  }
+
+  array_destroy(pairs);
+  chained_destroy(&chained);
+  hashmap_destroy(map);
+  free(queries);
+}
+
+int main(void) {
+  run(100);
+  run(10000);
+  run(1000000);
+  return 0;
+}
@@ -0,0 +1,84 @@
+// Pushing and popping a million values through the generic heap (binary and 4-ary)
+// and through typed CT_HEAP_DEFINE heaps
+//   cc -O2 bench/heap.c -o heap && ./heap
+#include "bench.h"
+#include <stdint.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_HEAP_IMPL
+#include "../CHeap.h"
+
+#define COUNT (1 << 20)
+
+#define LESS(a, b) ((a) < (b))
+CT_HEAP_DEFINE(heap2, int64_t, LESS, 2)
+CT_HEAP_DEFINE(heap4, int64_t, LESS, 4)
+
+static int64_t value(size_t i) {
+  return (int64_t)((i * 2654435761u) % 1000003);
+}
+
+static int64_t generic(size_t arity) {
+  heap_t* heap = heap_createWithOptions(sizeof(int64_t), array_cmpI64, arity, 0, NULL);
+  for (size_t i = 0; i < COUNT; i++) {
+    int64_t v = value(i);
+    heap_push(heap, &v);
+  }
+  int64_t sum = 0, v;
+  while (heap_pop(heap, &v) >= 0)
+    sum += v;
+  heap_destroy(heap);
+  return sum;
+}
+
+#define TYPED(name) \
+  static int64_t typed_##name(void) { \
+    array_t* arr = array_create(sizeof(int64_t)); \
+    for (size_t i = 0; i < COUNT; i++) \
+      name##_push(arr, value(i)); \
+    int64_t sum = 0, v; \
+    while (name##_pop(arr, &v) >= 0) \
+      sum += v; \
+    array_destroy(arr); \
+    return sum; \
+  }
+TYPED(heap2)
+TYPED(heap4)
+
+int main(void) {
+  double t = bench_now();
+  int64_t expected = generic(2);
+  bench_report("heap_push/heap_pop, arity 2", COUNT, bench_now() - t);
+
+  t = bench_now();
+  int64_t sum = generic(4);
+  bench_report("heap_push/heap_pop, arity 4", COUNT, bench_now() - t);
+  if (sum != expected) goto mismatch;
+
+  t = bench_now();
+  sum = typed_heap2();
+  bench_report("CT_HEAP_DEFINE push/pop, arity 2", COUNT, bench_now() - t);
+  if (sum != expected) goto mismatch;
+
+  t = bench_now();
+  sum = typed_heap4();
+  bench_report("CT_HEAP_DEFINE push/pop, arity 4", COUNT, bench_now() - t);
+  if (sum != expected) goto mismatch;
+
+  array_t* arr = array_createWithCap(sizeof(int64_t), COUNT);
+  for (size_t i = 0; i < COUNT; i++) {
+    int64_t v = value(i);
+    array_push(arr, &v);
+  }
+  t = bench_now();
+  heap_t* heap = heap_heapify(arr, array_cmpI64, 4);
+  bench_report("heap_heapify, arity 4", COUNT, bench_now() - t);
+  heap_destroy(heap);
+  return 0;
+
+mismatch:
+  fprintf(stderr, "result mismatch\n");
+  return 1;
+}
@@ -0,0 +1,46 @@
+// Short-lived iterator pipelines per query: allocated adapters against adapters built in place
+//   cc -O2 bench/iter_inplace.c -o iter_inplace && ./iter_inplace
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+
+#define QUERIES (1 << 20)
+#define SIZE 16
+
+bool isOdd(const void* value) {
+  return *(const int32_t*)value % 2 != 0;
+}
+
+int main(void) {
+  array_t* arr = array_create(sizeof(int32_t));
+  for (int32_t i = 0; i < SIZE; i++)
+    array_push(arr, &i);
+
+  long long found = 0;
+  double t = bench_now();
+  for (size_t q = 0; q < QUERIES; q++) {
+    iter_t* iter = iter_take(iter_filter(array_createIterator(arr), isOdd), 4);
+    found += iter_indexOfFirst(iter, isOdd);
+    iter_destroy(iter);
+  }
+  bench_report("take(filter(array)), allocated", QUERIES, bench_now() - t);
+
+  long long foundInPlace = 0;
+  t = bench_now();
+  for (size_t q = 0; q < QUERIES; q++) {
+    iterStorage_t s1, s2, s3;
+    iter_t* iter = iter_initTake(&s3, iter_initFilter(&s2, array_initIterator(arr, &s1), isOdd), 4);
+    foundInPlace += iter_indexOfFirst(iter, isOdd);
+    iter_destroy(iter);
+  }
+  bench_report("take(filter(array)), in place", QUERIES, bench_now() - t);
+
+  if (found != foundInPlace) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+  array_destroy(arr);
+  return 0;
+}
@@ -0,0 +1,67 @@
+// 3-stage map -> filter -> reduce pipeline, materializing vs lazy adapters
+//   cc -O2 bench/iter_pipeline.c -o iter_pipeline && ./iter_pipeline
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+
+#define COUNT 10000000
+#define ROUNDS 5
+
+void triple(const void* in, void* out) {
+  *(int*)out = *(const int*)in * 3;
+}
+
+bool isEven(const void* in) {
+  return (*(const int*)in & 1) == 0;
+}
+
+void sum(const void* in, void* out) {
+  *(long long*)out += *(const int*)in;
+}
+
+int main(void) {
+  array_t* arr = array_createWithCap(sizeof(int), COUNT);
+  for (int i = 0; i < COUNT; i++)
+    array_push(arr, &i);
+
+  long long materialized = 0;
+  double t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    materialized = 0;
+    iter_t* iter = array_createIterator(arr);
+    array_t* mapped = iter_mapCreate(iter, triple);
+    iter_destroy(iter);
+
+    iter = array_createIterator(mapped);
+    array_t* filtered = iter_findAllCreate(iter, isEven);
+    iter_destroy(iter);
+
+    iter = array_createIterator(filtered);
+    iter_reduce(iter, &materialized, sum);
+    iter_destroy(iter);
+
+    array_destroy(mapped);
+    array_destroy(filtered);
+  }
+  bench_report("materializing map/findAll/reduce", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  long long lazy = 0;
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    lazy = 0;
+    iter_t* iter = iter_filter(iter_lazyMap(array_createIterator(arr), sizeof(int), triple), isEven);
+    iter_reduce(iter, &lazy, sum);
+    iter_destroy(iter);
+  }
+  bench_report("lazy lazyMap/filter/reduce", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  if (lazy != materialized) {
+    fprintf(stderr, "result mismatch: %lld != %lld\n", lazy, materialized);
+    return 1;
+  }
+
+  array_destroy(arr);
+  return 0;
+}
@@ -0,0 +1,93 @@
+// Iterator consumers (map, reduce, collect, zip) over several element sizes and counts
+//   cc -O2 bench/iterator.c -o iterator && ./iterator
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+
+/// Every run touches about this many elements, small arrays are iterated more often
+#define TOTAL_ELEMENTS 20000000
+
+#define ELEMENT_DEFINE(N) \
+  typedef struct { uint32_t key; unsigned char pad[N - sizeof(uint32_t)]; } elem##N##_t; \
+  void map##N(const void* in, void* out) { \
+    *(elem##N##_t*)out = *(const elem##N##_t*)in; \
+    ((elem##N##_t*)out)->key += 1; \
+  } \
+  void reduce##N(const void* in, void* out) { \
+    *(uint64_t*)out += ((const elem##N##_t*)in)->key; \
+  }
+
+ELEMENT_DEFINE(8)
+ELEMENT_DEFINE(32)
+ELEMENT_DEFINE(128)
+
+void run(size_t typeSize, size_t count, void(*map)(const void*, void*), void(*reduce)(const void*, void*)) {
+  size_t rounds = TOTAL_ELEMENTS / count;
+  size_t ops = rounds * count;
+  array_t* arr = array_createWithCap(typeSize, count);
+  unsigned char value[typeSize];
+  memset(value, 0, typeSize);
+  for (size_t i = 0; i < count; i++) {
+    *(uint32_t*)value = (uint32_t)i;
+    array_push(arr, value);
+  }
+  array_t* out = array_createWithCap(typeSize, count);
+  char name[64];
+
+  double t = bench_now();
+  for (size_t r = 0; r < rounds; r++) {
+    iter_t* iter = array_createIterator(arr);
+    iter_map(iter, out, map);
+    iter_destroy(iter);
+    BENCH_KEEP(out->data);
+  }
+  snprintf(name, sizeof(name), "map %zuB x %zu", typeSize, count);
+  bench_report(name, ops, bench_now() - t);
+
+  uint64_t sum = 0;
+  t = bench_now();
+  for (size_t r = 0; r < rounds; r++) {
+    iter_t* iter = array_createIterator(arr);
+    iter_reduce(iter, &sum, reduce);
+    iter_destroy(iter);
+  }
+  BENCH_KEEP(&sum);
+  snprintf(name, sizeof(name), "reduce %zuB x %zu", typeSize, count);
+  bench_report(name, ops, bench_now() - t);
+
+  t = bench_now();
+  for (size_t r = 0; r < rounds; r++) {
+    iter_t* iter = array_createIterator(arr);
+    array_reset(out);
+    iter_collect(iter, out);
+    iter_destroy(iter);
+    BENCH_KEEP(out->data);
+  }
+  snprintf(name, sizeof(name), "collect %zuB x %zu", typeSize, count);
+  bench_report(name, ops, bench_now() - t);
+
+  t = bench_now();
+  for (size_t r = 0; r < rounds; r++) {
+    iter_t* zipped = iter_zipped(array_createIterator(arr), array_createIterator(out));
+    void* pair;
+    while ((pair = iter_next(zipped))) BENCH_KEEP(pair);
+    iter_destroy(zipped);
+  }
+  snprintf(name, sizeof(name), "zip %zuB x %zu", typeSize, count);
+  bench_report(name, ops, bench_now() - t);
+
+  array_destroy(out);
+  array_destroy(arr);
+}
+
+int main(void) {
+  size_t counts[] = { 1000, 1000000 };
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    run(sizeof(elem8_t), counts[c], map8, reduce8);
+    run(sizeof(elem32_t), counts[c], map32, reduce32);
+    run(sizeof(elem128_t), counts[c], map128, reduce128);
+  }
+  return 0;
+}
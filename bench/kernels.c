@@ -0,0 +1,83 @@
+// Numeric kernels against the generic callback based iterator consumers
+//   cc -O2 bench/kernels.c -o kernels && ./kernels
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+
+#define COUNT 10000000
+#define ROUNDS 10
+
+/// Same ordering as `array_cmpI32`, but unknown to the dispatch
+int cmpI32(const void* a, const void* b) {
+  int32_t x = *(const int32_t*)a;
+  int32_t y = *(const int32_t*)b;
+  return (x > y) - (x < y);
+}
+
+void addI32(const void* in, void* out) {
+  *(int32_t*)out = (int32_t)((uint32_t)*(int32_t*)out + (uint32_t)*(const int32_t*)in);
+}
+
+int main(void) {
+  array_t* arr = array_createWithCap(sizeof(int32_t), COUNT);
+  for (int32_t i = 0; i < COUNT; i++) {
+    int32_t v = (int32_t)(((uint32_t)i * 2654435761u) >> 8) - (1 << 23);
+    array_push(arr, &v);
+  }
+
+  const void* generic = NULL;
+  double t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    iter_t* iter = array_createIterator(arr);
+    generic = iter_max(iter, cmpI32);
+    iter_destroy(iter);
+  }
+  bench_report("iter_max generic comparator", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  const void* kernel = NULL;
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    iter_t* iter = array_createIterator(arr);
+    kernel = iter_max(iter, array_cmpI32);
+    iter_destroy(iter);
+  }
+  bench_report("iter_max array_cmpI32", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  int32_t genericSum = 0;
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    genericSum = 0;
+    iter_t* iter = array_createIterator(arr);
+    iter_reduce(iter, &genericSum, addI32);
+    iter_destroy(iter);
+  }
+  bench_report("iter_reduce generic add", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  int32_t kernelSum = 0;
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    kernelSum = 0;
+    iter_t* iter = array_createIterator(arr);
+    iter_reduce(iter, &kernelSum, array_addI32);
+    iter_destroy(iter);
+  }
+  bench_report("iter_reduce array_addI32", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  size_t count = 0;
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    count = array_countWhereGtI32(arr, 0);
+    BENCH_KEEP(&count);
+  }
+  bench_report("array_countWhereGtI32", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  if (generic != kernel || genericSum != kernelSum) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+
+  array_destroy(arr);
+  return 0;
+}
@@ -0,0 +1,71 @@
+// Loading a file of fixed-size records: reading it into a heap array against mapping it
+//   cc -O2 bench/mapped.c -o mapped && ./mapped
+#include "bench.h"
+#include <unistd.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+
+#define COUNT (8 << 20)
+
+typedef struct {
+  int64_t key;
+  int64_t value;
+} record_t;
+
+int64_t sumKeys(const array_t* arr) {
+  const record_t* records = arr->data;
+  int64_t sum = 0;
+  for (size_t i = 0; i < arr->size; i++)
+    sum += records[i].key;
+  return sum;
+}
+
+int main(void) {
+  char path[] = "/tmp/bench_mapped_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) return 1;
+  close(fd);
+
+  double t = bench_now();
+  array_t* arr = array_openMapped(path, sizeof(record_t), ARRAY_MAP_TRUNCATE);
+  if (arr == NULL) return 1;
+  for (int64_t i = 0; i < COUNT; i++) {
+    record_t r = { (int64_t)(((uint64_t)i * 2654435761u) % COUNT), i };
+    array_push(arr, &r);
+  }
+  array_destroy(arr);
+  bench_report("array_openMapped write", COUNT, bench_now() - t);
+
+  t = bench_now();
+  FILE* file = fopen(path, "rb");
+  arr = array_createWithCap(sizeof(record_t), COUNT);
+  arr->size = fread(arr->data, sizeof(record_t), COUNT, file);
+  fclose(file);
+  int64_t readSum = sumKeys(arr);
+  bench_report("fread into array + scan", COUNT, bench_now() - t);
+  array_destroy(arr);
+
+  t = bench_now();
+  arr = array_openMapped(path, sizeof(record_t), ARRAY_MAP_READ_ONLY);
+  array_advise(arr, ARRAY_ADVICE_SEQUENTIAL);
+  int64_t mappedSum = sumKeys(arr);
+  bench_report("array_openMapped + scan", COUNT, bench_now() - t);
+  array_destroy(arr);
+
+  t = bench_now();
+  arr = array_openMapped(path, sizeof(record_t), ARRAY_MAP_READ_ONLY);
+  array_advise(arr, ARRAY_ADVICE_RANDOM);
+  int64_t sampleSum = 0;
+  for (size_t i = 0; i < 4096; i++)
+    sampleSum += ((const record_t*)arr->data)[(i * 2654435761u) % arr->size].value;
+  BENCH_KEEP(&sampleSum);
+  bench_report("array_openMapped + 4096 random reads", 4096, bench_now() - t);
+  array_destroy(arr);
+
+  unlink(path);
+  if (readSum != mappedSum) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+  return 0;
+}
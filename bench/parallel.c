@@ -0,0 +1,63 @@
+// Scaling of iter_parMap / iter_parReduce from 1 to N threads
+//   cc -O2 -pthread bench/parallel.c -lm -o parallel && ./parallel [maxThreads]
+#include <math.h>
+#include <stdlib.h>
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_PARALLEL_IMPL
+#include "../CParallel.h"
+
+#define COUNT 50000000
+
+void transform(const void* in, void* out) {
+  double x = *(const double*)in;
+  *(double*)out = sqrt(x) * sin(x);
+}
+
+void sum(const void* in, void* out) {
+  *(double*)out += *(const double*)in;
+}
+
+int main(int argc, char** argv) {
+  size_t maxThreads = argc > 1 ? (size_t)atoi(argv[1]) : (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+
+  array_t* arr = array_createWithCap(sizeof(double), COUNT);
+  for (size_t i = 0; i < COUNT; i++) {
+    double x = (double)i;
+    array_push(arr, &x);
+  }
+  array_t* out = array_createWithCap(sizeof(double), COUNT);
+  // Fault the pages in up front, so the first run isn't penalized
+  memset(out->data, 0, COUNT * sizeof(double));
+
+  char name[64];
+  for (size_t threads = 1; threads <= maxThreads; threads++) {
+    threadpool_t* pool = threadpool_create(threads);
+
+    iter_t* iter = array_createIterator(arr);
+    double t = bench_now();
+    iter_parMap(pool, iter, out, transform);
+    snprintf(name, sizeof(name), "parMap sqrt*sin %zu threads", threads);
+    bench_report(name, COUNT, bench_now() - t);
+    iter_destroy(iter);
+
+    iter = array_createIterator(out);
+    double total = 0;
+    double identity = 0;
+    t = bench_now();
+    iter_parReduce(pool, iter, &total, &identity, sizeof(double), sum, sum);
+    snprintf(name, sizeof(name), "parReduce sum %zu threads", threads);
+    bench_report(name, COUNT, bench_now() - t);
+    BENCH_KEEP(&total);
+    iter_destroy(iter);
+
+    threadpool_destroy(pool);
+  }
+
+  array_destroy(out);
+  array_destroy(arr);
+  return 0;
+}
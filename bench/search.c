@@ -0,0 +1,67 @@
+// Lookups in a sorted id list: linear scan, branchless binary search and Eytzinger layout
+//   cc -O2 bench/search.c -o search && ./search
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+
+#define COUNT (1 << 22)
+#define QUERIES 2000000
+#define LINEAR_QUERIES 200
+
+static int32_t needle;
+
+bool isNeedle(const void* value) {
+  return *(const int32_t*)value == needle;
+}
+
+int main(void) {
+  array_t* ids = array_createWithCap(sizeof(int32_t), COUNT);
+  for (int32_t i = 0; i < COUNT; i++) {
+    int32_t id = i * 3;
+    array_push(ids, &id);
+  }
+  array_t* eytzinger = array_eytzingerCreate(ids);
+
+  int32_t* queries = malloc(QUERIES * sizeof(int32_t));
+  uint32_t seed = 2463534242u;
+  for (size_t i = 0; i < QUERIES; i++) {
+    seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+    queries[i] = (int32_t)(seed % (COUNT * 3u));
+  }
+
+  size_t linearHits = 0;
+  double t = bench_now();
+  for (size_t i = 0; i < LINEAR_QUERIES; i++) {
+    needle = queries[i];
+    iter_t* iter = array_createIterator(ids);
+    linearHits += iter_indexOfFirst(iter, isNeedle) >= 0;
+    iter_destroy(iter);
+  }
+  bench_report("iter_indexOfFirst", LINEAR_QUERIES, bench_now() - t);
+
+  size_t binaryHits = 0;
+  t = bench_now();
+  for (size_t i = 0; i < QUERIES; i++)
+    binaryHits += array_binarySearch(ids, &queries[i], array_cmpI32) >= 0;
+  bench_report("array_binarySearch", QUERIES, bench_now() - t);
+
+  size_t eytzingerHits = 0;
+  t = bench_now();
+  for (size_t i = 0; i < QUERIES; i++)
+    eytzingerHits += array_eytzingerSearch(eytzinger, &queries[i], array_cmpI32) >= 0;
+  bench_report("array_eytzingerSearch", QUERIES, bench_now() - t);
+
+  size_t expectedLinear = 0;
+  for (size_t i = 0; i < LINEAR_QUERIES; i++) expectedLinear += queries[i] % 3 == 0;
+  if (binaryHits != eytzingerHits || linearHits != expectedLinear) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+
+  free(queries);
+  array_destroy(eytzinger);
+  array_destroy(ids);
+  return 0;
+}
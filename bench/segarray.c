@@ -0,0 +1,93 @@
+// Several threads appending to one shared array: array_t behind a mutex against CSegArray.h
+//   cc -O2 -pthread bench/segarray.c -o segarray && ./segarray
+#include "bench.h"
+#include <pthread.h>
+#include <stdint.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_SEGARRAY_IMPL
+#include "../CSegArray.h"
+
+#define THREADS 4
+#define PER_THREAD (1 << 20)
+#define BATCH 64
+
+typedef struct {
+  array_t* arr;
+  pthread_mutex_t* mutex;
+  segarray_t* sa;
+} shared_t;
+
+void* pushLocked(void* arg) {
+  shared_t* shared = arg;
+  for (int64_t i = 0; i < PER_THREAD; i++) {
+    pthread_mutex_lock(shared->mutex);
+    array_push(shared->arr, &i);
+    pthread_mutex_unlock(shared->mutex);
+  }
+  return NULL;
+}
+
+void* pushSegmented(void* arg) {
+  shared_t* shared = arg;
+  for (int64_t i = 0; i < PER_THREAD; i++)
+    segarray_push(shared->sa, &i);
+  return NULL;
+}
+
+void* pushLockedBatches(void* arg) {
+  shared_t* shared = arg;
+  int64_t batch[BATCH];
+  for (int64_t i = 0; i < PER_THREAD; i += BATCH) {
+    for (int64_t j = 0; j < BATCH; j++)
+      batch[j] = i + j;
+    pthread_mutex_lock(shared->mutex);
+    array_pushMany(shared->arr, batch, BATCH);
+    pthread_mutex_unlock(shared->mutex);
+  }
+  return NULL;
+}
+
+void* pushSegmentedBatches(void* arg) {
+  shared_t* shared = arg;
+  int64_t batch[BATCH];
+  for (int64_t i = 0; i < PER_THREAD; i += BATCH) {
+    for (int64_t j = 0; j < BATCH; j++)
+      batch[j] = i + j;
+    segarray_pushMany(shared->sa, batch, BATCH);
+  }
+  return NULL;
+}
+
+double run(void*(*producer)(void*), shared_t* shared) {
+  pthread_t threads[THREADS];
+  double t = bench_now();
+  for (int i = 0; i < THREADS; i++)
+    pthread_create(&threads[i], NULL, producer, shared);
+  for (int i = 0; i < THREADS; i++)
+    pthread_join(threads[i], NULL);
+  return bench_now() - t;
+}
+
+int main(void) {
+  pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  shared_t shared = { array_create(sizeof(int64_t)), &mutex, segarray_create(sizeof(int64_t)) };
+
+  bench_report("array_push behind a mutex, 4 threads", (size_t)THREADS * PER_THREAD, run(pushLocked, &shared));
+  bench_report("segarray_push, 4 threads", (size_t)THREADS * PER_THREAD, run(pushSegmented, &shared));
+  // Both keep their memory, so the batches don't pay for page faults
+  array_reset(shared.arr);
+  segarray_reset(shared.sa);
+  bench_report("array_pushMany of 64 behind a mutex", (size_t)THREADS * PER_THREAD, run(pushLockedBatches, &shared));
+  bench_report("segarray_pushMany of 64", (size_t)THREADS * PER_THREAD, run(pushSegmentedBatches, &shared));
+
+  if (shared.arr->size != segarray_size(shared.sa)) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+  array_destroy(shared.arr);
+  segarray_destroy(shared.sa);
+  return 0;
+}
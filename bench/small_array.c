@@ -0,0 +1,74 @@
+// Many tiny arrays: heap arrays against CT_SMALL_ARRAY, counting allocations
+//   cc -O2 bench/small_array.c -o small_array && ./small_array
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+
+#define ROUNDS 5000000
+
+static size_t allocations = 0;
+
+void* countingAlloc(size_t size, void* ctx) {
+  (void)ctx;
+  allocations++;
+  return malloc(size);
+}
+
+void* countingRealloc(void* ptr, size_t size, void* ctx) {
+  (void)ctx;
+  if (ptr == NULL) allocations++;
+  return realloc(ptr, size);
+}
+
+void countingFree(void* ptr, void* ctx) {
+  (void)ctx;
+  free(ptr);
+}
+
+static allocator_t counting = {
+  .alloc = countingAlloc,
+  .realloc = countingRealloc,
+  .free = countingFree,
+  .ctx = NULL,
+};
+
+void report(const char* name, double seconds) {
+  char label[96];
+  snprintf(label, sizeof(label), "%s (%.2f allocs/array)", name, (double)allocations / ROUNDS);
+  bench_report(label, ROUNDS, seconds);
+  allocations = 0;
+}
+
+void run(size_t pushes) {
+  char name[64];
+
+  double t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    array_t* arr = array_createWithAllocator(sizeof(int), &counting);
+    for (int i = 0; i < (int)pushes; i++)
+      array_push(arr, &i);
+    BENCH_KEEP(arr->data);
+    array_destroy(arr);
+  }
+  snprintf(name, sizeof(name), "array_create + %zu pushes", pushes);
+  report(name, bench_now() - t);
+
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    CT_SMALL_ARRAY(int, 8) small;
+    array_initInPlace(&small.array, sizeof(int), small.inline_data, 8, &counting);
+    for (int i = 0; i < (int)pushes; i++)
+      array_push(&small.array, &i);
+    BENCH_KEEP(small.array.data);
+    array_destroy(&small.array);
+  }
+  snprintf(name, sizeof(name), "CT_SMALL_ARRAY(int, 8) + %zu pushes", pushes);
+  report(name, bench_now() - t);
+}
+
+int main(void) {
+  run(4);
+  run(8);
+  run(12);
+  return 0;
+}
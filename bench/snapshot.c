@@ -0,0 +1,111 @@
+// Persisting a table of records: raw writes and per-element pushes against snapshots
+//   cc -O2 bench/snapshot.c -o snapshot && ./snapshot
+#include "bench.h"
+#include <stdint.h>
+#include <unistd.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_SNAPSHOT_IMPL
+#include "../CSnapshot.h"
+
+#define COUNT (8 << 20)
+
+typedef struct {
+  int64_t key;
+  int64_t value;
+} record_t;
+
+int64_t sumKeys(const array_t* arr) {
+  const record_t* records = arr->data;
+  int64_t sum = 0;
+  for (size_t i = 0; i < arr->size; i++)
+    sum += records[i].key;
+  return sum;
+}
+
+bool keepAll(const void* value) {
+  (void)value;
+  return true;
+}
+
+int main(void) {
+  char path[] = "/tmp/bench_snapshot_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) return 1;
+
+  array_t* arr = array_createWithCap(sizeof(record_t), COUNT);
+  for (int64_t i = 0; i < COUNT; i++) {
+    record_t r = { (int64_t)(((uint64_t)i * 2654435761u) % COUNT), i };
+    array_push(arr, &r);
+  }
+  int64_t expected = sumKeys(arr);
+
+  double t = bench_now();
+  uint32_t crc = snapshot_crc32c(0, arr->data, COUNT * sizeof(record_t));
+  BENCH_KEEP(&crc);
+  bench_report("crc32c (16 B records)", COUNT, bench_now() - t);
+
+  // Baseline: the data without a header, read back one element at a time
+  t = bench_now();
+  if (write(fd, arr->data, COUNT * sizeof(record_t)) != (ssize_t)(COUNT * sizeof(record_t))) return 1;
+  bench_report("raw write", COUNT, bench_now() - t);
+
+  t = bench_now();
+  lseek(fd, 0, SEEK_SET);
+  FILE* file = fdopen(dup(fd), "rb");
+  array_t* pushed = array_create(sizeof(record_t));
+  record_t r;
+  while (fread(&r, sizeof(record_t), 1, file) == 1)
+    array_push(pushed, &r);
+  fclose(file);
+  int64_t pushedSum = sumKeys(pushed);
+  bench_report("fread + push per element + scan", COUNT, bench_now() - t);
+  array_destroy(pushed);
+
+  if (ftruncate(fd, 0) != 0) return 1;
+  lseek(fd, 0, SEEK_SET);
+  t = bench_now();
+  if (array_save(arr, fd) != 0) return 1;
+  bench_report("array_save", COUNT, bench_now() - t);
+
+  if (ftruncate(fd, 0) != 0) return 1;
+  lseek(fd, 0, SEEK_SET);
+  iter_t* iter = iter_filter(array_createIterator(arr), keepAll);
+  t = bench_now();
+  if (iter_save(iter, fd) != 0) return 1;
+  bench_report("iter_save (filtered, unknown size)", COUNT, bench_now() - t);
+  iter_destroy(iter);
+
+  t = bench_now();
+  lseek(fd, 0, SEEK_SET);
+  array_t* loaded = array_load(fd);
+  int64_t loadedSum = sumKeys(loaded);
+  bench_report("array_load + scan", COUNT, bench_now() - t);
+  array_destroy(loaded);
+
+  t = bench_now();
+  lseek(fd, 0, SEEK_SET);
+  array_t* mapped = array_loadMapped(fd, 0);
+  bench_report("array_loadMapped (open only)", 1, bench_now() - t);
+  t = bench_now();
+  int64_t mappedSum = sumKeys(mapped);
+  bench_report("array_loadMapped scan", COUNT, bench_now() - t);
+  array_destroy(mapped);
+
+  t = bench_now();
+  lseek(fd, 0, SEEK_SET);
+  mapped = array_loadMapped(fd, SNAPSHOT_VERIFY);
+  bench_report("array_loadMapped verified", COUNT, bench_now() - t);
+  array_destroy(mapped);
+
+  close(fd);
+  unlink(path);
+  array_destroy(arr);
+  if (pushedSum != expected || loadedSum != expected || mappedSum != expected) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+  return 0;
+}
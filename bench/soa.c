@@ -0,0 +1,78 @@
+// Scanning one field of 12: array of structs against struct of arrays
+//   cc -O2 bench/soa.c -o soa && ./soa
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_SOA_IMPL
+#include "../CSoA.h"
+
+#define COUNT (2 << 20)
+#define FIELDS 12
+#define ROUNDS 10
+
+typedef struct {
+  int64_t fields[FIELDS];
+} row_t;
+
+void addField3(const void* in, void* out) {
+  *(int64_t*)out += ((const row_t*)in)->fields[3];
+}
+
+int main(void) {
+  array_t* rows = array_createWithCap(sizeof(row_t), COUNT);
+  size_t sizes[FIELDS];
+  for (size_t f = 0; f < FIELDS; f++)
+    sizes[f] = sizeof(int64_t);
+  soa_t* soa = soa_create(sizes, FIELDS);
+  soa_reserveAtLeast(soa, COUNT);
+
+  for (int64_t i = 0; i < COUNT; i++) {
+    row_t row;
+    const void* values[FIELDS];
+    for (size_t f = 0; f < FIELDS; f++) {
+      row.fields[f] = i * (int64_t)(f + 1);
+      values[f] = &row.fields[f];
+    }
+    array_push(rows, &row);
+    soa_push(soa, values);
+  }
+
+  int64_t aos = 0;
+  double t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    aos = 0;
+    iter_t* iter = array_createIterator(rows);
+    iter_reduce(iter, &aos, addField3);
+    iter_destroy(iter);
+  }
+  bench_report("array of structs, iter_reduce one field", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  int64_t soaSum = 0;
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    soaSum = 0;
+    iter_t* iter = soa_fieldIterator(soa, 3);
+    iter_reduce(iter, &soaSum, array_addI64);
+    iter_destroy(iter);
+  }
+  bench_report("soa_fieldIterator, iter_reduce", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    iter_t* iter = soa_fieldIterator(soa, 5);
+    const void* max = iter_min(iter, array_cmpI64);
+    BENCH_KEEP(max);
+    iter_destroy(iter);
+  }
+  bench_report("soa_fieldIterator, iter_min", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  if (aos != soaSum) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+  array_destroy(rows);
+  soa_destroy(soa);
+  return 0;
+}
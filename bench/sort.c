@@ -0,0 +1,91 @@
+// Sorting 10M elements: qsort against the built-in sort engine
+//   cc -O2 bench/sort.c -o sort && ./sort
+#include "bench.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#include <string.h>
+
+#define COUNT 10000000
+
+typedef struct {
+  uint64_t id;
+  int32_t price;
+  uint32_t qty;
+} order_t;
+
+int order_cmp(const void* a, const void* b) {
+  return array_cmpI32(&((const order_t*)a)->price, &((const order_t*)b)->price);
+}
+
+uint32_t order_key(const void* value) {
+  return array_radixKeyI32(((const order_t*)value)->price);
+}
+
+#define ORDER_LESS(a, b) ((a).price < (b).price)
+CT_SORT_DEFINE(order_sort, order_t, ORDER_LESS)
+
+#define INT_LESS(a, b) ((a) < (b))
+CT_SORT_DEFINE(int_sort, int32_t, INT_LESS)
+
+array_t* input;
+array_t* work;
+
+void reset(void) {
+  memcpy(work->data, input->data, input->size * input->type_size);
+  work->size = input->size;
+}
+
+int sorted(const array_t* arr, ArrayCmpFn cmp) {
+  for (size_t i = 1; i < arr->size; i++)
+    if (cmp(arr->data + (i - 1) * arr->type_size, arr->data + i * arr->type_size) > 0) return 0;
+  return 1;
+}
+
+#define RUN(name, cmp, stmt) do { \
+    reset(); \
+    double t = bench_now(); \
+    stmt; \
+    bench_report(name, COUNT, bench_now() - t); \
+    if (!sorted(work, cmp)) { \
+      fprintf(stderr, "%s: not sorted\n", name); \
+      return 1; \
+    } \
+  } while (0)
+
+int main(void) {
+  void* scratch = malloc(COUNT * sizeof(order_t));
+  uint64_t seed = 88172645463325252ull;
+
+  input = array_createWithCap(sizeof(int32_t), COUNT);
+  work = array_createWithCap(sizeof(int32_t), COUNT);
+  for (size_t i = 0; i < COUNT; i++) {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    int32_t v = (int32_t)seed;
+    array_push(input, &v);
+  }
+  RUN("int32 qsort", array_cmpI32, qsort(work->data, COUNT, sizeof(int32_t), array_cmpI32));
+  RUN("int32 array_introsort", array_cmpI32, array_sort(work, array_cmpI32, NULL));
+  RUN("int32 CT_SORT_DEFINE", array_cmpI32, int_sort(work->data, COUNT));
+  RUN("int32 array_mergeSort", array_cmpI32, array_mergeSort(work, array_cmpI32, scratch));
+  RUN("int32 array_radixSortI32", array_cmpI32, array_radixSortI32(work, scratch));
+  array_destroy(input);
+  array_destroy(work);
+
+  input = array_createWithCap(sizeof(order_t), COUNT);
+  work = array_createWithCap(sizeof(order_t), COUNT);
+  for (size_t i = 0; i < COUNT; i++) {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    order_t order = { .id = i, .price = (int32_t)(seed % 1000000), .qty = (uint32_t)(seed >> 40) };
+    array_push(input, &order);
+  }
+  RUN("16-byte record qsort", order_cmp, qsort(work->data, COUNT, sizeof(order_t), order_cmp));
+  RUN("16-byte record array_introsort", order_cmp, array_sort(work, order_cmp, NULL));
+  RUN("16-byte record CT_SORT_DEFINE", order_cmp, order_sort(work->data, COUNT));
+  RUN("16-byte record array_mergeSort", order_cmp, array_mergeSort(work, order_cmp, scratch));
+  RUN("16-byte record array_radixSortBy32", order_cmp, array_radixSortBy32(work, order_key, scratch));
+  array_destroy(input);
+  array_destroy(work);
+
+  free(scratch);
+  return 0;
+}
@@ -0,0 +1,93 @@
+// The 100 greatest of 16M values and the median: full sort against selection
+//   cc -O2 bench/topk.c -o topk && ./topk
+#include "bench.h"
+#include <stdint.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_HEAP_IMPL
+#include "../CHeap.h"
+
+#define COUNT (16 << 20)
+#define K 100
+
+int reversedI64(const void* a, const void* b) {
+  return array_cmpI64(b, a);
+}
+
+bool keepAll(const void* value) {
+  (void)value;
+  return true;
+}
+
+array_t* copyOf(const array_t* arr) {
+  array_t* copy = array_createWithCap(arr->type_size, arr->size);
+  memcpy(copy->data, arr->data, arr->size * arr->type_size);
+  copy->size = arr->size;
+  return copy;
+}
+
+int main(void) {
+  array_t* values = array_createWithCap(sizeof(int64_t), COUNT);
+  uint64_t seed = 88172645463325252ull;
+  for (size_t i = 0; i < COUNT; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    int64_t v = (int64_t)(seed >> 1);
+    array_push(values, &v);
+  }
+
+  array_t* copy = copyOf(values);
+  double t = bench_now();
+  array_sort(copy, reversedI64, NULL);
+  bench_report("array_sort, top 100", COUNT, bench_now() - t);
+  int64_t expected = *(int64_t*)array_get(copy, K - 1);
+  array_destroy(copy);
+
+  copy = copyOf(values);
+  t = bench_now();
+  array_partialSort(copy, K, reversedI64);
+  bench_report("array_partialSort, top 100", COUNT, bench_now() - t);
+  int failed = *(int64_t*)array_get(copy, K - 1) != expected;
+  array_destroy(copy);
+
+  array_t* top = array_createWithCap(sizeof(int64_t), K);
+  iter_t* iter = array_createIterator(values);
+  t = bench_now();
+  iter_topK(iter, K, array_cmpI64, top);
+  bench_report("iter_topK, top 100", COUNT, bench_now() - t);
+  iter_destroy(iter);
+  failed |= *(int64_t*)array_get(top, K - 1) != expected;
+
+  array_reset(top);
+  iter = iter_filter(array_createIterator(values), keepAll);
+  t = bench_now();
+  iter_topK(iter, K, array_cmpI64, top);
+  bench_report("iter_topK (filtered, unknown size), top 100", COUNT, bench_now() - t);
+  iter_destroy(iter);
+  failed |= *(int64_t*)array_get(top, K - 1) != expected;
+  array_destroy(top);
+
+  copy = copyOf(values);
+  t = bench_now();
+  array_sort(copy, array_cmpI64, NULL);
+  bench_report("array_sort, median", COUNT, bench_now() - t);
+  int64_t median = *(int64_t*)array_get(copy, COUNT / 2);
+  array_destroy(copy);
+
+  copy = copyOf(values);
+  t = bench_now();
+  array_nthElement(copy, COUNT / 2, array_cmpI64);
+  bench_report("array_nthElement, median", COUNT, bench_now() - t);
+  failed |= *(int64_t*)array_get(copy, COUNT / 2) != median;
+  array_destroy(copy);
+
+  array_destroy(values);
+  if (failed) {
+    fprintf(stderr, "result mismatch\n");
+    return 1;
+  }
+  return 0;
+}
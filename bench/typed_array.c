@@ -0,0 +1,77 @@
+// Typed (`CT_ARRAY_DEFINE`) vs generic array push/get throughput
+//   cc -O2 bench/typed_array.c -o typed_array && ./typed_array
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#include "bench.h"
+
+#define COUNT 10000000
+#define ROUNDS 5
+
+CT_ARRAY_DEFINE(int, intarr)
+
+int main(void) {
+  double t;
+  long long sum;
+
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    array_t* arr = array_create(sizeof(int));
+    for (int i = 0; i < COUNT; i++)
+      array_push(arr, &i);
+    BENCH_KEEP(arr->data);
+    array_destroy(arr);
+  }
+  bench_report("generic push", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    intarr_t* arr = intarr_create();
+    for (int i = 0; i < COUNT; i++)
+      intarr_push(arr, i);
+    BENCH_KEEP(arr->array.data);
+    intarr_destroy(arr);
+  }
+  bench_report("typed push", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  intarr_t* typed = intarr_createWithCap(COUNT);
+  for (int i = 0; i < COUNT; i++)
+    intarr_push(typed, i);
+  array_t* arr = intarr_array(typed);
+
+  sum = 0;
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (size_t i = 0; i < arr->size; i++)
+      sum += *(int*)array_get(arr, i);
+    BENCH_KEEP(&sum);
+  }
+  bench_report("generic get", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  sum = 0;
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (size_t i = 0; i < intarr_size(typed); i++)
+      sum += intarr_get(typed, i);
+    BENCH_KEEP(&sum);
+  }
+  bench_report("typed get", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int i = 0; i < COUNT; i++)
+      array_set(arr, i, &r);
+    BENCH_KEEP(arr->data);
+  }
+  bench_report("generic set", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  t = bench_now();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int i = 0; i < COUNT; i++)
+      intarr_set(typed, i, r);
+    BENCH_KEEP(arr->data);
+  }
+  bench_report("typed set", (size_t)COUNT * ROUNDS, bench_now() - t);
+
+  intarr_destroy(typed);
+  return 0;
+}
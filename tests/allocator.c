@@ -0,0 +1,74 @@
+#include <assert.h>
+#define CT_ALLOCATOR_IMPL
+#include "../CAllocator.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+
+int main(void) {
+  // Arena
+  arena_t arena;
+  arena_init(&arena, 256);
+
+  allocator_t* a = arena_allocator(&arena);
+  int* x = a->alloc(sizeof(int), a->ctx);
+  *x = 5;
+  // Growing the last allocation happens in place
+  int* y = a->realloc(x, sizeof(int) * 4, a->ctx);
+  assert(x == y);
+  assert(*y == 5);
+  // Larger than a block
+  char* big = a->alloc(1000, a->ctx);
+  memset(big, 1, 1000);
+
+  for (int round = 0; round < 3; round++) {
+    array_t* arrays[16];
+    for (int i = 0; i < 16; i++) {
+      arrays[i] = array_createWithAllocator(sizeof(int), arena_allocator(&arena));
+      for (int j = 0; j < 100; j++)
+        assert(!array_push(arrays[i], &j));
+    }
+    for (int i = 0; i < 16; i++) {
+      assert(arrays[i]->size == 100);
+      for (int j = 0; j < 100; j++)
+        assert(*(int*)array_get(arrays[i], j) == j);
+      array_destroy(arrays[i]);
+    }
+    arena_reset(&arena);
+  }
+
+  arena_destroy(&arena);
+
+  // Pool
+  pool_t pool;
+  pool_init(&pool, 64 * sizeof(int), 4);
+
+  array_t* arr = array_createWithCapAndAllocator(sizeof(int), 64, pool_allocator(&pool));
+  assert(arr != NULL);
+  for (int i = 0; i < 64; i++)
+    assert(!array_push(arr, &i));
+  // The pool cannot hand out blocks larger than `block_size`
+  int val = 64;
+  assert(array_push(arr, &val) == 1);
+  assert(arr->size == 64);
+  assert(*(int*)array_last(arr) == 63);
+
+  array_resetRemovingCapacity(arr);
+  assert(arr->data == NULL);
+  assert(!array_push(arr, &val));
+  assert(*(int*)array_first(arr) == 64);
+  array_destroy(arr);
+
+  void* blocks[8];
+  for (int i = 0; i < 8; i++) {
+    blocks[i] = pool.allocator.alloc(1, pool.allocator.ctx);
+    assert(blocks[i] != NULL);
+    if (i > 0) assert(blocks[i] != blocks[i - 1]);
+  }
+  pool_reset(&pool);
+  void* again = pool.allocator.alloc(1, pool.allocator.ctx);
+  assert(again != NULL);
+
+  pool_destroy(&pool);
+
+  return 0;
+}
@@ -1,6 +1,68 @@
 #define CT_ARRAY_IMPL
 #include "../CArray.h"
 #include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INTVAL(ptr) (*((int*)ptr))
+
+CT_ARRAY_DEFINE(int, intarr)
+CT_ARRAY_GROWTH_INCREMENT(growBy100, 100)
+
+void* mallocAlloc(size_t size, void* ctx) {
+  (void)ctx;
+  return malloc(size);
+}
+
+void* mallocRealloc(void* ptr, size_t size, void* ctx) {
+  (void)ctx;
+  return realloc(ptr, size);
+}
+
+void mallocFree(void* ptr, void* ctx) {
+  (void)ctx;
+  free(ptr);
+}
+
+size_t growExactly(const array_t* arr, size_t needed) {
+  (void)arr;
+  return needed;
+}
+
+typedef struct {
+  int32_t key;
+  uint32_t order;
+} record_t;
+
+#define RECORD_LESS(a, b) ((a).key < (b).key)
+CT_SORT_DEFINE(record_sort, record_t, RECORD_LESS)
+
+int record_cmp(const void* a, const void* b) {
+  return array_cmpI32(&((const record_t*)a)->key, &((const record_t*)b)->key);
+}
+
+uint32_t record_key(const void* value) {
+  return array_radixKeyI32(((const record_t*)value)->key);
+}
+
+array_t* copyOf(const array_t* arr) {
+  array_t* copy = array_createWithCap(arr->type_size, arr->size);
+  memcpy(copy->data, arr->data, arr->size * arr->type_size);
+  copy->size = arr->size;
+  return copy;
+}
+
+/// Sorted by key, ties keep their insertion order
+bool records_stable(const array_t* arr) {
+  const record_t* r = arr->data;
+  for (size_t i = 1; i < arr->size; i++) {
+    if (r[i - 1].key > r[i].key) return false;
+    if (r[i - 1].key == r[i].key && r[i - 1].order > r[i].order) return false;
+  }
+  return true;
+}
 
 int int_cmp(const void* a, const void* b) {
   return (*(int*)a - *(int*)b);
@@ -62,5 +124,469 @@ int main() {
 
   array_destroy(arr);
 
+  // Typed
+  intarr_t* typed = intarr_create();
+  for (int i = 0; i < 25; i++)
+    assert(!intarr_push(typed, i));
+  assert(intarr_size(typed) == 25);
+  assert(intarr_get(typed, 24) == 24);
+  intarr_set(typed, 0, 100);
+  intarr_swap(typed, 0, 1);
+  assert(intarr_get(typed, 1) == 100);
+  assert(intarr_pop(typed, &val) == 24);
+  assert(val == 24);
+
+  // Shares its data with the generic api
+  arr = intarr_array(typed);
+  assert(arr->size == 24);
+  assert(*(int*)array_get(arr, 1) == 100);
+  val = 7;
+  array_push(arr, &val);
+  assert(intarr_get(intarr_from(arr), 24) == 7);
+  assert(intarr_data(typed)[24] == 7);
+
+  intarr_destroy(typed);
+
+  // Numeric kernels, odd sizes leave a scalar tail
+  for (size_t n = 1; n < 40; n += 3) {
+    array_t* i32 = array_create(sizeof(int32_t));
+    array_t* i64 = array_create(sizeof(int64_t));
+    array_t* f64 = array_create(sizeof(double));
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+      int32_t v = (int32_t)((i * 7919) % 101) - 50;
+      int64_t w = (int64_t)v * 3000000000LL;
+      double d = v / 4.0;
+      array_push(i32, &v);
+      array_push(i64, &w);
+      array_push(f64, &d);
+      sum += v;
+    }
+    assert(array_sumI32(i32) == sum);
+    assert(array_sumI64(i64) == sum * 3000000000LL);
+    assert(array_sumF64(f64) == sum / 4.0);
+
+    int32_t min, max;
+    assert(!array_minMaxI32(i32, &min, &max));
+    long minIdx = array_findFirstEqI32(i32, min);
+    long maxIdx = array_findFirstEqI32(i32, max);
+    size_t greater = 0;
+    for (size_t i = 0; i < n; i++) {
+      int32_t v = ((int32_t*)i32->data)[i];
+      assert(min <= v && v <= max);
+      assert(array_cmpI32(&v, &min) >= 0);
+      greater += v > 0;
+    }
+    assert(((int32_t*)i32->data)[minIdx] == min);
+    assert(((int32_t*)i32->data)[maxIdx] == max);
+    assert(array_countWhereGtI32(i32, 0) == greater);
+    assert(array_countWhereGtI64(i64, 0) == greater);
+    assert(array_countWhereGtF64(f64, 0) == greater);
+
+    int64_t min64, max64;
+    double minF, maxF;
+    assert(!array_minMaxI64(i64, &min64, &max64));
+    assert(!array_minMaxF64(f64, &minF, &maxF));
+    assert(min64 == min * 3000000000LL && max64 == max * 3000000000LL);
+    assert(minF == min / 4.0 && maxF == max / 4.0);
+    assert(array_findFirstEqI64(i64, min64) == minIdx);
+    assert(array_findFirstEqF64(f64, maxF) == maxIdx);
+    assert(array_findFirstEqI32(i32, 1000) == -1);
+
+    array_destroy(i32);
+    array_destroy(i64);
+    array_destroy(f64);
+  }
+
+  array_t* f32 = array_create(sizeof(float));
+  float fmin, fmax;
+  assert(array_minMaxF32(f32, &fmin, &fmax) == 1);
+  for (int i = 0; i < 19; i++) {
+    float v = i == 5 ? NAN : (float)(i % 7);
+    array_push(f32, &v);
+  }
+  // NaN after the first element is skipped
+  assert(!array_minMaxF32(f32, &fmin, &fmax));
+  assert(fmin == 0 && fmax == 6);
+  assert(array_findFirstEqF32(f32, NAN) == -1);
+  assert(array_findFirstEqF32(f32, 6) == 6);
+  assert(array_sumF32(f32) != array_sumF32(f32));
+  array_destroy(f32);
+
+  // Sort engine
+  for (size_t n = 1; n < 3000; n = n * 3 + 1) {
+    array_t* records = array_create(sizeof(record_t));
+    array_t* ints = array_create(sizeof(int32_t));
+    array_t* doubles = array_create(sizeof(double));
+    uint32_t seed = 12345;
+    for (uint32_t i = 0; i < n; i++) {
+      seed = seed * 1103515245 + 12345;
+      record_t r = { .key = (int32_t)(seed >> 8) % 50 - 25, .order = i };
+      double d = (double)(int32_t)seed / 7.0;
+      array_push(records, &r);
+      array_push(ints, &r.key);
+      array_push(doubles, &d);
+    }
+
+    array_t* copy = copyOf(records);
+    assert(!array_mergeSort(copy, record_cmp, NULL));
+    assert(records_stable(copy));
+    array_destroy(copy);
+
+    record_t scratch[n + 1];
+    copy = copyOf(records);
+    assert(!array_radixSortBy32(copy, record_key, scratch));
+    assert(records_stable(copy));
+    array_destroy(copy);
+
+    copy = copyOf(records);
+    array_sort(copy, record_cmp, NULL);
+    for (size_t i = 1; i < n; i++)
+      assert(((record_t*)copy->data)[i - 1].key <= ((record_t*)copy->data)[i].key);
+    array_destroy(copy);
+
+    copy = copyOf(records);
+    record_sort(copy->data, copy->size);
+    for (size_t i = 1; i < n; i++)
+      assert(((record_t*)copy->data)[i - 1].key <= ((record_t*)copy->data)[i].key);
+    array_destroy(copy);
+
+    // Selection, checked against a full sort
+    array_t* sorted = copyOf(records);
+    array_sort(sorted, record_cmp, NULL);
+    size_t positions[] = { 0, n / 3, n / 2, n - 1 };
+    for (size_t p = 0; p < 4; p++) {
+      size_t nth = positions[p];
+      copy = copyOf(records);
+      array_nthElement(copy, nth, record_cmp);
+      int32_t key = ((record_t*)copy->data)[nth].key;
+      assert(key == ((record_t*)sorted->data)[nth].key);
+      for (size_t i = 0; i < n; i++)
+        assert(i < nth ? ((record_t*)copy->data)[i].key <= key : ((record_t*)copy->data)[i].key >= key);
+      array_destroy(copy);
+
+      // Both the heap (small k) and the select + sort (large k) paths
+      size_t k = p == 0 ? 10 : nth + 1;
+      copy = copyOf(records);
+      array_partialSort(copy, k, record_cmp);
+      for (size_t i = 0; i < k && i < n; i++)
+        assert(((record_t*)copy->data)[i].key == ((record_t*)sorted->data)[i].key);
+      array_destroy(copy);
+    }
+    array_destroy(sorted);
+
+    copy = copyOf(ints);
+    array_sort(ints, array_cmpI32, qsort);
+    assert(!array_radixSortI32(copy, NULL));
+    assert(memcmp(copy->data, ints->data, n * sizeof(int32_t)) == 0);
+    array_destroy(copy);
+
+    copy = copyOf(doubles);
+    array_sort(doubles, array_cmpF64, qsort);
+    assert(!array_radixSortF64(copy, NULL));
+    assert(memcmp(copy->data, doubles->data, n * sizeof(double)) == 0);
+    array_destroy(copy);
+
+    array_destroy(records);
+    array_destroy(ints);
+    array_destroy(doubles);
+  }
+
+  // Out of range selections are no-ops
+  array_t* few = array_create(sizeof(int32_t));
+  int32_t fewValues[] = { 3, 1, 2 };
+  array_pushMany(few, fewValues, 3);
+  array_nthElement(few, 3, array_cmpI32);
+  array_partialSort(few, 0, array_cmpI32);
+  assert(memcmp(few->data, fewValues, sizeof(fewValues)) == 0);
+  array_partialSort(few, 10, array_cmpI32);
+  assert(INTVAL(array_get(few, 0)) == 1 && INTVAL(array_get(few, 2)) == 3);
+  array_destroy(few);
+
+  // Ranges
+  array_t* range = array_create(sizeof(int));
+  int values[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14 };
+  assert(!array_pushMany(range, values, 15));
+  assert(range->size == 15 && range->cap >= 15);
+  assert(array_removeRange(range, 3, 4) == 11);
+  assert(INTVAL(array_get(range, 2)) == 2 && INTVAL(array_get(range, 3)) == 7);
+  assert(array_removeRange(range, 10, 2) == -1);
+  assert(array_removeRange(range, 11, 0) == 11);
+  assert(!array_insertRange(range, 3, values + 3, 4));
+  for (int i = 0; i < 15; i++)
+    assert(INTVAL(array_get(range, i)) == i);
+  assert(!array_insertRange(range, 15, values, 2));
+  assert(INTVAL(array_last(range)) == 1);
+
+  array_t* other = copyOf(range);
+  assert(!array_appendArray(range, other));
+  assert(range->size == 34);
+  assert(INTVAL(array_get(range, 17)) == 0);
+  array_destroy(other);
+
+  // Values from the array itself stay valid while it grows
+  array_t* self = array_create(sizeof(int));
+  assert(!array_pushMany(self, values, 10));
+  array_shrinkToFit(self);
+  assert(!array_appendArray(self, self));
+  assert(self->size == 20);
+  for (int i = 0; i < 20; i++)
+    assert(INTVAL(array_get(self, i)) == i % 10);
+  array_shrinkToFit(self);
+  // A source range on both sides of the insertion point: 0..5 ++ 3..7 ++ 6..9 ++ 0..9
+  assert(!array_insertRange(self, 6, array_get(self, 3), 5));
+  assert(self->size == 25);
+  int expected[] = { 0, 1, 2, 3, 4, 5, 3, 4, 5, 6, 7, 6, 7, 8, 9 };
+  for (int i = 0; i < 15; i++)
+    assert(INTVAL(array_get(self, i)) == expected[i]);
+  for (int i = 15; i < 25; i++)
+    assert(INTVAL(array_get(self, i)) == i - 15);
+  array_shrinkToFit(self);
+  assert(!array_insertRange(self, 0, array_get(self, 20), 5));
+  assert(INTVAL(array_get(self, 0)) == 5 && INTVAL(array_get(self, 4)) == 9 && INTVAL(array_get(self, 5)) == 0);
+  array_destroy(self);
+
+  assert(array_swapRemove(range, 0, &val) == 33);
+  assert(val == 0 && INTVAL(array_first(range)) == 1);
+  // Removing the last element doesn't move anything
+  assert(array_swapRemove(range, 32, &val) == 32);
+  assert(val == 0 && INTVAL(array_last(range)) == 14);
+  array_destroy(range);
+
+  // Small arrays
+  CT_SMALL_ARRAY(int, 4) small;
+  CT_SMALL_ARRAY_INIT(small);
+  assert(small.array.cap == 4 && small.array.data == small.inline_data);
+  for (int i = 0; i < 4; i++)
+    assert(!array_push(&small.array, &i));
+  assert(small.array.data == small.inline_data);
+  assert(array_popAt(&small.array, 0, &val) == 3 && val == 0);
+  assert(!intarr_push(intarr_from(&small.array), 4));
+  assert(!array_pushMany(&small.array, values + 5, 3));
+  assert(small.array.data != small.inline_data);
+  assert(small.array.size == 7);
+  for (int i = 0; i < 7; i++)
+    assert(INTVAL(array_get(&small.array, i)) == i + 1);
+  array_resetRemovingCapacity(&small.array);
+  assert(small.array.cap == 0 && small.array.data == NULL);
+  array_destroy(&small.array);
+
+  array_t inPlace;
+  array_initInPlace(&inPlace, sizeof(int), NULL, 0, NULL);
+  assert(!array_push(&inPlace, &val));
+  array_destroy(&inPlace);
+
+  // Sorted arrays
+  array_t* sorted = array_create(sizeof(int32_t));
+  for (int32_t v = 0; v < 100; v += 2) {
+    array_push(sorted, &v);
+    if (v % 10 == 0) array_push(sorted, &v);
+  }
+  for (int32_t v = -1; v <= 100; v++) {
+    size_t lower = 0;
+    while (lower < sorted->size && ((int32_t*)sorted->data)[lower] < v) lower++;
+    size_t upper = lower;
+    while (upper < sorted->size && ((int32_t*)sorted->data)[upper] == v) upper++;
+
+    size_t start, end;
+    assert(array_lowerBound(sorted, &v, array_cmpI32) == lower);
+    assert(array_upperBound(sorted, &v, array_cmpI32) == upper);
+    assert(array_equalRange(sorted, &v, array_cmpI32, &start, &end) == upper - lower);
+    assert(start == lower && end == upper);
+    assert(array_binarySearch(sorted, &v, array_cmpI32) == (lower == upper ? -1 : (long)lower));
+  }
+
+  array_t* unique = copyOf(sorted);
+  assert(array_uniqueSorted(unique, array_cmpI32) == 50);
+  for (size_t i = 0; i < unique->size; i++)
+    assert(((int32_t*)unique->data)[i] == (int32_t)i * 2);
+
+  array_t* eytzinger = array_eytzingerCreate(unique);
+  for (int32_t v = -1; v <= 100; v++) {
+    long idx = array_eytzingerLowerBound(eytzinger, &v, array_cmpI32);
+    size_t lower = array_lowerBound(unique, &v, array_cmpI32);
+    if (lower == unique->size) {
+      assert(idx == -1);
+    } else {
+      assert(((int32_t*)eytzinger->data)[idx] == ((int32_t*)unique->data)[lower]);
+    }
+    assert((array_eytzingerSearch(eytzinger, &v, array_cmpI32) >= 0) == (v >= 0 && v < 100 && v % 2 == 0));
+  }
+  array_destroy(eytzinger);
+
+  // With duplicates, walking in sorted order from the lower to the upper bound
+  eytzinger = array_eytzingerCreate(sorted);
+  long first = array_eytzingerLowerBound(eytzinger, &(int32_t){ INT32_MIN }, array_cmpI32);
+  size_t walked = 0;
+  for (long i = first; i >= 0; i = array_eytzingerNext(eytzinger, i))
+    assert(((int32_t*)eytzinger->data)[i] == ((int32_t*)sorted->data)[walked++]);
+  assert(walked == sorted->size);
+  for (int32_t v = -1; v <= 100; v++) {
+    size_t lower = array_lowerBound(sorted, &v, array_cmpI32);
+    size_t upper = array_upperBound(sorted, &v, array_cmpI32);
+    long idx = array_eytzingerUpperBound(eytzinger, &v, array_cmpI32);
+    if (upper == sorted->size) {
+      assert(idx == -1);
+    } else {
+      assert(((int32_t*)eytzinger->data)[idx] == ((int32_t*)sorted->data)[upper]);
+    }
+    long start, end;
+    assert(array_eytzingerEqualRange(eytzinger, &v, array_cmpI32, &start, &end) == upper - lower);
+    assert(start == array_eytzingerLowerBound(eytzinger, &v, array_cmpI32) && end == idx);
+  }
+  array_destroy(eytzinger);
+
+  val = 7;
+  assert(!array_insertSorted(unique, &val, array_cmpI32));
+  assert(((int32_t*)unique->data)[4] == 7);
+
+  int32_t multiples[] = { 0, 3, 6, 6, 9, 12 };
+  array_t* threes = array_create(sizeof(int32_t));
+  for (int i = 0; i < 6; i++) array_push(threes, &multiples[i]);
+
+  array_t* merged = array_mergeSorted(unique, threes, array_cmpI32);
+  assert(merged->size == unique->size + threes->size);
+  for (size_t i = 1; i < merged->size; i++)
+    assert(((int32_t*)merged->data)[i - 1] <= ((int32_t*)merged->data)[i]);
+  array_t* both = array_intersectSorted(unique, threes, array_cmpI32);
+  assert(both->size == 3);
+  assert(((int32_t*)both->data)[0] == 0 && ((int32_t*)both->data)[1] == 6 && ((int32_t*)both->data)[2] == 12);
+  array_t* either = array_unionSorted(unique, threes, array_cmpI32);
+  assert(either->size == unique->size + 3);
+  array_t* onlyThrees = array_differenceSorted(threes, unique, array_cmpI32);
+  assert(onlyThrees->size == 3);
+  assert(((int32_t*)onlyThrees->data)[0] == 3 && ((int32_t*)onlyThrees->data)[1] == 6);
+  array_t* empty = array_create(sizeof(int32_t));
+  array_t* none = array_intersectSorted(empty, threes, array_cmpI32);
+  assert(none->size == 0);
+
+  array_destroy(none);
+  array_destroy(empty);
+  array_destroy(onlyThrees);
+  array_destroy(either);
+  array_destroy(both);
+  array_destroy(merged);
+  array_destroy(threes);
+  array_destroy(unique);
+  array_destroy(sorted);
+
+  int32_t acc = INT32_MAX;
+  int32_t one = 1;
+  array_addI32(&one, &acc);
+  assert(acc == INT32_MIN);
+
+  // Mapped arrays
+  char path[] = "/tmp/carray_mapped_XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+
+  array_t* mapped = array_openMapped(path, sizeof(int), ARRAY_MAP_TRUNCATE);
+  assert(mapped != NULL && mapped->size == 0);
+  for (int i = 0; i < 5000; i++)
+    assert(!array_push(mapped, &i));
+  assert(mapped->size == 5000 && mapped->cap >= 5000);
+  assert(!array_advise(mapped, ARRAY_ADVICE_SEQUENTIAL));
+  array_sort(mapped, array_cmpI32, NULL);
+  assert(array_removeRange(mapped, 4000, 1000) == 4000);
+  assert(!array_sync(mapped));
+  // A synced file holds only the elements, reopening it (as after a crash) sees no spare capacity
+  struct stat st;
+  assert(stat(path, &st) == 0 && st.st_size == 4000 * sizeof(int));
+  array_t* reopened = array_openMapped(path, sizeof(int), ARRAY_MAP_READ_ONLY);
+  assert(reopened != NULL && reopened->size == 4000 && INTVAL(array_get(reopened, 3999)) == 3999);
+  array_destroy(reopened);
+  assert(!array_push(mapped, &val) && mapped->size == 4001);
+  assert(!array_sync(mapped));
+  assert(stat(path, &st) == 0 && st.st_size == 4001 * sizeof(int));
+  array_pop(mapped, NULL);
+  array_destroy(mapped);
+
+  // The file is truncated to the elements
+  assert(stat(path, &st) == 0 && st.st_size == 4000 * sizeof(int));
+
+  mapped = array_openMapped(path, sizeof(int), ARRAY_MAP_READ_ONLY);
+  assert(mapped != NULL && mapped->size == 4000);
+  for (int i = 0; i < 4000; i++)
+    assert(INTVAL(array_get(mapped, i)) == i);
+  assert(array_push(mapped, &val) == 1);
+  assert(mapped->size == 4000);
+  array_destroy(mapped);
+
+  // Files with a partial element are rejected
+  assert(array_openMapped(path, 3 * sizeof(int), 0) == NULL);
+
+  mapped = array_openMapped(path, sizeof(int), 0);
+  assert(mapped->size == 4000);
+  array_resetRemovingCapacity(mapped);
+  assert(mapped->size == 0 && mapped->cap == 0 && mapped->data == NULL);
+  assert(!array_push(mapped, &val));
+  array_destroy(mapped);
+  assert(stat(path, &st) == 0 && st.st_size == sizeof(int));
+
+  unlink(path);
+  assert(array_openMapped(path, sizeof(int), 0) == NULL);
+
+  // Growth policies
+  arr = array_create(sizeof(int));
+  arr->growth = array_growthOneAndHalf;
+  for (int i = 0; i < 11; i++)
+    array_push(arr, &i);
+  assert(arr->cap == 15);
+  arr->growth = growExactly;
+  assert(!array_pushMany(arr, values, 3));
+  assert(arr->cap == 15);
+  assert(!array_pushMany(arr, values, 3));
+  assert(arr->cap == 17);
+  arr->growth = growBy100;
+  array_push(arr, &val);
+  assert(arr->cap == 117);
+  assert(!array_shrinkToFit(arr));
+  assert(arr->cap == 18 && arr->size == 18);
+  assert(INTVAL(array_get(arr, 10)) == 10);
+  array_reset(arr);
+  assert(!array_shrinkToFit(arr));
+  assert(arr->cap == 0 && arr->data == NULL);
+  array_destroy(arr);
+
+  typed = intarr_create();
+  typed->array.growth = growBy100;
+  intarr_push(typed, 1);
+  assert(typed->array.cap == 100);
+  intarr_destroy(typed);
+
+  // Large arrays move into a mapping, which grows in place
+  size_t hugeCount = CARRAY_HUGE_THRESHOLD / sizeof(int) + 1;
+  arr = array_create(sizeof(int));
+  for (size_t i = 0; i < hugeCount; i++) {
+    int v = (int)i;
+    array_push(arr, &v);
+  }
+  assert(arr->opt & ARRAY_HUGE);
+  assert(((uintptr_t)arr->data & (CARRAY_HUGE_PAGE - 1)) == 0);
+  assert(INTVAL(array_get(arr, 12345)) == 12345);
+  assert(INTVAL(array_last(arr)) == (int)hugeCount - 1);
+  assert(array_removeRange(arr, 100, hugeCount - 200) == 200);
+  // Shrunk below the threshold it goes back to the heap
+  assert(!array_shrinkToFit(arr));
+  assert(arr->cap == 200 && !(arr->opt & ARRAY_HUGE) && INTVAL(array_get(arr, 150)) == (int)hugeCount - 50);
+  for (int i = 0; i < 1000; i++)
+    array_push(arr, &i);
+  assert(INTVAL(array_get(arr, 150)) == (int)hugeCount - 50 && INTVAL(array_last(arr)) == 999);
+  array_destroy(arr);
+
+  arr = array_createWithCap(sizeof(int), hugeCount);
+  assert(arr->opt & ARRAY_HUGE);
+  array_resetRemovingCapacity(arr);
+  assert(!(arr->opt & ARRAY_HUGE) && arr->cap == 0);
+  array_push(arr, &val);
+  array_destroy(arr);
+
+  // Only arrays without an allocator are mapped
+  allocator_t mallocAllocator = { .alloc = mallocAlloc, .realloc = mallocRealloc, .free = mallocFree };
+  arr = array_createWithCapAndAllocator(sizeof(int), hugeCount, &mallocAllocator);
+  assert(!(arr->opt & ARRAY_HUGE));
+  array_destroy(arr);
+
   return 0;
 }
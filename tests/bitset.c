@@ -0,0 +1,146 @@
+#include <assert.h>
+#include <stdint.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_BITSET_IMPL
+#include "../CBitset.h"
+
+#define COUNT 1000
+#define INTVAL(ptr) (*((const int32_t*)ptr))
+
+bool isEven(const void* in) {
+  return INTVAL(in) % 2 == 0;
+}
+
+bool divisibleBy3(const void* in) {
+  return INTVAL(in) % 3 == 0;
+}
+
+bool isSmall(const void* in) {
+  return INTVAL(in) < 100;
+}
+
+int main(void) {
+  bitset_t* bs = bitset_create(130);
+  assert(bs->size == 130 && bitset_count(bs) == 0 && bitset_nextSet(bs, 0) == -1);
+  bitset_set(bs, 0);
+  bitset_set(bs, 63);
+  bitset_set(bs, 64);
+  bitset_set(bs, 129);
+  assert(bitset_get(bs, 63) && bitset_get(bs, 64) && !bitset_get(bs, 65));
+  assert(bitset_count(bs) == 4);
+  assert(bitset_nextSet(bs, 0) == 0 && bitset_nextSet(bs, 1) == 63 && bitset_nextSet(bs, 65) == 129);
+  assert(bitset_nextSet(bs, 130) == -1);
+  bitset_unset(bs, 63);
+  assert(bitset_nextSet(bs, 1) == 64);
+
+  bitset_setAll(bs);
+  assert(bitset_count(bs) == 130);
+  // Shrinking clears the bits past the new size, growing adds 0s
+  assert(!bitset_resize(bs, 100));
+  assert(!bitset_resize(bs, 300));
+  assert(bitset_count(bs) == 100 && !bitset_get(bs, 100) && !bitset_get(bs, 299));
+  bitset_unsetAll(bs);
+  assert(bitset_count(bs) == 0);
+  bitset_destroy(bs);
+
+  array_t* arr = array_create(sizeof(int32_t));
+  for (int32_t i = 0; i < COUNT; i++)
+    array_push(arr, &i);
+
+  // Selections from iterators
+  bitset_t* even = bitset_create(0);
+  iter_t* iter = array_createIterator(arr);
+  assert(iter_findAllBits(iter, even, isEven) == even);
+  iter_destroy(iter);
+  assert(even->size == COUNT && bitset_count(even) == COUNT / 2);
+
+  bitset_t* by3 = bitset_create(0);
+  iter = array_createIterator(arr);
+  iter_findAllBits(iter, by3, divisibleBy3);
+  iter_destroy(iter);
+  assert(bitset_count(by3) == (COUNT + 2) / 3);
+
+  // Without a known size or batches
+  bitset_t* small = bitset_create(5);
+  bitset_set(small, 4);
+  iter = iter_stepBy(array_createIterator(arr), 1);
+  iter->opt &= ~ITER_KNOWNSIZE;
+  iter_findAllBits(iter, small, isSmall);
+  iter_destroy(iter);
+  assert(small->size == COUNT && bitset_count(small) == 100 && bitset_nextSet(small, 100) == -1);
+
+  // Combine: even and divisible by 3, but not small
+  bitset_t* sel = bitset_create(COUNT);
+  bitset_or(sel, even);
+  assert(bitset_count(sel) == COUNT / 2);
+  bitset_and(sel, by3);
+  bitset_andNot(sel, small);
+  size_t expected = 0;
+  for (int32_t i = 0; i < COUNT; i++)
+    if (i % 6 == 0 && i >= 100) expected++;
+  assert(bitset_count(sel) == expected);
+
+  // Set bits in order, one by one and in batches
+  iter = bitset_createIterator(sel);
+  size_t found = 0;
+  const size_t* idx;
+  while ((idx = iter_next(iter))) {
+    assert(*idx % 6 == 0 && *idx >= 100);
+    found++;
+  }
+  assert(found == expected);
+  iter_destroy(iter);
+
+  iterStorage_t storage;
+  iter = bitset_initIterator(even, &storage);
+  array_t* indexes = iter_collectCreate(iter);
+  assert(indexes->size == COUNT / 2);
+  for (size_t i = 0; i < indexes->size; i++)
+    assert(*(size_t*)array_get(indexes, i) == i * 2);
+  array_destroy(indexes);
+  iter = bitset_initIterator(even, &storage);
+  void* span;
+  assert(iter_nextBatch(iter, &span, (size_t[8]){ 0 }, 8) == 8 && ((size_t*)span)[7] == 14);
+  iter_destroy(iter);
+
+  // Gather and compress
+  array_t* out = array_create(sizeof(int32_t));
+  int32_t marker = -1;
+  array_push(out, &marker);
+  assert(!array_gather(arr, sel, out));
+  assert(out->size == expected + 1 && INTVAL(array_get(out, 0)) == -1);
+  for (size_t i = 1; i < out->size; i++)
+    assert(INTVAL(array_get(out, i)) % 6 == 0 && INTVAL(array_get(out, i)) > INTVAL(array_get(out, i - 1)));
+
+  // Full words are copied at once
+  bitset_t* all = bitset_create(COUNT);
+  bitset_setAll(all);
+  array_reset(out);
+  array_gather(arr, all, out);
+  assert(out->size == COUNT && INTVAL(array_last(out)) == COUNT - 1);
+
+  array_t* copy = array_create(sizeof(int32_t));
+  array_pushMany(copy, arr->data, COUNT);
+  assert(array_compress(copy, all) == COUNT);
+  bitset_unset(all, 500);
+  assert(array_compress(copy, all) == COUNT - 1 && INTVAL(array_get(copy, 500)) == 501);
+
+  assert(array_compress(arr, sel) == expected);
+  assert(INTVAL(array_get(arr, 0)) == 102 && INTVAL(array_last(arr)) == 996);
+  // Elements without a bit are removed
+  assert(!bitset_resize(small, 10));
+  assert(array_compress(arr, small) == 10 && INTVAL(array_last(arr)) == 156);
+
+  bitset_destroy(all);
+  array_destroy(copy);
+  array_destroy(out);
+  bitset_destroy(sel);
+  bitset_destroy(small);
+  bitset_destroy(by3);
+  bitset_destroy(even);
+  array_destroy(arr);
+  return 0;
+}
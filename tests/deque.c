@@ -0,0 +1,122 @@
+#include <assert.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_DEQUE_IMPL
+#include "../CDeque.h"
+
+#define INTVAL(ptr) (*((int*)ptr))
+
+int main(void) {
+  int val;
+  deque_t* deque = deque_create(sizeof(int));
+  assert(deque_first(deque) == NULL);
+  assert(deque_popFront(deque, &val) == -1);
+
+  // FIFO
+  for (int i = 0; i < 10; i++)
+    assert(!deque_pushBack(deque, &i));
+  for (int i = 0; i < 10; i++) {
+    assert(deque_popFront(deque, &val) == 9 - i);
+    assert(val == i);
+  }
+
+  // Wrap around
+  for (int i = 0; i < 10; i++)
+    deque_pushBack(deque, &i);
+  for (int i = 1; i <= 5; i++) {
+    val = -i;
+    assert(!deque_pushFront(deque, &val));
+  }
+  assert(deque->size == 15);
+  assert(INTVAL(deque_first(deque)) == -5);
+  assert(INTVAL(deque_last(deque)) == 9);
+  for (int i = 0; i < 15; i++)
+    assert(INTVAL(deque_get(deque, i)) == i - 5);
+  assert(deque_getChecked(deque, 15) == NULL);
+
+  void* first; void* second;
+  size_t firstCount, secondCount;
+  assert(deque_spans(deque, &first, &firstCount, &second, &secondCount) == 2);
+  assert(firstCount + secondCount == 15);
+  assert(INTVAL(first) == -5);
+  assert(INTVAL(second) == INTVAL(deque_get(deque, firstCount)));
+
+  // Growing keeps the order when wrapped
+  for (int i = 10; i < 40; i++)
+    deque_pushBack(deque, &i);
+  for (int i = 0; i < 45; i++)
+    assert(INTVAL(deque_get(deque, i)) == i - 5);
+
+  assert(deque_popBack(deque, &val) == 44);
+  assert(val == 39);
+
+  // Iterator
+  iter_t* iter = deque_createIterator(deque);
+  assert(iter->known_size == 44);
+  int expected = -5;
+  void* value;
+  while ((value = iter_next(iter))) {
+    assert(INTVAL(value) == expected);
+    expected++;
+  }
+  assert(expected == 39);
+  iter_destroy(iter);
+
+  // Batches yield the two spans separately
+  iter = deque_createIterator(deque);
+  array_t* collected = iter_collectCreate(iter);
+  assert(collected->size == 44);
+  for (int i = 0; i < 44; i++)
+    assert(INTVAL(array_get(collected, i)) == i - 5);
+  array_destroy(collected);
+  iter_destroy(iter);
+
+  // Zero-copy conversion
+  for (int i = 0; i < 20; i++)
+    deque_popFront(deque, NULL);
+  for (int i = 0; i < 30; i++) {
+    val = 100 + i;
+    deque_pushBack(deque, &val);
+  }
+  size_t size = deque->size;
+  array_t* arr = deque_intoArray(deque);
+  assert(arr->size == size);
+  assert(INTVAL(array_first(arr)) == 15);
+  assert(INTVAL(array_last(arr)) == 129);
+  for (size_t i = 1; i < arr->size; i++)
+    assert(INTVAL(array_get(arr, i)) > INTVAL(array_get(arr, i - 1)));
+
+  deque = deque_fromArray(arr);
+  assert(deque->size == size);
+  assert(deque_popFront(deque, &val) == (long)size - 1);
+  assert(val == 15);
+
+  deque_destroy(deque);
+
+  // Inline array storage is copied to the heap
+  CT_SMALL_ARRAY(int, 4) small;
+  CT_SMALL_ARRAY_INIT(small);
+  for (int i = 0; i < 3; i++)
+    array_push(&small.array, &i);
+  deque = deque_fromArray(&small.array);
+  assert(deque->data != small.inline_data);
+  assert(small.array.size == 0 && small.array.data == NULL);
+  assert(!deque_pushFront(deque, &val));
+  assert(*(int*)deque_last(deque) == 2);
+  deque_destroy(deque);
+  array_destroy(&small.array);
+
+  // Arrays in a huge page mapping are copied
+  arr = array_createWithCap(sizeof(int), CARRAY_HUGE_THRESHOLD / sizeof(int));
+  assert(arr->opt & ARRAY_HUGE);
+  for (int i = 0; i < 100; i++)
+    array_push(arr, &i);
+  deque = deque_fromArray(arr);
+  assert(deque->size == 100 && *(int*)deque_last(deque) == 99);
+  assert(!deque_pushFront(deque, &val));
+  deque_destroy(deque);
+
+  return 0;
+}
@@ -0,0 +1,162 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+// Small buffers, so records are split between reads
+#define CFILEITERATOR_BUFFER_BYTES 64
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_FILEITERATOR_IMPL
+#include "../CFileIterator.h"
+
+#define COUNT 1000
+
+typedef struct {
+  int32_t id;
+  int32_t a;
+  int32_t b;
+} triple_t;
+
+void sumIds(const void* in, void* out) {
+  *(long*)out += ((const triple_t*)in)->id;
+}
+
+void writeTriples(int fd, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    triple_t t = { (int32_t)i, (int32_t)i * 2, -(int32_t)i };
+    assert(write(fd, &t, sizeof(t)) == sizeof(t));
+  }
+}
+
+void writePrefixed(int fd, uint32_t size, unsigned char fill) {
+  unsigned char bytes[256];
+  memset(bytes, fill, size);
+  assert(write(fd, &size, sizeof(size)) == sizeof(size));
+  assert(write(fd, bytes, size) == size);
+}
+
+int main(void) {
+  char path[] = "/tmp/cfileiterator_XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  writeTriples(fd, COUNT);
+  // A partial record at the end is ignored
+  assert(write(fd, "xy", 2) == 2);
+  close(fd);
+
+  int modes[] = { 0, FILEITER_READ_AHEAD };
+  for (int m = 0; m < 2; m++) {
+    iter_t* iter = iter_fromFile(path, sizeof(triple_t), modes[m]);
+    assert(iter != NULL);
+    assert((iter->opt & ITER_KNOWNSIZE) && iter->known_size == COUNT);
+    for (int i = 0; i < COUNT; i++) {
+      const triple_t* t = iter_next(iter);
+      assert(t != NULL && t->id == i && t->a == i * 2 && t->b == -i);
+      assert(*iter->idx == i);
+    }
+    assert(iter_next(iter) == NULL);
+    assert(iter_next(iter) == NULL);
+    iter_destroy(iter);
+
+    iter = iter_fromFile(path, sizeof(triple_t), modes[m]);
+    long sum = 0;
+    iter_reduce(iter, &sum, sumIds);
+    assert(sum == (long)COUNT * (COUNT - 1) / 2);
+    iter_destroy(iter);
+
+    iter = iter_fromFile(path, sizeof(triple_t), modes[m]);
+    array_t* arr = iter_collectCreate(iter);
+    iter_destroy(iter);
+    assert(arr->size == COUNT);
+    for (int i = 0; i < COUNT; i++)
+      assert(((triple_t*)array_get(arr, i))->a == i * 2);
+    array_destroy(arr);
+
+    // Destroying before the end stops the reader
+    iter = iter_take(iter_fromFile(path, sizeof(triple_t), modes[m]), 7);
+    arr = iter_collectCreate(iter);
+    iter_destroy(iter);
+    assert(arr->size == 7);
+    array_destroy(arr);
+  }
+
+  // Values are overwritten by later reads, iter_max and iter_min keep a copy of the extreme
+  char intsPath[] = "/tmp/cfileiterator_ints_XXXXXX";
+  fd = mkstemp(intsPath);
+  assert(fd >= 0);
+  for (int32_t i = 0; i < COUNT; i++) {
+    int32_t v = i == 5 ? -1000000 : i == 7 ? 1000000 : i % 100;
+    assert(write(fd, &v, sizeof(v)) == sizeof(v));
+  }
+  close(fd);
+  for (int m = 0; m < 2; m++) {
+    iter_t* iter = iter_fromFile(intsPath, sizeof(int32_t), modes[m]);
+    assert(iter->opt & ITER_TRANSIENT);
+    // With an ascending comparator iter_max finds the smallest value
+    assert(*(const int32_t*)iter_max(iter, array_cmpI32) == -1000000);
+    iter_destroy(iter);
+    iter = iter_fromFile(intsPath, sizeof(int32_t), modes[m]);
+    assert(*(const int32_t*)iter_min(iter, array_cmpI32) == 1000000);
+    iter_destroy(iter);
+    iter = iter_skip(iter_fromFile(intsPath, sizeof(int32_t), modes[m]), 1);
+    assert(iter->opt & ITER_TRANSIENT);
+    assert(*(const int32_t*)iter_max(iter, array_cmpI32) == -1000000);
+    iter_destroy(iter);
+  }
+  unlink(intsPath);
+
+  // Starts at the offset of the fd
+  fd = open(path, O_RDONLY);
+  assert(lseek(fd, 10 * sizeof(triple_t), SEEK_SET) >= 0);
+  iter_t* iter = iter_fromFd(fd, sizeof(triple_t), 0);
+  assert(iter->known_size == COUNT - 10);
+  assert(((const triple_t*)iter_next(iter))->id == 10);
+  iter_destroy(iter);
+  close(fd);
+
+  // Pipes have no known size
+  int pipefd[2];
+  assert(pipe(pipefd) == 0);
+  writeTriples(pipefd[1], 100);
+  close(pipefd[1]);
+  iter = iter_fromFd(pipefd[0], sizeof(triple_t), FILEITER_READ_AHEAD);
+  assert(!(iter->opt & ITER_KNOWNSIZE));
+  long sum = 0;
+  iter_reduce(iter, &sum, sumIds);
+  assert(sum == 100 * 99 / 2);
+  iter_destroy(iter);
+  close(pipefd[0]);
+
+  // Length-prefixed records
+  fd = open(path, O_WRONLY | O_TRUNC);
+  for (uint32_t i = 0; i < COUNT; i++)
+    writePrefixed(fd, i % 50, (unsigned char)i);
+  writePrefixed(fd, 0, 0);
+  // Larger than a buffer, ends the iteration
+  writePrefixed(fd, 100, 1);
+  writePrefixed(fd, 3, 1);
+  close(fd);
+
+  for (int m = 0; m < 2; m++) {
+    iter = iter_fromFile(path, FILEITER_LENGTH_PREFIXED, modes[m]);
+    assert(iter->type_size == sizeof(fileRecord_t));
+    assert(!(iter->opt & ITER_KNOWNSIZE));
+    for (uint32_t i = 0; i < COUNT; i++) {
+      const fileRecord_t* record = iter_next(iter);
+      assert(record != NULL && record->size == i % 50);
+      for (size_t j = 0; j < record->size; j++)
+        assert(((const unsigned char*)record->data)[j] == (unsigned char)i);
+    }
+    const fileRecord_t* empty = iter_next(iter);
+    assert(empty != NULL && empty->size == 0);
+    assert(iter_next(iter) == NULL);
+    iter_destroy(iter);
+  }
+
+  unlink(path);
+  assert(iter_fromFile(path, sizeof(triple_t), 0) == NULL);
+
+  return 0;
+}
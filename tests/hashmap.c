@@ -0,0 +1,246 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#define CT_ALLOCATOR_IMPL
+#include "../CAllocator.h"
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_HASHMAP_IMPL
+#include "../CHashMap.h"
+
+/// Every key lands in the same slot, so all of them share one probe sequence
+size_t constantHash(const void* key) {
+  (void)key;
+  return 42;
+}
+
+typedef struct {
+  char id[3];
+  double weight;
+} item_t;
+
+typedef struct {
+  uint32_t host;
+  int32_t value;
+} sample_t;
+
+typedef struct {
+  int64_t sum;
+  int32_t count;
+  int32_t max;
+} stat_t;
+
+void sampleHost(const void* sample, void* outKey) {
+  *(uint32_t*)outKey = ((const sample_t*)sample)->host;
+}
+
+void statInit(void* acc) {
+  ((stat_t*)acc)->max = INT32_MIN;
+}
+
+void statAdd(const void* in, void* acc) {
+  const sample_t* sample = in;
+  stat_t* stat = acc;
+  stat->sum += sample->value;
+  stat->count++;
+  if (sample->value > stat->max) stat->max = sample->value;
+}
+
+bool isPositive(const void* in) {
+  return ((const sample_t*)in)->value > 0;
+}
+
+/// Checks the records of `hosts` hosts, where sample `i` belongs to host `i % hosts` and has value `i`
+void checkStats(const array_t* stats, size_t samples, uint32_t hosts, bool positiveOnly) {
+  size_t offset = hashmap_valueOffset(sizeof(uint32_t), sizeof(stat_t));
+  assert(stats->size == hosts && stats->type_size >= offset + sizeof(stat_t));
+  char* seen = calloc(hosts, 1);
+  for (size_t i = 0; i < stats->size; i++) {
+    uint32_t host = *(uint32_t*)array_get(stats, i);
+    const stat_t* stat = (const stat_t*)((char*)array_get(stats, i) + offset);
+    assert(host < hosts && !seen[host]);
+    seen[host] = 1;
+    int64_t sum = 0;
+    int32_t count = 0;
+    for (size_t v = host; v < samples; v += hosts) {
+      if (positiveOnly && v == 0) continue;
+      sum += (int64_t)v;
+      count++;
+    }
+    assert(stat->sum == sum && stat->count == count);
+    assert(stat->max == (int32_t)(host + (samples - 1 - host) / hosts * hosts));
+  }
+  free(seen);
+}
+
+int main(void) {
+  hashmap_t* map = hashmap_create(sizeof(uint64_t), sizeof(int), hashmap_hashU64, hashmap_eqU64);
+  uint64_t key = 1;
+  int val;
+  assert(hashmap_get(map, &key) == NULL);
+  assert(!hashmap_remove(map, &key, NULL));
+
+  for (uint64_t k = 0; k < 1000; k++) {
+    val = (int)k * 2;
+    assert(!hashmap_put(map, &k, &val));
+  }
+  assert(map->size == 1000);
+  for (uint64_t k = 0; k < 1000; k++)
+    assert(*(int*)hashmap_get(map, &k) == (int)k * 2);
+  key = 1000;
+  assert(!hashmap_contains(map, &key));
+
+  // Overwrite
+  key = 7;
+  val = -1;
+  assert(!hashmap_put(map, &key, &val));
+  assert(map->size == 1000);
+  assert(*(int*)hashmap_get(map, &key) == -1);
+
+  // Remove every other key
+  for (uint64_t k = 0; k < 1000; k += 2) {
+    assert(hashmap_remove(map, &k, &val));
+    assert(val == (k == 7 ? -1 : (int)k * 2));
+  }
+  assert(map->size == 500);
+  for (uint64_t k = 0; k < 1000; k++)
+    assert(hashmap_contains(map, &k) == (k % 2 == 1));
+
+  // getOrPut
+  bool inserted;
+  key = 1;
+  int* counter = hashmap_getOrPut(map, &key, &inserted);
+  assert(!inserted && *counter == 2);
+  key = 2;
+  counter = hashmap_getOrPut(map, &key, &inserted);
+  assert(inserted && *counter == 0);
+  *counter += 5;
+  assert(*(int*)hashmap_get(map, &key) == 5);
+
+  // Iterate
+  iter_t* iter = hashmap_createIterator(map);
+  assert(iter->known_size == 501);
+  size_t count = 0;
+  void* entry;
+  while ((entry = iter_next(iter))) {
+    uint64_t k = *(uint64_t*)hashmap_entryKey(map, entry);
+    assert(hashmap_get(map, &k) == hashmap_entryValue(map, entry));
+    count++;
+  }
+  assert(count == 501);
+  iter_destroy(iter);
+
+  // Reserve and reset
+  size_t cap = map->cap;
+  assert(!hashmap_reserve(map, 10000));
+  assert(map->cap > cap);
+  assert(*(int*)hashmap_get(map, &key) == 5);
+  hashmap_reset(map);
+  assert(map->size == 0);
+  assert(!hashmap_contains(map, &key));
+  hashmap_destroy(map);
+
+  // Collisions and backward shift deletion
+  map = hashmap_create(sizeof(uint32_t), sizeof(uint32_t), constantHash, NULL);
+  for (uint32_t k = 0; k < 100; k++)
+    assert(!hashmap_put(map, &k, &k));
+  for (uint32_t k = 0; k < 100; k += 3)
+    assert(hashmap_remove(map, &k, NULL));
+  for (uint32_t k = 0; k < 100; k++) {
+    uint32_t* v = hashmap_get(map, &k);
+    assert((v != NULL) == (k % 3 != 0));
+    if (v != NULL) assert(*v == k);
+  }
+  hashmap_destroy(map);
+
+  // Default hashing of struct keys, with an arena
+  arena_t arena;
+  arena_init(&arena, 1 << 16);
+  map = hashmap_createWithAllocator(sizeof(item_t), sizeof(char), NULL, NULL, arena_allocator(&arena));
+  item_t item;
+  memset(&item, 0, sizeof(item));
+  for (int i = 0; i < 200; i++) {
+    item.id[0] = 'a' + i % 26;
+    item.id[1] = 'a' + i / 26;
+    item.weight = i;
+    char c = item.id[0];
+    assert(!hashmap_put(map, &item, &c));
+  }
+  assert(map->size == 200);
+  item.id[0] = 'c';
+  item.id[1] = 'a';
+  item.weight = 2;
+  assert(*(char*)hashmap_get(map, &item) == 'c');
+  item.weight = 3;
+  assert(hashmap_get(map, &item) == NULL);
+  assert(map->value_offset == sizeof(item_t));
+  hashmap_destroy(map);
+  arena_destroy(&arena);
+
+  // String keys
+  map = hashmap_create(sizeof(char*), sizeof(int), hashmap_hashString, hashmap_eqString);
+  const char* words[] = { "alpha", "beta", "gamma", "beta" };
+  for (int i = 0; i < 4; i++)
+    (*(int*)hashmap_getOrPut(map, &words[i], NULL))++;
+  char lookup[] = "beta";
+  char* lookupPtr = lookup;
+  assert(*(int*)hashmap_get(map, &lookupPtr) == 2);
+  assert(map->size == 3);
+  hashmap_destroy(map);
+
+  // Group by
+  array_t* samples = array_create(sizeof(sample_t));
+  for (int32_t i = 0; i < 20000; i++) {
+    sample_t sample = { (uint32_t)i % 16, i };
+    array_push(samples, &sample);
+  }
+  iter = array_createIterator(samples);
+  array_t* stats = iter_groupReduce(iter, sampleHost, sizeof(uint32_t), sizeof(stat_t), statInit, statAdd);
+  iter_destroy(iter);
+  checkStats(stats, 20000, 16, false);
+  array_destroy(stats);
+
+  // Without a known size
+  iter = iter_filter(array_createIterator(samples), isPositive);
+  stats = iter_groupReduce(iter, sampleHost, sizeof(uint32_t), sizeof(stat_t), statInit, statAdd);
+  iter_destroy(iter);
+  checkStats(stats, 20000, 16, true);
+  array_destroy(stats);
+
+  // More keys than fit in the budget are spilled into partitions, which spill again
+  for (size_t i = 0; i < samples->size; i++)
+    ((sample_t*)array_get(samples, i))->host = (uint32_t)i % 15000;
+  groupReduceOptions_t options = { .hash = hashmap_hashU32, .eq = hashmap_eqU32, .budget = 2048 };
+  iter = array_createIterator(samples);
+  stats = iter_groupReduceWithOptions(iter, sampleHost, sizeof(uint32_t), sizeof(stat_t), statInit, statAdd, &options);
+  iter_destroy(iter);
+  checkStats(stats, 20000, 15000, false);
+  array_destroy(stats);
+  options.budget = 0;
+  iter = iter_filter(array_createIterator(samples), isPositive);
+  stats = iter_groupReduceWithOptions(iter, sampleHost, sizeof(uint32_t), sizeof(stat_t), statInit, statAdd, &options);
+  iter_destroy(iter);
+  checkStats(stats, 20000, 15000, true);
+  array_destroy(stats);
+
+  // Zeroed accumulators without `init`
+  array_reset(samples);
+  iter = array_createIterator(samples);
+  stats = iter_groupReduce(iter, sampleHost, sizeof(uint32_t), sizeof(stat_t), NULL, statAdd);
+  iter_destroy(iter);
+  assert(stats->size == 0);
+  array_destroy(stats);
+  sample_t negative = { 3, -5 };
+  array_push(samples, &negative);
+  iter = array_createIterator(samples);
+  stats = iter_groupReduce(iter, sampleHost, sizeof(uint32_t), sizeof(stat_t), NULL, statAdd);
+  iter_destroy(iter);
+  const stat_t* stat = (const stat_t*)((char*)array_get(stats, 0) + hashmap_valueOffset(sizeof(uint32_t), sizeof(stat_t)));
+  assert(stats->size == 1 && *(uint32_t*)array_get(stats, 0) == 3 && stat->max == 0 && stat->sum == -5);
+  array_destroy(stats);
+  array_destroy(samples);
+
+  return 0;
+}
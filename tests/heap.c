@@ -0,0 +1,201 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_HEAP_IMPL
+#include "../CHeap.h"
+
+#define COUNT 1000
+#define LESS(a, b) ((a) < (b))
+CT_HEAP_DEFINE(intheap, int32_t, LESS, 4)
+
+typedef struct {
+  int32_t priority;
+  int32_t id;
+} task_t;
+
+int task_cmp(const void* a, const void* b) {
+  return array_cmpI32(&((const task_t*)a)->priority, &((const task_t*)b)->priority);
+}
+
+int32_t scrambled(int32_t i) {
+  return (int32_t)(((uint32_t)i * 2654435761u) % 10007);
+}
+
+int reversedI32(const void* a, const void* b) {
+  return array_cmpI32(b, a);
+}
+
+bool isOdd(const void* value) {
+  return *(const int32_t*)value % 2 != 0;
+}
+
+int main(void) {
+  size_t arities[] = { 2, 4, 8 };
+  for (size_t a = 0; a < 3; a++) {
+    heap_t* heap = heap_createWithOptions(sizeof(int32_t), array_cmpI32, arities[a], 0, NULL);
+    assert(heap_peek(heap) == NULL && heap_pop(heap, NULL) == -1);
+    for (int32_t i = 0; i < COUNT; i++) {
+      int32_t v = scrambled(i);
+      assert(!heap_push(heap, &v));
+    }
+    assert(heap_size(heap) == COUNT);
+    int32_t last = INT32_MIN;
+    for (int32_t i = 0; i < COUNT; i++) {
+      int32_t top = *(int32_t*)heap_peek(heap);
+      int32_t v;
+      assert(heap_pop(heap, &v) == COUNT - i - 1);
+      assert(v == top && v >= last);
+      last = v;
+    }
+    heap_destroy(heap);
+  }
+
+  // Heapify an existing array
+  array_t* arr = array_create(sizeof(int32_t));
+  for (int32_t i = 0; i < COUNT; i++) {
+    int32_t v = scrambled(i);
+    array_push(arr, &v);
+  }
+  heap_t* heap = heap_heapify(arr, array_cmpI32, 4);
+  assert(heap->array == arr && heap_size(heap) == COUNT);
+  int32_t last = INT32_MIN;
+  while (heap_size(heap) > 0) {
+    int32_t v;
+    heap_pop(heap, &v);
+    assert(v >= last);
+    last = v;
+  }
+
+  // pushPop keeps the largest values in a min-heap, as used for top-k
+  for (int32_t i = 0; i < 10; i++)
+    heap_push(heap, &i);
+  for (int32_t i = 10; i < 100; i++) {
+    int32_t out;
+    assert(!heap_pushPop(heap, &i, &out));
+    assert(out == i - 10);
+  }
+  int32_t small = -5, out;
+  heap_pushPop(heap, &small, &out);
+  assert(out == -5 && heap_size(heap) == 10 && *(int32_t*)heap_peek(heap) == 90);
+  heap_destroy(heap);
+
+  // Handles
+  heap = heap_createWithOptions(sizeof(task_t), task_cmp, 4, HEAP_HANDLES, NULL);
+  size_t handles[COUNT];
+  for (int32_t i = 0; i < COUNT; i++) {
+    task_t t = { scrambled(i), i };
+    handles[i] = heap_pushHandle(heap, &t);
+    assert(handles[i] == (size_t)i);
+  }
+  for (int32_t i = 0; i < COUNT; i++)
+    assert(((task_t*)heap_getHandle(heap, handles[i]))->id == i);
+
+  // Decrease key
+  task_t urgent = { -1, 500 };
+  heap_update(heap, handles[500], &urgent);
+  assert(((task_t*)heap_peek(heap))->id == 500);
+  // Increase key
+  task_t later = { 20000, 500 };
+  heap_update(heap, handles[500], &later);
+  assert(((task_t*)heap_getHandle(heap, handles[500]))->priority == 20000);
+
+  task_t removed;
+  assert(heap_removeHandle(heap, handles[7], &removed) == COUNT - 1);
+  assert(removed.id == 7);
+  for (int32_t i = 0; i < COUNT; i++)
+    if (i != 7) assert(((task_t*)heap_getHandle(heap, handles[i]))->id == i);
+
+  // Freed handles are reused
+  task_t again = { 3, 7 };
+  assert(heap_pushHandle(heap, &again) == handles[7]);
+
+  int32_t prev = INT32_MIN;
+  for (int32_t i = 0; i < COUNT; i++) {
+    task_t t;
+    heap_pop(heap, &t);
+    assert(t.priority >= prev);
+    prev = t.priority;
+  }
+  assert(prev == 20000 && heap_size(heap) == 0);
+  heap_destroy(heap);
+
+  // Typed heaps
+  arr = array_create(sizeof(int32_t));
+  for (int32_t i = 0; i < COUNT; i++)
+    assert(!intheap_push(arr, scrambled(i)));
+  last = INT32_MIN;
+  for (int32_t i = 0; i < COUNT; i++) {
+    int32_t v;
+    assert(intheap_pop(arr, &v) == COUNT - i - 1);
+    assert(v >= last);
+    last = v;
+  }
+  for (int32_t i = 0; i < COUNT; i++) {
+    int32_t v = scrambled(i);
+    array_push(arr, &v);
+  }
+  intheap_heapify(arr);
+  last = INT32_MIN;
+  while (arr->size > 0) {
+    int32_t v;
+    intheap_pop(arr, &v);
+    assert(v >= last);
+    last = v;
+  }
+  array_destroy(arr);
+
+  // Top k, checked against a full sort
+  array_t* values = array_create(sizeof(int32_t));
+  for (int32_t i = 0; i < 20000; i++) {
+    int32_t v = scrambled(i);
+    array_push(values, &v);
+  }
+  array_t* sorted = array_create(sizeof(int32_t));
+  iter_t* iter = array_createIterator(values);
+  iter_collect(iter, sorted);
+  iter_destroy(iter);
+  array_sort(sorted, reversedI32, NULL);
+
+  size_t ks[] = { 1, 10, 100, 19999, 20000, 30000 };
+  for (size_t i = 0; i < 6; i++) {
+    array_t* top = array_create(sizeof(int32_t));
+    int32_t marker = -1;
+    array_push(top, &marker);
+    iter = array_createIterator(values);
+    assert(!iter_topK(iter, ks[i], array_cmpI32, top));
+    iter_destroy(iter);
+    size_t k = ks[i] < 20000 ? ks[i] : 20000;
+    assert(top->size == k + 1 && *(int32_t*)array_get(top, 0) == -1);
+    assert(memcmp(array_get(top, 1), sorted->data, k * sizeof(int32_t)) == 0);
+    array_destroy(top);
+  }
+
+  // Without a known size, and the smallest values with a reversed comparator
+  array_t* top = array_create(sizeof(int32_t));
+  iter = iter_filter(array_createIterator(values), isOdd);
+  assert(!iter_topK(iter, 50, reversedI32, top));
+  iter_destroy(iter);
+  assert(top->size == 50);
+  for (size_t i = 0; i < top->size; i++) {
+    int32_t v = *(int32_t*)array_get(top, i);
+    assert(v % 2 != 0 && (i == 0 || v >= *(int32_t*)array_get(top, i - 1)));
+  }
+  size_t smaller = 0;
+  for (size_t i = 0; i < values->size; i++) {
+    int32_t v = *(int32_t*)array_get(values, i);
+    if (v % 2 != 0 && v < *(int32_t*)array_last(top)) smaller++;
+  }
+  assert(smaller < 50);
+  iter = array_createIterator(values);
+  assert(!iter_topK(iter, 0, array_cmpI32, top) && top->size == 50);
+  iter_destroy(iter);
+  array_destroy(top);
+  array_destroy(sorted);
+  array_destroy(values);
+
+  return 0;
+}
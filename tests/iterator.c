@@ -1,6 +1,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
+#include <unistd.h>
 #define CT_ARRAY_IMPL
 #include "../CArray.h"
 #define CT_ITERATOR_IMPL
@@ -23,10 +25,20 @@ void* nextUpTo10(void* storage) {
   return storage;
 }
 
+CT_ARRAY_GROWTH_INCREMENT(growByThree, 3)
+
 void summing(const void* in, void* out) {
   *((int*)out) += *((int*)in);
 }
 
+bool isEven(const void* in) {
+  return INTVAL(in) % 2 == 0;
+}
+
+void toLong(const void* in, void* out) {
+  *((long*)out) = INTVAL(in) * 10;
+}
+
 int intCmp(const void* a, const void* b) {
   return *((int*)b) - *((int*)a);
 }
@@ -99,6 +111,38 @@ int main(void) {
   array_destroy(arr);
   iter_destroy(iter);
 
+  // Values are mapped one at a time, growing with the policy of the array
+  idx = 0;
+  iter = malloc(sizeof(iter_t));
+  *iter = (iter_t) {
+    .opt = 0,
+    .data = &idx,
+    .next = nextUpTo10,
+    .type_size = sizeof(int),
+    .free = (IteratorFreeFn)free,
+  };
+  arr = array_createWithCap(sizeof(int), 1);
+  arr->growth = growByThree;
+  assert(iter_map(iter, arr, addOne) && arr->size == 9 && arr->cap == 10);
+  array_destroy(arr);
+  iter_destroy(iter);
+
+  // A known size that overstates what the source yields
+  idx = 0;
+  iter = malloc(sizeof(iter_t));
+  *iter = (iter_t) {
+    .opt = ITER_KNOWNSIZE,
+    .data = &idx,
+    .next = nextUpTo10,
+    .known_size = 20,
+    .type_size = sizeof(int),
+    .free = (IteratorFreeFn)free,
+  };
+  arr = array_create(sizeof(int));
+  assert(iter_map(iter, arr, addOne) && arr->size == 9);
+  array_destroy(arr);
+  iter_destroy(iter);
+
   // reduce
   arr = array_create(sizeof(int));
   for (int i = 0; i < 10; i++)
@@ -130,10 +174,200 @@ int main(void) {
     assert(INTVAL(zippedValue->left) == INTVAL(zippedValue->right));
   }
 
+  // Also destroys `iter` and `iter2`
+  iter_destroy(zipped);
+
+  // Lazy map + filter
+  iter = iter_filter(iter_lazyMap(array_createIterator(arr), sizeof(int), addOne), isEven);
+  assert(!(iter->opt & ITER_KNOWNSIZE));
+  for (int i = 2; i <= 10; i += 2)
+    assert(INTVAL(iter_next(iter)) == i);
+  assert(iter_next(iter) == NULL);
+  iter_destroy(iter);
+
+  // The mapped value is rewritten by every call, the extreme is a copy
+  iter = iter_filter(iter_lazyMap(array_createIterator(arr), sizeof(int), addOne), isEven);
+  assert(iter->opt & ITER_TRANSIENT);
+  assert(INTVAL(iter_min(iter, intCmp)) == 2);
+  iter_destroy(iter);
+
+  iter = iter_lazyMap(array_createIterator(arr), sizeof(long), toLong);
+  assert(iter->type_size == sizeof(long));
+  assert((iter->opt & ITER_KNOWNSIZE) && iter->known_size == 10);
+  array_t* longs = iter_collectCreate(iter);
+  assert(longs->size == 10);
+  assert(*((long*)array_get(longs, 9)) == 90);
+  array_destroy(longs);
+  iter_destroy(iter);
+
+  // Take, skip
+  iter = iter_skip(iter_take(array_createIterator(arr), 7), 2);
+  assert((iter->opt & ITER_KNOWNSIZE) && iter->known_size == 5);
+  assert((iter->opt & ITER_CONTIGUOUS) && INTVAL(iter->contiguous_buffer) == 2);
+  for (int i = 2; i < 7; i++)
+    assert(INTVAL(iter_next(iter)) == i);
+  assert(iter_next(iter) == NULL);
+  iter_destroy(iter);
+
+  iter = iter_skip(array_createIterator(arr), 20);
+  assert(iter->known_size == 0);
+  assert(iter_next(iter) == NULL);
   iter_destroy(iter);
-  iter_destroy(iter2);
 
+  // Step by
+  iter = iter_stepBy(array_createIterator(arr), 3);
+  assert(iter->known_size == 4);
+  for (int i = 0; i < 10; i += 3)
+    assert(INTVAL(iter_next(iter)) == i);
+  assert(iter_next(iter) == NULL);
+  iter_destroy(iter);
+
+  // Chain
+  iter = iter_chain(array_createIterator(arr), iter_take(array_createIterator(arr), 3));
+  assert(iter->known_size == 13);
+  array_t* chained = iter_collectCreate(iter);
+  assert(chained->size == 13);
+  assert(INTVAL(array_get(chained, 9)) == 9);
+  assert(INTVAL(array_get(chained, 12)) == 2);
+  array_destroy(chained);
+  iter_destroy(iter);
+
+  // Batches
+  iter = array_createIterator(arr);
+  void* span;
+  int batchBuf[4];
+  assert(iter_nextBatch(iter, &span, batchBuf, 4) == 4);
+  assert(span == arr->data);
+  assert(INTVAL(iter_next(iter)) == 4);
+  assert(iter_nextBatch(iter, &span, batchBuf, 100) == 5);
+  assert(INTVAL(span) == 5);
+  assert(iter_nextBatch(iter, &span, batchBuf, 100) == 0);
+  iter_destroy(iter);
+
+  idx = 0;
+  intIter = (iter_t) {
+    .opt = 0,
+    .data = &idx,
+    .next = nextUpTo10,
+    .type_size = sizeof(int),
+    .free = NULL
+  };
+  assert(iter_nextBatch(&intIter, &span, batchBuf, 4) == 4);
+  assert(span == batchBuf);
+  assert(batchBuf[0] == 1 && batchBuf[3] == 4);
+
+  // Batched consumers
+  iter = iter_filter(iter_lazyMap(array_createIterator(arr), sizeof(int), addOne), isEven);
+  int sum = 0;
+  assert(iter_reduce(iter, &sum, summing) == &sum);
+  assert(sum == 2 + 4 + 6 + 8 + 10);
+  iter_destroy(iter);
+
+  iter = iter_skip(array_createIterator(arr), 3);
+  array_t* mapped = iter_mapCreate(iter, addOne);
+  assert(mapped->size == 7);
+  assert(INTVAL(array_first(mapped)) == 4);
+  assert(INTVAL(array_last(mapped)) == 10);
+  array_destroy(mapped);
+  iter_destroy(iter);
+
+  iter = iter_chain(array_createIterator(arr), iter_filter(array_createIterator(arr), isEven));
+  array_t* found = iter_findAllCreate(iter, isEven);
+  assert(found->size == 10);
+  array_destroy(found);
+  iter_destroy(iter);
+
+  iter = array_createIterator(arr);
+  assert(INTVAL(iter_min(iter, intCmp)) == 0);
+  iter_destroy(iter);
+
+  array_destroy(arr);
+
+  // Extend
+  arr = array_create(sizeof(int));
+  for (int i = 0; i < 5; i++)
+    array_push(arr, &i);
+  array_t* extended = array_create(sizeof(int));
+  iter = array_createIterator(arr);
+  assert(!array_extendFromIterator(extended, iter));
+  iter_destroy(iter);
+  assert(extended->size == 5 && extended->cap == 5);
+  iter = iter_filter(array_createIterator(arr), isEven);
+  assert(!array_extendFromIterator(extended, iter));
+  iter_destroy(iter);
+  iter_t* counting = &(iter_t) {
+    .opt = 0,
+    .data = &(int) { 0 },
+    .next = nextUpTo10,
+    .type_size = sizeof(int),
+    .free = NULL
+  };
+  assert(!array_extendFromIterator(extended, counting));
+  assert(extended->size == 5 + 3 + 9);
+  assert(INTVAL(array_get(extended, 7)) == 4);
+  assert(INTVAL(array_last(extended)) == 9);
+  array_destroy(extended);
+  array_destroy(arr);
+
+  // Numeric kernels
+  arr = array_create(sizeof(int32_t));
+  for (int32_t v = 0; v < 37; v++) {
+    int32_t x = (v * 13) % 37 - 18;
+    array_push(arr, &x);
+  }
+  int32_t dup = -18;
+  array_push(arr, &dup);
+
+  iter = array_createIterator(arr);
+  // iter_max with an ascending comparator finds the first smallest element
+  const int32_t* extreme = iter_max(iter, array_cmpI32);
+  assert(*extreme == -18);
+  assert(extreme == array_get(arr, 0));
+  assert(iter_next(iter) == NULL);
+  iter_destroy(iter);
+
+  iter = array_createIterator(arr);
+  assert(*(const int32_t*)iter_min(iter, array_cmpI32) == 18);
+  iter_destroy(iter);
+
+  iter = array_createIterator(arr);
+  int32_t total = 5;
+  iter_reduce(iter, &total, array_addI32);
+  assert(total == 5 - 18);
+  assert(iter_next(iter) == NULL);
+  iter_destroy(iter);
+
+  // Advanced iterators use the generic path
+  iter = array_createIterator(arr);
+  iter_next(iter);
+  assert(*(const int32_t*)iter_max(iter, array_cmpI32) == -18);
+  assert(iter_max(iter, array_cmpI32) == NULL);
+  iter_destroy(iter);
+
+  iter = iter_take(array_createIterator(arr), 5);
+  total = 0;
+  iter_reduce(iter, &total, array_addI32);
+  assert(total == -18 - 5 + 8 - 16 - 3);
+  assert(iter_next(iter) == NULL);
+  iter_destroy(iter);
+
+  array_destroy(arr);
+
+  // Mapped arrays are contiguous like heap arrays
+  char path[] = "/tmp/citerator_mapped_XXXXXX";
+  close(mkstemp(path));
+  arr = array_openMapped(path, sizeof(int32_t), 0);
+  for (int32_t i = 0; i < 1000; i++)
+    array_push(arr, &i);
+  iter = array_createIterator(arr);
+  assert(iter->opt & ITER_CONTIGUOUS);
+  array_t* collected = iter_collectCreate(iter);
+  iter_destroy(iter);
+  assert(collected->size == 1000);
+  assert(memcmp(collected->data, arr->data, 1000 * sizeof(int32_t)) == 0);
+  array_destroy(collected);
   array_destroy(arr);
+  unlink(path);
 
   return 0;
 }
@@ -0,0 +1,142 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+
+// Counts the allocations made by CIterator.h, arrays allocate through CArray.h
+size_t mallocs = 0;
+
+void* countingMalloc(size_t size) {
+  mallocs++;
+  return malloc(size);
+}
+
+#define malloc(size) countingMalloc(size)
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#undef malloc
+
+#define COUNT 100
+#define INTVAL(ptr) (*((const int*)ptr))
+
+bool isEven(const void* in) {
+  return INTVAL(in) % 2 == 0;
+}
+
+bool isNegative(const void* in) {
+  return INTVAL(in) < 0;
+}
+
+void addOne(const void* in, void* out) {
+  *((int*)out) = INTVAL(in) + 1;
+}
+
+void summing(const void* in, void* out) {
+  *((int*)out) += INTVAL(in);
+}
+
+int intCmp(const void* a, const void* b) {
+  return INTVAL(a) - INTVAL(b);
+}
+
+int main(void) {
+  array_t* arr = array_create(sizeof(int));
+  for (int i = 0; i < COUNT; i++)
+    array_push(arr, &i);
+  array_t* out = array_createWithCap(sizeof(size_t), COUNT * 2);
+
+  iterStorage_t s1, s2, s3, s4;
+  int mapped;
+
+  // Sources and adapters
+  iter_t* iter = array_initIterator(arr, &s1);
+  assert(iter == &s1.iter && (iter->opt & ITER_IN_PLACE));
+  assert((iter->opt & ITER_KNOWNSIZE) && iter->known_size == COUNT);
+  int sum = 0;
+  iter_reduce(iter, &sum, summing);
+  assert(sum == COUNT * (COUNT - 1) / 2);
+  iter_destroy(iter);
+
+  iter = iter_initFilter(&s3, iter_initLazyMap(&s2, array_initIterator(arr, &s1), sizeof(int), addOne, &mapped), isEven);
+  for (int i = 2; i <= COUNT; i += 2)
+    assert(INTVAL(iter_next(iter)) == i);
+  assert(iter_next(iter) == NULL);
+  iter_destroy(iter);
+
+  iter = iter_initStepBy(&s4, iter_initTake(&s3, iter_initSkip(&s2, array_initIterator(arr, &s1), 10), 20), 5);
+  assert(iter->known_size == 4);
+  for (int i = 10; i < 30; i += 5)
+    assert(INTVAL(iter_next(iter)) == i);
+  assert(iter_next(iter) == NULL);
+  iter_destroy(iter);
+
+  iter = iter_initChain(&s3, array_initIterator(arr, &s1), array_initIterator(arr, &s2));
+  assert(iter->known_size == COUNT * 2);
+  array_reset(out);
+  out->type_size = sizeof(int);
+  iter_collect(iter, out);
+  assert(out->size == COUNT * 2 && INTVAL(array_get(out, COUNT)) == 0);
+  out->type_size = sizeof(size_t);
+  iter_destroy(iter);
+
+  iter = iter_initZipped(&s3, array_initIterator(arr, &s1), iter_initSkip(&s4, array_initIterator(arr, &s2), 1));
+  zippedValue_t* pair = iter_next(iter);
+  assert(INTVAL(pair->left) == 0 && INTVAL(pair->right) == 1);
+  iter_destroy(iter);
+
+  // Enumerating an enumerated iterator returns it
+  iter = array_initIterator(arr, &s1);
+  assert(iter_initEnumerated(&s2, iter) == iter);
+  iter = iter_initEnumerated(&s3, iter_initFilter(&s2, iter, isEven));
+  assert(iter->opt & ITER_ENUMERATED);
+  iter_next(iter);
+  assert(INTVAL(iter_next(iter)) == 2 && *iter->idx == 1);
+  iter_destroy(iter);
+
+  // Consumers that need indexes enumerate on the stack
+  array_reset(out);
+  iter = iter_initFilter(&s2, array_initIterator(arr, &s1), isEven);
+  iter_findAllIndexes(iter, out, isEven);
+  assert(out->size == COUNT / 2 && *(size_t*)array_get(out, 3) == 3);
+  iter_destroy(iter);
+
+  iter = iter_initFilter(&s2, array_initIterator(arr, &s1), isEven);
+  assert(iter_indexOfFirst(iter, isNegative) == -1);
+  iter_destroy(iter);
+
+  // Indexes count the values of `iter`, not of the array
+  iter = iter_initSkip(&s2, array_initIterator(arr, &s1), 11);
+  assert(iter_indexOfFirst(iter, isEven) == 1);
+  iter_destroy(iter);
+
+  iter = iter_initFilter(&s2, array_initIterator(arr, &s1), isEven);
+  assert(INTVAL(iter_min(iter, intCmp)) == COUNT - 2);
+  iter_destroy(iter);
+
+  iter = array_initIterator(arr, &s1);
+  assert(INTVAL(iter_max(iter, array_cmpI32)) == 0);
+  iter = array_initIterator(arr, &s1);
+  assert(!iter_allSatisfy(iter, isEven));
+  iter = array_initIterator(arr, &s1);
+  assert(iter_findFirst(iter, isNegative) == NULL);
+
+  assert(mallocs == 0);
+
+  // The allocating versions share the implementation
+  iter = iter_filter(iter_lazyMap(array_createIterator(arr), sizeof(int), addOne), isEven);
+  assert(mallocs == 3 && !(iter->opt & ITER_IN_PLACE));
+  assert(INTVAL(iter_next(iter)) == 2);
+  iter_destroy(iter);
+
+  // An adapter in place can own an allocated iterator
+  iter = iter_initTake(&s1, iter_enumerated(iter_filter(array_createIterator(arr), isEven)), 3);
+  assert(mallocs == 6);
+  iter_next(iter);
+  assert(INTVAL(iter_next(iter)) == 2 && *iter->idx == 1);
+  iter_destroy(iter);
+
+  array_destroy(out);
+  array_destroy(arr);
+  return 0;
+}
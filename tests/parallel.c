@@ -0,0 +1,109 @@
+#include <assert.h>
+// Small enough that the per-chunk arrays of iter_parFindAll become anonymous mappings
+#define CARRAY_HUGE_THRESHOLD 4096
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_PARALLEL_IMPL
+#include "../CParallel.h"
+
+#define INTVAL(ptr) (*((int*)ptr))
+#define COUNT 100003
+
+void square(const void* in, void* out) {
+  *((long*)out) = (long)INTVAL(in) * INTVAL(in);
+}
+
+void sum(const void* in, void* out) {
+  *((long*)out) += INTVAL(in);
+}
+
+void combineSum(const void* in, void* out) {
+  *((long*)out) += *((long*)in);
+}
+
+bool divisibleBy7(const void* in) {
+  return INTVAL(in) % 7 == 0;
+}
+
+bool positive(const void* in) {
+  return INTVAL(in) >= 0;
+}
+
+bool lessThan90000(const void* in) {
+  return INTVAL(in) < 90000;
+}
+
+int main(void) {
+  threadpool_t* pool = threadpool_create(4);
+  assert(pool->thread_count == 4);
+
+  array_t* arr = array_create(sizeof(int));
+  for (int i = 0; i < COUNT; i++)
+    array_push(arr, &i);
+
+  // Map
+  iter_t* iter = array_createIterator(arr);
+  array_t* squares = array_create(sizeof(long));
+  assert(iter_parMap(pool, iter, squares, square) == squares);
+  assert(squares->size == COUNT);
+  for (long i = 0; i < COUNT; i++)
+    assert(*((long*)array_get(squares, i)) == i * i);
+  // Exhausted like after the sequential version
+  assert(iter_next(iter) == NULL);
+  array_destroy(squares);
+  iter_destroy(iter);
+
+  // Reduce
+  iter = array_createIterator(arr);
+  long total = 0;
+  long identity = 0;
+  iter_parReduce(pool, iter, &total, &identity, sizeof(long), sum, combineSum);
+  assert(total == (long)COUNT * (COUNT - 1) / 2);
+  assert(iter_next(iter) == NULL);
+  iter_destroy(iter);
+
+  // Find all
+  iter = array_createIterator(arr);
+  array_t* found = array_create(sizeof(int));
+  iter_parFindAll(pool, iter, found, divisibleBy7);
+  assert(found->size == (COUNT + 6) / 7);
+  for (size_t i = 0; i < found->size; i++)
+    assert(INTVAL(array_get(found, i)) == (int)i * 7);
+  assert(iter_next(iter) == NULL);
+  array_destroy(found);
+  iter_destroy(iter);
+
+  // All satisfy
+  iter = array_createIterator(arr);
+  assert(iter_parAllSatisfy(pool, iter, positive));
+  iter_destroy(iter);
+  iter = array_createIterator(arr);
+  assert(!iter_parAllSatisfy(pool, iter, lessThan90000));
+  assert(iter_next(iter) == NULL);
+  iter_destroy(iter);
+
+  // Non-contiguous iterators run sequentially
+  iter = iter_take(iter_filter(array_createIterator(arr), divisibleBy7), 10);
+  total = 0;
+  iter_parReduce(pool, iter, &total, &identity, sizeof(long), sum, combineSum);
+  assert(total == 7 * 45);
+  iter_destroy(iter);
+
+  // Small inputs
+  array_t* small = array_create(sizeof(int));
+  for (int i = 0; i < 3; i++)
+    array_push(small, &i);
+  iter = array_createIterator(small);
+  total = 0;
+  iter_parReduce(pool, iter, &total, &identity, sizeof(long), sum, combineSum);
+  assert(total == 3);
+  iter_destroy(iter);
+  array_destroy(small);
+
+  array_destroy(arr);
+  threadpool_destroy(pool);
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_SEGARRAY_IMPL
+#include "../CSegArray.h"
+
+#define COUNT 10000
+#define THREADS 4
+#define PER_THREAD 20000
+
+typedef struct {
+  int32_t thread;
+  int32_t seq;
+} entry_t;
+
+typedef struct {
+  segarray_t* sa;
+  int32_t thread;
+} producer_t;
+
+void* produce(void* arg) {
+  producer_t* p = arg;
+  for (int32_t i = 0; i < PER_THREAD; i += 2) {
+    // Mix single and batched pushes
+    if (i % 4 == 0) {
+      entry_t e = { p->thread, i };
+      assert(segarray_push(p->sa, &e) >= 0);
+      e.seq = i + 1;
+      assert(segarray_push(p->sa, &e) >= 0);
+    } else {
+      entry_t es[2] = { { p->thread, i }, { p->thread, i + 1 } };
+      assert(segarray_pushMany(p->sa, es, 2) >= 0);
+    }
+  }
+  return NULL;
+}
+
+void* scan(void* arg) {
+  segarray_t* sa = arg;
+  size_t seen = 0;
+  while (seen < THREADS * PER_THREAD) {
+    size_t size = segarray_size(sa);
+    assert(size >= seen);
+    // Every published value is complete
+    for (size_t i = seen; i < size; i++) {
+      const entry_t* e = segarray_get(sa, i);
+      assert(e->thread >= 0 && e->thread < THREADS && e->seq >= 0 && e->seq < PER_THREAD);
+    }
+    seen = size;
+  }
+  return NULL;
+}
+
+void* failingAlloc(size_t size, void* ctx) {
+  (void)size; (void)ctx;
+  return NULL;
+}
+
+int main(void) {
+  segarray_t* sa = segarray_create(sizeof(int32_t));
+  assert(segarray_size(sa) == 0 && segarray_getChecked(sa, 0) == NULL);
+  int32_t zero = 0;
+  assert(segarray_push(sa, &zero) == 0);
+  int32_t* first = segarray_get(sa, 0);
+  for (int32_t i = 1; i < COUNT; i++)
+    assert(segarray_push(sa, &i) == i);
+  assert(segarray_size(sa) == COUNT);
+  // Values never move
+  assert(segarray_get(sa, 0) == first && *first == 0);
+  for (int32_t i = 0; i < COUNT; i++)
+    assert(*(int32_t*)segarray_get(sa, i) == i);
+  assert(segarray_getChecked(sa, COUNT) == NULL);
+
+  // Segment boundaries: 16, 32, 64...
+  assert((int32_t*)segarray_get(sa, 15) == (int32_t*)atomic_load(&sa->segments[0]) + 15);
+  assert((int32_t*)segarray_get(sa, 16) == (int32_t*)atomic_load(&sa->segments[1]));
+  assert((int32_t*)segarray_get(sa, 47) == (int32_t*)atomic_load(&sa->segments[1]) + 31);
+  assert((int32_t*)segarray_get(sa, 48) == (int32_t*)atomic_load(&sa->segments[2]));
+
+  // A batch across several segments
+  int32_t many[100];
+  for (int32_t i = 0; i < 100; i++)
+    many[i] = COUNT + i;
+  assert(segarray_pushMany(sa, many, 100) == COUNT);
+  for (int32_t i = 0; i < COUNT + 100; i++)
+    assert(*(int32_t*)segarray_get(sa, i) == i);
+
+  // One span per segment
+  iter_t* iter = segarray_createIterator(sa);
+  assert((iter->opt & ITER_KNOWNSIZE) && iter->known_size == COUNT + 100);
+  void* span;
+  size_t count, spans = 0, total = 0;
+  while ((count = iter_nextBatch(iter, &span, NULL, (size_t)-1))) {
+    assert(*(int32_t*)span == (int32_t)total);
+    assert(count == (spans == 0 ? 16 : (COUNT + 100 - total < ((size_t)16 << spans) ? COUNT + 100 - total : ((size_t)16 << spans))));
+    spans++;
+    total += count;
+  }
+  assert(total == COUNT + 100 && spans == 10);
+  iter_destroy(iter);
+
+  iterStorage_t storage;
+  iter = segarray_initIterator(sa, &storage);
+  int64_t sum = 0;
+  iter_reduce(iter, &sum, array_addI32);
+  assert(sum == (int64_t)(COUNT + 100) * (COUNT + 99) / 2);
+  iter_destroy(iter);
+
+  iter = segarray_createIterator(sa);
+  assert(*(int32_t*)iter_next(iter) == 0 && *(int32_t*)iter_next(iter) == 1 && *iter->idx == 1);
+  array_t* arr = array_create(sizeof(int32_t));
+  array_extendFromIterator(arr, iter);
+  assert(arr->size == COUNT + 98 && *(int32_t*)array_last(arr) == COUNT + 99);
+  array_destroy(arr);
+  iter_destroy(iter);
+
+  // Reset keeps the segments
+  segarray_reset(sa);
+  assert(segarray_size(sa) == 0);
+  assert(segarray_push(sa, &zero) == 0 && segarray_get(sa, 0) == first);
+  assert(segarray_size(sa) == 1);
+  segarray_destroy(sa);
+
+  // Several producers and a concurrent reader
+  sa = segarray_create(sizeof(entry_t));
+  pthread_t threads[THREADS + 1];
+  producer_t producers[THREADS];
+  pthread_create(&threads[THREADS], NULL, scan, sa);
+  for (int32_t t = 0; t < THREADS; t++) {
+    producers[t] = (producer_t){ sa, t };
+    pthread_create(&threads[t], NULL, produce, &producers[t]);
+  }
+  for (int t = 0; t <= THREADS; t++)
+    pthread_join(threads[t], NULL);
+  assert(segarray_size(sa) == THREADS * PER_THREAD);
+
+  // Every value was pushed once, each thread's values keep their order
+  int32_t next[THREADS] = { 0 };
+  for (size_t i = 0; i < THREADS * PER_THREAD; i++) {
+    const entry_t* e = segarray_get(sa, i);
+    assert(e->seq == next[e->thread]);
+    next[e->thread]++;
+  }
+  for (int t = 0; t < THREADS; t++)
+    assert(next[t] == PER_THREAD);
+  segarray_destroy(sa);
+
+  // Failed allocations reserve nothing
+  allocator_t failing = { .alloc = failingAlloc };
+  sa = segarray_create(sizeof(int32_t));
+  sa->allocator = &failing;
+  assert(segarray_push(sa, &zero) == -1);
+  assert(segarray_size(sa) == 0 && atomic_load(&sa->reserved) == 0);
+  sa->allocator = NULL;
+  assert(segarray_push(sa, &zero) == 0);
+  segarray_destroy(sa);
+
+  return 0;
+}
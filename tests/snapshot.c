@@ -0,0 +1,172 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_SNAPSHOT_IMPL
+#include "../CSnapshot.h"
+
+#define COUNT 10000
+
+typedef struct {
+  int64_t key;
+  int32_t value;
+} record_t;
+
+bool isEven(const void* in) {
+  return *(const int32_t*)in % 2 == 0;
+}
+
+int main(void) {
+  // Known CRC-32C check value
+  assert(snapshot_crc32c(0, "123456789", 9) == 0xe3069283);
+  assert(snapshot_crc32c(snapshot_crc32c(0, "1234", 4), "56789", 5) == 0xe3069283);
+  assert(snapshot_crc32c(0, NULL, 0) == 0);
+
+  char path[] = "/tmp/csnapshot_XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+
+  array_t* records = array_create(sizeof(record_t));
+  for (int32_t i = 0; i < COUNT; i++) {
+    record_t r = { (int64_t)i * 3, -i };
+    array_push(records, &r);
+  }
+  array_t* ints = array_create(sizeof(int32_t));
+  for (int32_t i = 0; i < COUNT; i++)
+    array_push(ints, &i);
+  array_t* empty = array_create(sizeof(int32_t));
+
+  // Several snapshots follow each other, the data of each is aligned in the file
+  assert(!array_save(records, fd));
+  off_t second = lseek(fd, 0, SEEK_CUR);
+  assert(!array_save(ints, fd));
+  assert(!array_save(empty, fd));
+  off_t fourth = lseek(fd, 0, SEEK_CUR);
+  iter_t* evens = iter_filter(array_createIterator(ints), isEven);
+  assert(!iter_save(evens, fd));
+  iter_destroy(evens);
+  // A contiguous iterator with a skipped prefix
+  iter_t* tail = iter_skip(array_createIterator(ints), 10);
+  assert(!iter_save(tail, fd));
+  iter_destroy(tail);
+
+  snapshotHeader_t header;
+  assert(pread(fd, &header, sizeof(header), second) == sizeof(header));
+  assert(header.count == COUNT && header.type_size == sizeof(int32_t));
+  assert((second + header.data_offset) % CSNAPSHOT_ALIGN == 0);
+  assert(pread(fd, &header, sizeof(header), fourth) == sizeof(header));
+  assert(header.count == COUNT / 2 && (fourth + header.data_offset) % CSNAPSHOT_ALIGN == 0);
+
+  // Loading copies
+  lseek(fd, 0, SEEK_SET);
+  array_t* loaded = array_load(fd);
+  assert(loaded != NULL && loaded->size == COUNT && loaded->type_size == sizeof(record_t));
+  assert(memcmp(loaded->data, records->data, COUNT * sizeof(record_t)) == 0);
+  // Loaded arrays are ordinary arrays
+  record_t extra = { 1, 1 };
+  assert(!array_push(loaded, &extra));
+  array_destroy(loaded);
+  assert(lseek(fd, 0, SEEK_CUR) == second);
+
+  loaded = array_load(fd);
+  assert(loaded != NULL && loaded->size == COUNT && memcmp(loaded->data, ints->data, COUNT * sizeof(int32_t)) == 0);
+  array_destroy(loaded);
+  loaded = array_load(fd);
+  assert(loaded != NULL && loaded->size == 0 && loaded->type_size == sizeof(int32_t));
+  array_destroy(loaded);
+  loaded = array_load(fd);
+  assert(loaded != NULL && loaded->size == COUNT / 2);
+  for (size_t i = 0; i < loaded->size; i++)
+    assert(*(int32_t*)array_get(loaded, i) == (int32_t)i * 2);
+  array_destroy(loaded);
+  loaded = array_load(fd);
+  assert(loaded != NULL && loaded->size == COUNT - 10 && *(int32_t*)array_get(loaded, 0) == 10);
+  array_destroy(loaded);
+  assert(array_load(fd) == NULL);
+
+  // Mapping doesn't copy, the data is aligned in memory
+  lseek(fd, 0, SEEK_SET);
+  array_t* mapped = array_loadMapped(fd, SNAPSHOT_VERIFY);
+  assert(mapped != NULL && mapped->size == COUNT && (mapped->opt & ARRAY_MAPPED));
+  assert((uintptr_t)mapped->data % CSNAPSHOT_ALIGN == 0);
+  assert(memcmp(mapped->data, records->data, COUNT * sizeof(record_t)) == 0);
+  assert(lseek(fd, 0, SEEK_CUR) == second);
+  array_t* mappedInts = array_loadMapped(fd, 0);
+  assert(mappedInts != NULL && (uintptr_t)mappedInts->data % CSNAPSHOT_ALIGN == 0);
+  assert(memcmp(mappedInts->data, ints->data, COUNT * sizeof(int32_t)) == 0);
+  // Read-only: growing fails, but every reading function works
+  int32_t value = 1;
+  size_t cap = mappedInts->cap;
+  assert(array_push(mappedInts, &value) != 0 || mappedInts->cap == cap);
+  assert(array_binarySearch(mappedInts, &value, array_cmpI32) == 1);
+  assert(!array_advise(mappedInts, ARRAY_ADVICE_RANDOM));
+  array_t* mappedEmpty = array_loadMapped(fd, SNAPSHOT_VERIFY);
+  assert(mappedEmpty != NULL && mappedEmpty->size == 0);
+  array_destroy(mappedEmpty);
+  array_destroy(mappedInts);
+  array_destroy(mapped);
+
+  // Corrupted data is rejected when verified
+  off_t dataStart = second + 64;
+  int32_t garbage = -1;
+  assert(pwrite(fd, &garbage, sizeof(garbage), dataStart + 40) == sizeof(garbage));
+  lseek(fd, second, SEEK_SET);
+  assert(array_load(fd) == NULL);
+  lseek(fd, second, SEEK_SET);
+  assert(array_loadMapped(fd, SNAPSHOT_VERIFY) == NULL);
+  lseek(fd, second, SEEK_SET);
+  mapped = array_loadMapped(fd, 0);
+  assert(mapped != NULL && *(int32_t*)array_get(mapped, 10) == -1);
+  array_destroy(mapped);
+
+  // So are other byte orders, versions, and truncated files
+  assert(pread(fd, &header, sizeof(header), 0) == sizeof(header));
+  snapshotHeader_t swapped = header;
+  swapped.byte_order = __builtin_bswap32(CSNAPSHOT_BYTE_ORDER);
+  assert(pwrite(fd, &swapped, sizeof(swapped), 0) == sizeof(swapped));
+  lseek(fd, 0, SEEK_SET);
+  assert(array_load(fd) == NULL);
+  lseek(fd, 0, SEEK_SET);
+  assert(array_loadMapped(fd, 0) == NULL);
+  swapped = header;
+  swapped.version = CSNAPSHOT_VERSION + 1;
+  assert(pwrite(fd, &swapped, sizeof(swapped), 0) == sizeof(swapped));
+  lseek(fd, 0, SEEK_SET);
+  assert(array_load(fd) == NULL);
+  assert(pwrite(fd, &header, sizeof(header), 0) == sizeof(header));
+  assert(ftruncate(fd, (off_t)(header.data_offset + COUNT * sizeof(record_t) - 1)) == 0);
+  lseek(fd, 0, SEEK_SET);
+  assert(array_loadMapped(fd, 0) == NULL);
+  lseek(fd, 0, SEEK_SET);
+  assert(array_load(fd) == NULL);
+
+  // The data offset follows the start of the snapshot
+  assert(ftruncate(fd, 0) == 0);
+  lseek(fd, 3, SEEK_SET);
+  assert(!array_save(ints, fd));
+  lseek(fd, 3, SEEK_SET);
+  mapped = array_loadMapped(fd, SNAPSHOT_VERIFY);
+  assert(mapped != NULL && (uintptr_t)mapped->data % CSNAPSHOT_ALIGN == 0);
+  assert(memcmp(mapped->data, ints->data, COUNT * sizeof(int32_t)) == 0);
+  array_destroy(mapped);
+
+  // Streaming needs a seekable file
+  int pipeFds[2];
+  assert(pipe(pipeFds) == 0);
+  iter_t* iter = array_createIterator(ints);
+  assert(iter_save(iter, pipeFds[1]) != 0);
+  iter_destroy(iter);
+  close(pipeFds[0]);
+  close(pipeFds[1]);
+
+  close(fd);
+  unlink(path);
+  array_destroy(empty);
+  array_destroy(ints);
+  array_destroy(records);
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include <assert.h>
+#include <stdint.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+#define CT_SOA_IMPL
+#include "../CSoA.h"
+
+#define ID 0
+#define SCORE 1
+#define NAME 2
+
+typedef struct {
+  char text[5];
+} name_t;
+
+int main(void) {
+  soa_t* soa = soa_create((size_t[]){ sizeof(int32_t), sizeof(double), sizeof(name_t) }, 3);
+  assert(soa->size == 0 && soa->field_count == 3);
+  assert(soa_pop(soa, NULL) == -1);
+
+  for (int32_t i = 0; i < 100; i++) {
+    int32_t id = (i * 37) % 100;
+    double score = i * 0.5;
+    name_t name = { { 'n', (char)('a' + i % 26), 0 } };
+    assert(!soa_push(soa, (const void*[]){ &id, &score, &name }));
+  }
+  assert(soa->size == 100);
+  for (size_t f = 0; f < 3; f++)
+    assert(soa_column(soa, f)->size == 100);
+  assert(*(int32_t*)soa_get(soa, ID, 3) == 11);
+  assert(*(double*)soa_get(soa, SCORE, 3) == 1.5);
+  assert(((name_t*)soa_get(soa, NAME, 3))->text[1] == 'd');
+
+  // Columns work with the array functions and their kernels
+  int64_t sum = array_sumI32(soa_column(soa, ID));
+  assert(sum == 99 * 100 / 2);
+  iter_t* iter = soa_fieldIterator(soa, ID);
+  assert((iter->opt & ITER_CONTIGUOUS) && iter->known_size == 100);
+  assert(*(const int32_t*)iter_min(iter, array_cmpI32) == 99);
+  iter_destroy(iter);
+  iter = soa_fieldIterator(soa, SCORE);
+  assert(*(const double*)iter_min(iter, array_cmpF64) == 49.5);
+  double total = 0;
+  double* scores = soa_column(soa, SCORE)->data;
+  for (size_t i = 0; i < 100; i++)
+    total += scores[i];
+  assert(total == 0.5 * 99 * 100 / 2);
+  iter_destroy(iter);
+
+  // Rows stay together
+  soa_swap(soa, 0, 3);
+  assert(*(int32_t*)soa_get(soa, ID, 0) == 11 && *(double*)soa_get(soa, SCORE, 0) == 1.5);
+  assert(*(int32_t*)soa_get(soa, ID, 3) == 0 && *(double*)soa_get(soa, SCORE, 3) == 0);
+  soa_swap(soa, 0, 3);
+
+  assert(!soa_sortByField(soa, ID, array_cmpI32));
+  for (int32_t i = 0; i < 100; i++) {
+    assert(*(int32_t*)soa_get(soa, ID, i) == i);
+    // The row that had id `i` was pushed at `j` with `j * 37 % 100 == i`, 73 is the inverse of 37
+    int32_t j = (i * 73) % 100;
+    assert(*(double*)soa_get(soa, SCORE, i) == j * 0.5);
+    assert(((name_t*)soa_get(soa, NAME, i))->text[1] == 'a' + j % 26);
+  }
+
+  // Stable for equal keys
+  soa_reset(soa);
+  for (int32_t i = 0; i < 20; i++) {
+    int32_t id = i % 3;
+    double score = i;
+    name_t name = { { 0 } };
+    soa_push(soa, (const void*[]){ &id, &score, &name });
+  }
+  assert(!soa_sortByField(soa, ID, array_cmpI32));
+  double last = -1;
+  for (size_t i = 0; i < 20; i++) {
+    double score = *(double*)soa_get(soa, SCORE, i);
+    if (i > 0 && *(int32_t*)soa_get(soa, ID, i) == *(int32_t*)soa_get(soa, ID, i - 1))
+      assert(score > last);
+    last = score;
+  }
+
+  int32_t outId;
+  name_t outName;
+  assert(soa_pop(soa, (void*[]){ &outId, NULL, &outName }) == 19);
+  assert(outId == 2 && soa_column(soa, SCORE)->size == 19);
+
+  double score = 42;
+  name_t name = { "set" };
+  outId = 7;
+  soa_set(soa, 0, (const void*[]){ &outId, &score, &name });
+  assert(*(double*)soa_get(soa, SCORE, 0) == 42);
+
+  assert(!soa_reserveAtLeast(soa, 1000));
+  assert(soa_column(soa, NAME)->cap >= 1000 && soa->size == 19);
+  soa_destroy(soa);
+
+  return 0;
+}
@@ -0,0 +1,140 @@
+#define CT_STATS
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#define CT_ARRAY_IMPL
+#include "../CArray.h"
+#define CT_ITERATOR_IMPL
+#include "../CIterator.h"
+
+CT_ARRAY_DEFINE(int, intarr)
+
+typedef struct {
+  size_t calls;
+  size_t lastOldCap;
+  size_t lastNewCap;
+} growLog_t;
+
+void logGrow(const array_t* arr, size_t oldCap, void* ctx) {
+  growLog_t* log = ctx;
+  log->calls++;
+  log->lastOldCap = oldCap;
+  log->lastNewCap = arr->cap;
+}
+
+bool isEven(const void* value) {
+  return *(const int*)value % 2 == 0;
+}
+
+void copyInt(const void* in, void* out) {
+  *(int*)out = *(const int*)in;
+}
+
+void* nextNothing(void* data) {
+  (void)data;
+  return NULL;
+}
+
+int main(void) {
+  growLog_t log = { 0 };
+  array_setGrowHook(logGrow, &log);
+
+  array_t* arr = array_create(sizeof(int));
+  for (int i = 0; i < 100; i++)
+    array_push(arr, &i);
+  // 10, 20, 40, 80, 160
+  assert(arr->stats.allocs == 1 && arr->stats.reallocs == 4);
+  assert(arr->stats.copy_bytes == (10 + 20 + 40 + 80) * sizeof(int));
+  assert(arr->stats.peak_cap == 160 && arr->stats.peak_size == 100);
+  assert(log.calls == 5 && log.lastOldCap == 80 && log.lastNewCap == 160);
+
+  int val = 7;
+  array_insert(arr, 90, &val);
+  assert(arr->stats.move_bytes == 10 * sizeof(int));
+  array_popAt(arr, 0, NULL);
+  assert(arr->stats.move_bytes == (10 + 100) * sizeof(int));
+  array_removeRange(arr, 0, 50);
+  assert(arr->stats.move_bytes == (10 + 100 + 50) * sizeof(int));
+  assert(arr->stats.peak_size == 101);
+
+  assert(array_globalStats.allocs >= 1 && array_globalStats.peak_cap >= 160);
+
+  array_setGrowHook(NULL, NULL);
+  array_shrinkToFit(arr);
+  assert(log.calls == 5 && arr->stats.reallocs == 5);
+
+  FILE* out = tmpfile();
+  array_statsDump(arr, out);
+  array_statsDump(NULL, out);
+  rewind(out);
+  char line[256];
+  assert(fgets(line, sizeof(line), out) && strstr(line, "array: allocs=1 reallocs=5") == line);
+  assert(fgets(line, sizeof(line), out) && strstr(line, "arrays: ") == line);
+  fclose(out);
+
+  // Typed pushes and consumers that set the size directly record it too
+  intarr_t* typed = intarr_create();
+  for (int i = 0; i < 25; i++)
+    intarr_push(typed, i);
+  assert(typed->array.stats.peak_size == 25);
+  iter_t* typedIter = array_createIterator(&typed->array);
+  array_t* collected = iter_collectCreate(typedIter);
+  assert(collected->stats.peak_size == 25);
+  iter_destroy(typedIter);
+  typedIter = array_createIterator(&typed->array);
+  array_t* copied = iter_mapCreate(typedIter, copyInt);
+  assert(copied->stats.peak_size == 25);
+  iter_destroy(typedIter);
+  array_destroy(copied);
+  array_destroy(collected);
+  intarr_destroy(typed);
+
+  // Which path consumers took
+  iter_t* iter = array_createIterator(arr);
+  assert(iter->stats.next_calls == 0);
+  array_t* copy = iter_collectCreate(iter);
+  assert(iter->stats.contiguous_paths == 1 && iter->stats.batch_paths == 0);
+  iter_destroy(iter);
+  array_destroy(copy);
+
+  iter_t* inner = array_createIterator(arr);
+  iter = iter_filter(inner, isEven);
+  array_t* evens = iter_collectCreate(iter);
+  assert(iter->stats.batch_paths == 1 && iter->stats.next_calls == 0);
+  // Adapters read spans of their inner iterator without counting as consumers
+  assert(inner->stats.batch_paths == 0 && inner->stats.batch_calls >= 2);
+  assert(iter->stats.batch_calls >= 2);
+  iter_destroy(iter);
+  array_destroy(evens);
+
+  // Mapping values of unknown count grows geometrically, not by one batch at a time
+  array_t* many = array_createWithCap(sizeof(int), 100000);
+  for (int i = 0; i < 100000; i++)
+    array_push(many, &i);
+  iter = iter_filter(array_createIterator(many), isEven);
+  array_t* mapped = iter_mapCreate(iter, copyInt);
+  assert(mapped->size == 50000 && mapped->stats.reallocs < 20);
+  iter_destroy(iter);
+  array_destroy(mapped);
+  array_destroy(many);
+
+  iter = array_createIterator(arr);
+  iter_next(iter);
+  int32_t sum = 0;
+  iter_reduce(iter, &sum, array_addI32);
+  assert(iter->stats.next_calls == 1 && iter->stats.batch_paths == 1);
+  iter_destroy(iter);
+
+  // Iterators built by hand start with zeroed counters
+  iter_t manual = { .next = nextNothing, .type_size = sizeof(int) };
+  iter_findFirst(&manual, isEven);
+  assert(manual.stats.element_paths == 1 && manual.stats.next_calls == 1);
+  array_t* none = iter_collectCreate(&manual);
+  assert(none->size == 0 && manual.stats.element_paths == 2);
+  array_destroy(none);
+
+  assert(iter_globalStats.contiguous_paths >= 1 && iter_globalStats.element_paths >= 2);
+  array_destroy(arr);
+
+  return 0;
+}